@@ -0,0 +1,46 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * sha2-ce-pbl.c - SHA-256 block transform for the PBL using ARMv8 Crypto
+ * Extensions
+ *
+ * Used by the generic SHA-256 code in the PBL, which falls back to its C
+ * implementation on CPUs without the SHA-256 instructions.
+ */
+
+#include <common.h>
+#include <crypto/sha.h>
+#include <crypto/pbl-sha.h>
+#include <linux/linkage.h>
+#include <asm/sysreg.h>
+
+#define ID_AA64ISAR0_SHA2_SHIFT	12
+
+struct sha256_ce_state {
+	struct sha256_state	sst;
+	u32			finalize;
+};
+
+const u32 sha256_ce_offsetof_count = offsetof(struct sha256_ce_state,
+					      sst.count);
+const u32 sha256_ce_offsetof_finalize = offsetof(struct sha256_ce_state,
+						 finalize);
+
+asmlinkage int sha2_ce_transform(struct sha256_ce_state *sst, u8 const *src,
+				 int blocks);
+
+bool sha256_arch_blocks(u32 *state, const u8 *src, unsigned int blocks)
+{
+	struct sha256_ce_state sctx;
+
+	if (!((read_sysreg(id_aa64isar0_el1) >> ID_AA64ISAR0_SHA2_SHIFT) & 0xf))
+		return false;
+
+	memcpy(sctx.sst.state, state, sizeof(sctx.sst.state));
+	sctx.finalize = 0;
+
+	sha2_ce_transform(&sctx, src, blocks);
+
+	memcpy(state, sctx.sst.state, sizeof(sctx.sst.state));
+
+	return true;
+}
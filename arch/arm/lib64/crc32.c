@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * CRC-32 using the ARMv8 CRC32 instructions
+ */
+
+#include <common.h>
+#include <crc.h>
+#include <asm/sysreg.h>
+#include <asm/unaligned.h>
+
+#define ID_AA64ISAR0_CRC32_SHIFT	16
+
+static int crc32_insns = -1;
+
+static bool cpu_has_crc32(void)
+{
+	if (crc32_insns < 0)
+		crc32_insns = (read_sysreg(id_aa64isar0_el1) >>
+			       ID_AA64ISAR0_CRC32_SHIFT) & 0xf;
+
+	return crc32_insns;
+}
+
+#define CRC32_INSN(insn, reg, type)					\
+static inline u32 __##insn(u32 crc, type val)				\
+{									\
+	asm(".arch_extension crc\n\t"					\
+	    #insn " %w0, %w0, %" #reg "1" : "+r" (crc) : "r" (val));	\
+	return crc;							\
+}
+
+CRC32_INSN(crc32x, x, u64)
+CRC32_INSN(crc32w, w, u32)
+CRC32_INSN(crc32h, w, u16)
+CRC32_INSN(crc32b, w, u8)
+
+uint32_t crc32_le_arch(uint32_t crc, const void *_buf, unsigned int len)
+{
+	const u8 *buf = _buf;
+
+	if (!cpu_has_crc32())
+		return crc32_le_generic(crc, buf, len);
+
+	/* unaligned accesses fault while the MMU is off */
+	while (len && ((unsigned long)buf & 7)) {
+		crc = __crc32b(crc, *buf++);
+		len--;
+	}
+
+	while (len >= 8) {
+		crc = __crc32x(crc, get_unaligned_le64(buf));
+		buf += 8;
+		len -= 8;
+	}
+
+	if (len & 4) {
+		crc = __crc32w(crc, get_unaligned_le32(buf));
+		buf += 4;
+	}
+	if (len & 2) {
+		crc = __crc32h(crc, get_unaligned_le16(buf));
+		buf += 2;
+	}
+	if (len & 1)
+		crc = __crc32b(crc, *buf);
+
+	return crc;
+}
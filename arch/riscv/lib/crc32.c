@@ -0,0 +1,131 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * CRC-32 using the carry-less multiplication of the Zbc extension
+ *
+ * Eight bytes are reduced at a time with a Barrett reduction, see
+ * https://www.corsix.org/content/barrett-reduction-polynomials
+ */
+
+#include <common.h>
+#include <crc.h>
+#include <of.h>
+#include <asm/unaligned.h>
+
+/* the CRC-32 polynomial, bit reflected */
+#define CRC32_POLY_LE		0xedb88320
+
+/* quotient of x^(64 + 32) / CRC32_POLY, bit reflected, implicit x^64 */
+#define CRC32_POLY_QT_LE	0x5a72d812fb808b20UL
+
+/* encoded with .insn, so that no assembler support for Zbc is needed */
+static inline unsigned long clmul(unsigned long a, unsigned long b)
+{
+	unsigned long r;
+
+	asm(".insn r 0x33, 1, 5, %0, %1, %2" : "=r" (r) : "r" (a), "r" (b));
+	return r;
+}
+
+static inline unsigned long clmulr(unsigned long a, unsigned long b)
+{
+	unsigned long r;
+
+	asm(".insn r 0x33, 2, 5, %0, %1, %2" : "=r" (r) : "r" (a), "r" (b));
+	return r;
+}
+
+static inline u32 crc32_le_zbc(unsigned long s)
+{
+	unsigned long t;
+
+	t = (clmul(s, CRC32_POLY_QT_LE) << 1) ^ s;
+
+	return clmulr(t, (unsigned long)CRC32_POLY_LE << 32) >> 32;
+}
+
+/* up to seven bytes, given the shift register semantics of crc32_le_zbc */
+static u32 crc32_le_bytes(u32 crc, const u8 *p, unsigned int len)
+{
+	unsigned int bits = len * 8;
+	unsigned long s = 0;
+	u32 crc_low = 0;
+
+	while (len--)
+		s = ((unsigned long)*p++ << 56) | (s >> 8);
+
+	s ^= (unsigned long)crc << (64 - bits);
+	if (bits < 32)
+		crc_low = crc >> bits;
+
+	return crc32_le_zbc(s) ^ crc_low;
+}
+
+static int zbc = -1;
+
+static bool isa_has_zbc(const char *isa)
+{
+	const char *p;
+
+	/* multi-letter extensions are separated by underscores */
+	for (p = strchr(isa, '_'); p; p = strchr(p + 1, '_'))
+		if (!strncasecmp(p + 1, "zbc", 3) &&
+		    (p[4] == '_' || p[4] == '\0'))
+			return true;
+
+	return false;
+}
+
+static bool cpu_has_zbc(void)
+{
+	struct device_node *cpu;
+	const char *isa;
+
+	if (zbc >= 0)
+		return zbc;
+
+	/* we can only tell once the device tree is there */
+	if (!of_get_root_node())
+		return false;
+
+	zbc = 0;
+
+	/* barebox runs on the boot hart, assume a homogeneous system */
+	cpu = of_find_node_by_type(NULL, "cpu");
+	if (!cpu)
+		return false;
+
+	if (of_property_match_string(cpu, "riscv,isa-extensions", "zbc") >= 0)
+		zbc = 1;
+	else if (!of_property_read_string(cpu, "riscv,isa", &isa))
+		zbc = isa_has_zbc(isa);
+
+	return zbc;
+}
+
+uint32_t crc32_le_arch(uint32_t crc, const void *_buf, unsigned int len)
+{
+	const u8 *buf = _buf;
+	unsigned int head;
+
+	if (!cpu_has_zbc())
+		return crc32_le_generic(crc, buf, len);
+
+	head = -(unsigned long)buf & 7;
+	if (head && len) {
+		head = min(head, len);
+		crc = crc32_le_bytes(crc, buf, head);
+		buf += head;
+		len -= head;
+	}
+
+	while (len >= 8) {
+		crc = crc32_le_zbc(crc ^ get_unaligned_le64(buf));
+		buf += 8;
+		len -= 8;
+	}
+
+	if (len)
+		crc = crc32_le_bytes(crc, buf, len);
+
+	return crc;
+}
@@ -0,0 +1,173 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * sha256-ni-glue.c - SHA-224/SHA-256 using the x86 SHA extensions
+ *
+ * The block transform follows Intel's reference code for the SHA
+ * extensions. The state is kept in the ABEF/CDGH layout expected by
+ * SHA256RNDS2 while processing the blocks.
+ */
+
+#include <common.h>
+#include <digest.h>
+#include <init.h>
+#include <crypto/sha.h>
+#include <crypto/sha256_base.h>
+#include <crypto/internal.h>
+#include <cpuid.h>
+/* skip _mm_malloc(), which needs the hosted <stdlib.h> */
+#define _MM_MALLOC_H_INCLUDED
+#include <immintrin.h>
+
+#define target_sha_ni	__attribute__((target("sse4.1,sha")))
+
+static const u32 sha256_K[64] __aligned(16) = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static target_sha_ni void sha256_ni_transform(struct sha256_state *sst,
+					      u8 const *src, int blocks)
+{
+	const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL,
+					     0x0405060700010203ULL);
+	const __m128i *k = (const __m128i *)sha256_K;
+	__m128i state0, state1, abef, cdgh, msg[4], t;
+	int i;
+
+	t = _mm_loadu_si128((const __m128i *)&sst->state[0]);
+	state1 = _mm_loadu_si128((const __m128i *)&sst->state[4]);
+
+	t = _mm_shuffle_epi32(t, 0xb1);			/* CDAB */
+	state1 = _mm_shuffle_epi32(state1, 0x1b);	/* EFGH */
+	state0 = _mm_alignr_epi8(t, state1, 8);		/* ABEF */
+	state1 = _mm_blend_epi16(state1, t, 0xf0);	/* CDGH */
+
+	while (blocks--) {
+		abef = state0;
+		cdgh = state1;
+
+#pragma GCC unroll 16
+		for (i = 0; i < 16; i++) {
+			__m128i *w = &msg[i & 3];
+
+			if (i < 4) {
+				*w = _mm_loadu_si128((const __m128i *)src + i);
+				*w = _mm_shuffle_epi8(*w, bswap);
+			} else {
+				/* W[t - 16] + s0(W[t - 15]) + W[t - 7] + s1(W[t - 2]) */
+				*w = _mm_sha256msg1_epu32(*w, msg[(i + 1) & 3]);
+				*w = _mm_add_epi32(*w,
+						   _mm_alignr_epi8(msg[(i + 3) & 3],
+								   msg[(i + 2) & 3], 4));
+				*w = _mm_sha256msg2_epu32(*w, msg[(i + 3) & 3]);
+			}
+
+			t = _mm_add_epi32(*w, _mm_load_si128(k + i));
+			state1 = _mm_sha256rnds2_epu32(state1, state0, t);
+			t = _mm_shuffle_epi32(t, 0x0e);
+			state0 = _mm_sha256rnds2_epu32(state0, state1, t);
+		}
+
+		state0 = _mm_add_epi32(state0, abef);
+		state1 = _mm_add_epi32(state1, cdgh);
+
+		src += SHA256_BLOCK_SIZE;
+	}
+
+	t = _mm_shuffle_epi32(state0, 0x1b);		/* FEBA */
+	state1 = _mm_shuffle_epi32(state1, 0xb1);	/* DCHG */
+	state0 = _mm_blend_epi16(t, state1, 0xf0);	/* DCBA */
+	state1 = _mm_alignr_epi8(state1, t, 8);		/* ABEF */
+
+	_mm_storeu_si128((__m128i *)&sst->state[0], state0);
+	_mm_storeu_si128((__m128i *)&sst->state[4], state1);
+}
+
+static int sha256_ni_update(struct digest *desc, const void *data,
+			    unsigned long len)
+{
+	return sha256_base_do_update(desc, data, len, sha256_ni_transform);
+}
+
+static int sha256_ni_final(struct digest *desc, u8 *out)
+{
+	sha256_base_do_finalize(desc, sha256_ni_transform);
+	return sha256_base_finish(desc, out);
+}
+
+static bool cpu_has_sha_ni(void)
+{
+	unsigned int eax, ebx, ecx, edx;
+
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_SSE4_1))
+		return false;
+
+	return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) &&
+	       (ebx & bit_SHA);
+}
+
+static struct digest_algo sha224 = {
+	.base = {
+		.name		=	"sha224",
+		.driver_name	=	"sha224-ni",
+		.priority	=	200,
+		.algo		=	HASH_ALGO_SHA224,
+	},
+
+	.length	=	SHA224_DIGEST_SIZE,
+	.init	=	sha224_base_init,
+	.update	=	sha256_ni_update,
+	.final	=	sha256_ni_final,
+	.digest	=	digest_generic_digest,
+	.verify	=	digest_generic_verify,
+	.ctx_length =	sizeof(struct sha256_state),
+};
+
+static int sha224_ni_digest_register(void)
+{
+	if (!cpu_has_sha_ni())
+		return 0;
+
+	return digest_algo_register(&sha224);
+}
+coredevice_initcall(sha224_ni_digest_register);
+
+static struct digest_algo sha256 = {
+	.base = {
+		.name		=	"sha256",
+		.driver_name	=	"sha256-ni",
+		.priority	=	200,
+		.algo		=	HASH_ALGO_SHA256,
+	},
+
+	.length	=	SHA256_DIGEST_SIZE,
+	.init	=	sha256_base_init,
+	.update	=	sha256_ni_update,
+	.final	=	sha256_ni_final,
+	.digest	=	digest_generic_digest,
+	.verify	=	digest_generic_verify,
+	.ctx_length =	sizeof(struct sha256_state),
+};
+
+static int sha256_ni_digest_register(void)
+{
+	if (!cpu_has_sha_ni())
+		return 0;
+
+	return digest_algo_register(&sha256);
+}
+coredevice_initcall(sha256_ni_digest_register);
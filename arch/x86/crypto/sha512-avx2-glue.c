@@ -0,0 +1,256 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * sha512-avx2-glue.c - SHA-384/SHA-512 using AVX2 and BMI2
+ *
+ * x86 has no SHA-512 instructions. The message schedule is computed four
+ * words at a time with AVX2, interleaved with the scalar rounds, which
+ * use the BMI2 RORX rotates.
+ */
+
+#include <common.h>
+#include <digest.h>
+#include <init.h>
+#include <crypto/sha.h>
+#include <crypto/sha512_base.h>
+#include <crypto/internal.h>
+#include <linux/bitops.h>
+#include <cpuid.h>
+/* skip _mm_malloc(), which needs the hosted <stdlib.h> */
+#define _MM_MALLOC_H_INCLUDED
+#include <immintrin.h>
+
+#define target_avx2	__attribute__((target("avx2,bmi2")))
+
+static const u64 sha512_K[80] __aligned(32) = {
+	0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL,
+	0xe9b5dba58189dbbcULL, 0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL,
+	0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL, 0xd807aa98a3030242ULL,
+	0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+	0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL,
+	0xc19bf174cf692694ULL, 0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL,
+	0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL, 0x2de92c6f592b0275ULL,
+	0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+	0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL,
+	0xbf597fc7beef0ee4ULL, 0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL,
+	0x06ca6351e003826fULL, 0x142929670a0e6e70ULL, 0x27b70a8546d22ffcULL,
+	0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+	0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL,
+	0x92722c851482353bULL, 0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL,
+	0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL, 0xd192e819d6ef5218ULL,
+	0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+	0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL,
+	0x34b0bcb5e19b48a8ULL, 0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL,
+	0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL, 0x748f82ee5defb2fcULL,
+	0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+	0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL,
+	0xc67178f2e372532bULL, 0xca273eceea26619cULL, 0xd186b8c721c0c207ULL,
+	0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL, 0x06f067aa72176fbaULL,
+	0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+	0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL,
+	0x431d67c49c100d4cULL, 0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL,
+	0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL,
+};
+
+/* AVX2 has no 64 bit rotates */
+#define ROR256(x, n)	_mm256_or_si256(_mm256_srli_epi64(x, n), \
+					_mm256_slli_epi64(x, 64 - (n)))
+#define ROR128(x, n)	_mm_or_si128(_mm_srli_epi64(x, n), \
+				     _mm_slli_epi64(x, 64 - (n)))
+
+static inline target_avx2 __m256i sigma0_avx2(__m256i x)
+{
+	return _mm256_xor_si256(_mm256_xor_si256(ROR256(x, 1), ROR256(x, 8)),
+				_mm256_srli_epi64(x, 7));
+}
+
+static inline target_avx2 __m128i sigma1_avx2(__m128i x)
+{
+	return _mm_xor_si128(_mm_xor_si128(ROR128(x, 19), ROR128(x, 61)),
+			     _mm_srli_epi64(x, 6));
+}
+
+/*
+ * Four message words at a time: W[t - 16] + s0(W[t - 15]) + W[t - 7] for
+ * all four, then s1(W[t - 2]) for two words each, as the upper two depend
+ * on the lower two. The round constants are added right away.
+ */
+static inline target_avx2 void sha512_avx2_schedule(u64 *w, u64 *wk, int t)
+{
+	const __m256i *k = (const __m256i *)sha512_K;
+	__m256i x;
+	__m128i lo, hi;
+
+	x = _mm256_add_epi64(_mm256_load_si256((__m256i *)&w[t - 16]),
+		sigma0_avx2(_mm256_loadu_si256((__m256i *)&w[t - 15])));
+	x = _mm256_add_epi64(x, _mm256_loadu_si256((__m256i *)&w[t - 7]));
+
+	lo = _mm_add_epi64(_mm256_castsi256_si128(x),
+		sigma1_avx2(_mm_load_si128((__m128i *)&w[t - 2])));
+	hi = _mm_add_epi64(_mm256_extracti128_si256(x, 1), sigma1_avx2(lo));
+
+	x = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+	_mm256_store_si256((__m256i *)&w[t], x);
+	x = _mm256_add_epi64(x, _mm256_load_si256(k + t / 4));
+	_mm256_store_si256((__m256i *)&wk[t], x);
+}
+
+#define Sigma0(x)	(ror64(x, 28) ^ ror64(x, 34) ^ ror64(x, 39))
+#define Sigma1(x)	(ror64(x, 14) ^ ror64(x, 18) ^ ror64(x, 41))
+#define Ch(x, y, z)	((z) ^ ((x) & ((y) ^ (z))))
+#define Maj(x, y, z)	(((x) & (y)) | ((z) & ((x) | (y))))
+
+#define ROUND(a, b, c, d, e, f, g, h, i) do {				\
+	u64 t1 = h + Sigma1(e) + Ch(e, f, g) + wk[i];			\
+	u64 t2 = Sigma0(a) + Maj(a, b, c);				\
+	d += t1;							\
+	h = t1 + t2;							\
+} while (0)
+
+static target_avx2 void sha512_avx2_transform(struct sha512_state *sst,
+					      u8 const *src, int blocks)
+{
+	const __m256i bswap = _mm256_set_epi64x(0x08090a0b0c0d0e0fULL,
+						0x0001020304050607ULL,
+						0x08090a0b0c0d0e0fULL,
+						0x0001020304050607ULL);
+	const __m256i *k = (const __m256i *)sha512_K;
+	u64 w[80] __aligned(32), wk[80] __aligned(32);
+	u64 a, b, c, d, e, f, g, h;
+	__m256i x;
+	int i;
+
+	while (blocks--) {
+		for (i = 0; i < 16; i += 4) {
+			x = _mm256_loadu_si256((const __m256i *)(src + i * 8));
+			x = _mm256_shuffle_epi8(x, bswap);
+			_mm256_store_si256((__m256i *)&w[i], x);
+			x = _mm256_add_epi64(x, _mm256_load_si256(k + i / 4));
+			_mm256_store_si256((__m256i *)&wk[i], x);
+		}
+
+		a = sst->state[0];
+		b = sst->state[1];
+		c = sst->state[2];
+		d = sst->state[3];
+		e = sst->state[4];
+		f = sst->state[5];
+		g = sst->state[6];
+		h = sst->state[7];
+
+		for (i = 0; i < 80; i += 4) {
+			if (i < 64)
+				sha512_avx2_schedule(w, wk, i + 16);
+			if (i & 4) {
+				ROUND(e, f, g, h, a, b, c, d, i);
+				ROUND(d, e, f, g, h, a, b, c, i + 1);
+				ROUND(c, d, e, f, g, h, a, b, i + 2);
+				ROUND(b, c, d, e, f, g, h, a, i + 3);
+			} else {
+				ROUND(a, b, c, d, e, f, g, h, i);
+				ROUND(h, a, b, c, d, e, f, g, i + 1);
+				ROUND(g, h, a, b, c, d, e, f, i + 2);
+				ROUND(f, g, h, a, b, c, d, e, i + 3);
+			}
+		}
+
+		sst->state[0] += a;
+		sst->state[1] += b;
+		sst->state[2] += c;
+		sst->state[3] += d;
+		sst->state[4] += e;
+		sst->state[5] += f;
+		sst->state[6] += g;
+		sst->state[7] += h;
+
+		src += SHA512_BLOCK_SIZE;
+	}
+}
+
+static int sha512_avx2_update(struct digest *desc, const void *data,
+			      unsigned long len)
+{
+	return sha512_base_do_update(desc, data, len, sha512_avx2_transform);
+}
+
+static int sha512_avx2_final(struct digest *desc, u8 *out)
+{
+	sha512_base_do_finalize(desc, sha512_avx2_transform);
+	return sha512_base_finish(desc, out);
+}
+
+static u64 xgetbv(u32 index)
+{
+	u32 eax, edx;
+
+	asm volatile("xgetbv" : "=a" (eax), "=d" (edx) : "c" (index));
+
+	return (u64)edx << 32 | eax;
+}
+
+/* the firmware must have enabled the AVX register state as well */
+static bool cpu_has_avx2(void)
+{
+	unsigned int eax, ebx, ecx, edx;
+
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) ||
+	    !(ecx & bit_OSXSAVE) || !(ecx & bit_AVX))
+		return false;
+
+	if ((xgetbv(0) & 0x6) != 0x6)
+		return false;
+
+	return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) &&
+	       (ebx & bit_AVX2) && (ebx & bit_BMI2);
+}
+
+static struct digest_algo sha384 = {
+	.base = {
+		.name		=	"sha384",
+		.driver_name	=	"sha384-avx2",
+		.priority	=	200,
+		.algo		=	HASH_ALGO_SHA384,
+	},
+
+	.length	=	SHA384_DIGEST_SIZE,
+	.init	=	sha384_base_init,
+	.update	=	sha512_avx2_update,
+	.final	=	sha512_avx2_final,
+	.digest	=	digest_generic_digest,
+	.verify	=	digest_generic_verify,
+	.ctx_length =	sizeof(struct sha512_state),
+};
+
+static int sha384_avx2_digest_register(void)
+{
+	if (!cpu_has_avx2())
+		return 0;
+
+	return digest_algo_register(&sha384);
+}
+coredevice_initcall(sha384_avx2_digest_register);
+
+static struct digest_algo sha512 = {
+	.base = {
+		.name		=	"sha512",
+		.driver_name	=	"sha512-avx2",
+		.priority	=	200,
+		.algo		=	HASH_ALGO_SHA512,
+	},
+
+	.length	=	SHA512_DIGEST_SIZE,
+	.init	=	sha512_base_init,
+	.update	=	sha512_avx2_update,
+	.final	=	sha512_avx2_final,
+	.digest	=	digest_generic_digest,
+	.verify	=	digest_generic_verify,
+	.ctx_length =	sizeof(struct sha512_state),
+};
+
+static int sha512_avx2_digest_register(void)
+{
+	if (!cpu_has_avx2())
+		return 0;
+
+	return digest_algo_register(&sha512);
+}
+coredevice_initcall(sha512_avx2_digest_register);
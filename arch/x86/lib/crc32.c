@@ -0,0 +1,108 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * CRC-32 using carry-less multiplication (PCLMULQDQ)
+ *
+ * 64 bytes are folded per iteration, followed by a Barrett reduction,
+ * as described in Intel's "Fast CRC Computation for Generic Polynomials
+ * Using PCLMULQDQ Instruction". The constants are for the bit reflected
+ * CRC-32 polynomial.
+ */
+
+#include <common.h>
+#include <crc.h>
+#include <cpuid.h>
+/* skip _mm_malloc(), which needs the hosted <stdlib.h> */
+#define _MM_MALLOC_H_INCLUDED
+#include <wmmintrin.h>
+#include <smmintrin.h>
+
+#define CRC32_PCLMUL_MIN	64
+
+#define target_pclmul	__attribute__((target("sse4.1,pclmul")))
+
+static int pclmul = -1;
+
+static bool cpu_has_pclmul(void)
+{
+	unsigned int eax, ebx, ecx, edx;
+
+	if (pclmul < 0)
+		pclmul = __get_cpuid(1, &eax, &ebx, &ecx, &edx) &&
+			 (ecx & bit_PCLMUL) && (ecx & bit_SSE4_1);
+
+	return pclmul;
+}
+
+static target_pclmul inline __m128i fold(__m128i x, __m128i k, __m128i data)
+{
+	return _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00),
+					   _mm_clmulepi64_si128(x, k, 0x11)),
+			     data);
+}
+
+/* @len must be a multiple of 16 and at least CRC32_PCLMUL_MIN */
+static target_pclmul u32 crc32_le_pclmul(u32 crc, const u8 *buf,
+					 unsigned int len)
+{
+	const __m128i k1k2 = _mm_set_epi64x(0x1c6e41596, 0x154442bd4);
+	const __m128i k3k4 = _mm_set_epi64x(0x0ccaa009e, 0x1751997d0);
+	const __m128i k5 = _mm_set_epi64x(0, 0x163cd6124);
+	const __m128i poly = _mm_set_epi64x(0x1f7011641, 0x1db710641);
+	const __m128i mask32 = _mm_set_epi32(0, 0, 0, ~0);
+	const __m128i *p = (const __m128i *)buf;
+	__m128i x0, x1, x2, x3, x4;
+
+	x1 = _mm_xor_si128(_mm_loadu_si128(p + 0), _mm_cvtsi32_si128(crc));
+	x2 = _mm_loadu_si128(p + 1);
+	x3 = _mm_loadu_si128(p + 2);
+	x4 = _mm_loadu_si128(p + 3);
+	p += 4;
+	len -= 64;
+
+	while (len >= 64) {
+		x1 = fold(x1, k1k2, _mm_loadu_si128(p + 0));
+		x2 = fold(x2, k1k2, _mm_loadu_si128(p + 1));
+		x3 = fold(x3, k1k2, _mm_loadu_si128(p + 2));
+		x4 = fold(x4, k1k2, _mm_loadu_si128(p + 3));
+		p += 4;
+		len -= 64;
+	}
+
+	x1 = fold(x1, k3k4, x2);
+	x1 = fold(x1, k3k4, x3);
+	x1 = fold(x1, k3k4, x4);
+
+	while (len >= 16) {
+		x1 = fold(x1, k3k4, _mm_loadu_si128(p++));
+		len -= 16;
+	}
+
+	/* fold 128 to 64 bits */
+	x0 = _mm_clmulepi64_si128(k3k4, x1, 0x01);
+	x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x0);
+	x2 = _mm_and_si128(x1, mask32);
+	x1 = _mm_xor_si128(_mm_srli_si128(x1, 4),
+			   _mm_clmulepi64_si128(x2, k5, 0x00));
+
+	/* Barrett reduction to 32 bits */
+	x2 = _mm_and_si128(_mm_clmulepi64_si128(_mm_and_si128(x1, mask32),
+						poly, 0x10), mask32);
+	x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	return _mm_extract_epi32(x1, 1);
+}
+
+uint32_t crc32_le_arch(uint32_t crc, const void *_buf, unsigned int len)
+{
+	const u8 *buf = _buf;
+	unsigned int n;
+
+	if (len < CRC32_PCLMUL_MIN || !cpu_has_pclmul())
+		return crc32_le_generic(crc, buf, len);
+
+	n = len & ~15;
+	crc = crc32_le_pclmul(crc, buf, n);
+
+	return crc32_le_generic(crc, buf + n, len - n);
+}
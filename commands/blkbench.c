@@ -0,0 +1,235 @@
+// SPDX-License-Identifier: GPL-2.0-only
+
+/*
+ * blkbench - measure read and write throughput of a device or file
+ */
+
+#include <common.h>
+#include <command.h>
+#include <block.h>
+#include <clock.h>
+#include <dma.h>
+#include <driver.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <fs.h>
+#include <getopt.h>
+#include <libfile.h>
+#include <stdlib.h>
+#include <linux/math64.h>
+#include <linux/sizes.h>
+#include <linux/stat.h>
+
+struct blkbench {
+	int fd;
+	struct cdev *cdev;
+	struct block_device *blk;	/* accessed directly when set */
+	void *buf;
+	bool write;
+};
+
+static int blkbench_io(struct blkbench *bb, loff_t pos, size_t len)
+{
+	struct block_device *blk = bb->blk;
+	sector_t block;
+	blkcnt_t blocks;
+	int ret;
+
+	if (!blk) {
+		if (bb->write)
+			ret = pwrite_full(bb->fd, bb->buf, len, pos);
+		else
+			ret = pread_full(bb->fd, bb->buf, len, pos);
+
+		if (ret < 0)
+			return ret;
+
+		return ret < len ? -EIO : 0;
+	}
+
+	block = (bb->cdev->offset + pos) >> blk->blockbits;
+	blocks = len >> blk->blockbits;
+
+	if (bb->write)
+		return blk->ops->write(blk, bb->buf, block, blocks);
+
+	return blk->ops->read(blk, bb->buf, block, blocks);
+}
+
+/*
+ * Block devices are accessed through their operations, so that neither
+ * the block cache nor its read-ahead is measured. The cache is written
+ * back and emptied first, so that it holds no stale data afterwards.
+ */
+static int blkbench_setup_blk(struct blkbench *bb, loff_t offset,
+			      loff_t *size, size_t bufsize)
+{
+	struct block_device *blk = bb->blk;
+	unsigned int blocksize = 1 << blk->blockbits;
+
+	if (!IS_ALIGNED(bb->cdev->offset + offset, blocksize) ||
+	    !IS_ALIGNED(bufsize, blocksize)) {
+		printf("offset and buffer size must be multiples of %u\n",
+		       blocksize);
+		return -EINVAL;
+	}
+
+	if (bb->write && !blk->ops->write)
+		return -EROFS;
+
+	*size = ALIGN_DOWN(*size, blocksize);
+
+	return block_invalidate(blk);
+}
+
+static int do_blkbench(int argc, char *argv[])
+{
+	struct blkbench bb = {};
+	loff_t size = 0, offset = 0, done = 0;
+	size_t bufsize = SZ_4M;
+	uint64_t start, ms;
+	bool random = false;
+	u32 slots = 0;
+	struct stat st;
+	const char *path;
+	int opt, ret = 0;
+
+	while ((opt = getopt(argc, argv, "s:b:o:rw")) > 0) {
+		switch (opt) {
+		case 's':
+			size = strtoull_suffix(optarg, NULL, 0);
+			break;
+		case 'b':
+			bufsize = strtoull_suffix(optarg, NULL, 0);
+			break;
+		case 'o':
+			offset = strtoull_suffix(optarg, NULL, 0);
+			break;
+		case 'r':
+			random = true;
+			break;
+		case 'w':
+			bb.write = true;
+			break;
+		default:
+			return COMMAND_ERROR_USAGE;
+		}
+	}
+
+	if (optind != argc - 1 || !bufsize)
+		return COMMAND_ERROR_USAGE;
+
+	path = argv[optind];
+
+	ret = stat(path, &st);
+	if (ret) {
+		printf("cannot stat %s: %m\n", path);
+		return COMMAND_ERROR;
+	}
+
+	if (offset >= st.st_size)
+		return COMMAND_ERROR_USAGE;
+
+	if (!size || size > st.st_size - offset)
+		size = st.st_size - offset;
+
+	bb.fd = open(path, bb.write ? O_RDWR : O_RDONLY);
+	if (bb.fd < 0) {
+		printf("cannot open %s: %m\n", path);
+		return COMMAND_ERROR;
+	}
+
+	/*
+	 * Use a DMA capable buffer, so block devices can transfer directly
+	 * into it.
+	 */
+	bb.buf = dma_alloc(bufsize);
+	memset(bb.buf, 0x5a, bufsize);
+
+	bb.cdev = cdev_by_name(devpath_to_name(path));
+	bb.blk = cdev_get_block_device(bb.cdev);
+	if (bb.blk) {
+		ret = blkbench_setup_blk(&bb, offset, &size, bufsize);
+		if (ret)
+			goto out;
+	}
+
+	/* random mode does size / bufsize transfers at bufsize aligned offsets */
+	if (random) {
+		slots = min_t(u64, div64_u64(size, bufsize), U32_MAX);
+		if (!slots) {
+			printf("size is smaller than the buffer size\n");
+			ret = -EINVAL;
+			goto out;
+		}
+		size = (loff_t)slots * bufsize;
+	}
+
+	start = get_time_ns();
+
+	while (done < size) {
+		size_t now = min_t(loff_t, bufsize, size - done);
+		loff_t pos = offset + done;
+
+		if (random)
+			pos = offset + (loff_t)prandom_u32_max(slots) * bufsize;
+
+		ret = blkbench_io(&bb, pos, now);
+		if (ret)
+			goto out;
+
+		done += now;
+
+		if (ctrlc()) {
+			ret = -EINTR;
+			goto out;
+		}
+	}
+
+	if (bb.write && !bb.blk) {
+		ret = flush(bb.fd);
+		if (ret)
+			goto out;
+	}
+
+	ms = max_t(uint64_t, div_u64(get_time_ns() - start, MSECOND), 1);
+
+	printf("%s %llu bytes %s in %llu ms: %llu KiB/s\n",
+	       bb.write ? "wrote" : "read", done,
+	       random ? "at random offsets" : "sequentially", ms,
+	       div64_u64(done * 1000 / SZ_1K, ms));
+
+	ret = 0;
+out:
+	dma_free(bb.buf);
+	close(bb.fd);
+
+	if (ret) {
+		printf("%s: %pe\n", path, ERR_PTR(ret));
+		return COMMAND_ERROR;
+	}
+
+	return 0;
+}
+
+BAREBOX_CMD_HELP_START(blkbench)
+BAREBOX_CMD_HELP_TEXT("Read or write a device or file and report the throughput.")
+BAREBOX_CMD_HELP_TEXT("Block devices are accessed without the block cache, so this")
+BAREBOX_CMD_HELP_TEXT("measures the raw driver performance. Their offset and buffer")
+BAREBOX_CMD_HELP_TEXT("size must be multiples of the block size.")
+BAREBOX_CMD_HELP_TEXT("")
+BAREBOX_CMD_HELP_TEXT("Options:")
+BAREBOX_CMD_HELP_OPT ("-s SIZE",    "number of bytes to transfer (default: up to the end)")
+BAREBOX_CMD_HELP_OPT ("-b BUFSIZE", "size of a single transfer (default: 4M)")
+BAREBOX_CMD_HELP_OPT ("-o OFFSET",  "start offset")
+BAREBOX_CMD_HELP_OPT ("-r",         "transfer at random BUFSIZE aligned offsets within SIZE")
+BAREBOX_CMD_HELP_OPT ("-w",         "write instead of read (destroys the data!)")
+BAREBOX_CMD_HELP_END
+
+BAREBOX_CMD_START(blkbench)
+	.cmd		= do_blkbench,
+	BAREBOX_CMD_DESC("measure read and write throughput")
+	BAREBOX_CMD_OPTS("[-rw] [-s SIZE] [-b BUFSIZE] [-o OFFSET] FILE")
+	BAREBOX_CMD_GROUP(CMD_GRP_MISC)
+	BAREBOX_CMD_HELP(cmd_blkbench_help)
+BAREBOX_CMD_END
@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: GPL-2.0-only
+
+/*
+ * boottime - show the boot time profile
+ */
+
+#include <common.h>
+#include <command.h>
+#include <getopt.h>
+#include <libfile.h>
+#include <malloc.h>
+#include <boot-profile.h>
+
+static int do_boottime(int argc, char *argv[])
+{
+	unsigned int flags = BOOT_PROFILE_SORTED, max = 0;
+	const char *outfile = NULL;
+	char *str;
+	int opt, ret = 0;
+
+	while ((opt = getopt(argc, argv, "cn:o:")) > 0) {
+		switch (opt) {
+		case 'c':
+			flags &= ~BOOT_PROFILE_SORTED;
+			break;
+		case 'n':
+			max = simple_strtoul(optarg, NULL, 0);
+			break;
+		case 'o':
+			outfile = optarg;
+			break;
+		default:
+			return COMMAND_ERROR_USAGE;
+		}
+	}
+
+	if (optind != argc)
+		return COMMAND_ERROR_USAGE;
+
+	str = boot_profile_format(flags, max);
+
+	if (outfile) {
+		ret = write_file(outfile, str, strlen(str));
+		if (ret)
+			printf("cannot write %s: %pe\n", outfile, ERR_PTR(ret));
+	} else {
+		printf("%s", str);
+	}
+
+	free(str);
+
+	return ret ? COMMAND_ERROR : 0;
+}
+
+BAREBOX_CMD_HELP_START(boottime)
+BAREBOX_CMD_HELP_TEXT("Print the initcalls, driver probes, init scripts and commands")
+BAREBOX_CMD_HELP_TEXT("recorded during startup. By default, entries are sorted by their")
+BAREBOX_CMD_HELP_TEXT("self time, i.e. excluding the time spent in nested entries.")
+BAREBOX_CMD_HELP_TEXT("")
+BAREBOX_CMD_HELP_TEXT("Options:")
+BAREBOX_CMD_HELP_OPT ("-c",       "print in chronological order, showing the nesting")
+BAREBOX_CMD_HELP_OPT ("-n COUNT", "print only the first COUNT entries")
+BAREBOX_CMD_HELP_OPT ("-o FILE",  "write the profile to FILE instead of the console")
+BAREBOX_CMD_HELP_END
+
+BAREBOX_CMD_START(boottime)
+	.cmd		= do_boottime,
+	BAREBOX_CMD_DESC("show where the time during startup went")
+	BAREBOX_CMD_OPTS("[-c] [-n COUNT] [-o FILE]")
+	BAREBOX_CMD_GROUP(CMD_GRP_INFO)
+	BAREBOX_CMD_HELP(cmd_boottime_help)
+BAREBOX_CMD_END
@@ -10,8 +10,11 @@
 #include <malloc.h>
 #include <linux/err.h>
 #include <linux/list.h>
+#include <linux/log2.h>
 #include <dma.h>
 #include <file-list.h>
+#include <param.h>
+#include <memory.h>
 
 #define BLOCKSIZE(blk)	(1 << blk->blockbits)
 
@@ -22,17 +25,69 @@ struct chunk {
 	void *data; /* data buffer */
 	sector_t block_start; /* first block in this chunk */
 	int dirty; /* need to write back to device */
-	int num; /* number of chunk, debugging only */
+	int num; /* index in blk->chunks */
 	struct list_head list;
+	struct hlist_node hash; /* entry in blk->chunk_hash while cached */
 };
 
 #define BUFSIZE (PAGE_SIZE * 16)
 
+#define BLOCK_CACHE_CHUNKS_DEFAULT	8
+#define BLOCK_CACHE_CHUNKS_MAX		4096
+#define BLOCK_READAHEAD_DEFAULT		4
+#define BLOCK_READAHEAD_MAX		16
+
 static int writebuffer_io_len(struct block_device *blk, struct chunk *chunk)
 {
 	return min_t(blkcnt_t, blk->rdbufsize, blk->num_blocks - chunk->block_start);
 }
 
+/*
+ * Chunks are aligned to rdbufsize, so the chunk index of a block is
+ * sufficient as key. Consecutive chunks end up in consecutive buckets.
+ */
+static struct hlist_head *chunk_bucket(struct block_device *blk, sector_t block)
+{
+	sector_t idx = block >> (ilog2(BUFSIZE) - blk->blockbits);
+
+	return &blk->chunk_hash[idx & (blk->chunk_hash_size - 1)];
+}
+
+static int chunk_writeback(struct block_device *blk, struct chunk *chunk)
+{
+	int ret;
+
+	ret = blk->ops->write(blk, chunk->data, chunk->block_start,
+			      writebuffer_io_len(blk, chunk));
+	if (ret < 0)
+		return ret;
+
+	chunk->dirty = 0;
+	blk->cache_writebacks++;
+
+	return 0;
+}
+
+/*
+ * Take a chunk out of the cache or the idle list, writing it back to
+ * the device first when it is dirty.
+ */
+static int chunk_evict(struct block_device *blk, struct chunk *chunk)
+{
+	int ret;
+
+	if (chunk->dirty) {
+		ret = chunk_writeback(blk, chunk);
+		if (ret < 0)
+			return ret;
+	}
+
+	hlist_del_init(&chunk->hash);
+	list_del(&chunk->list);
+
+	return 0;
+}
+
 /*
  * Write all dirty chunks back to the device
  */
@@ -46,13 +101,9 @@ static int writebuffer_flush(struct block_device *blk)
 
 	list_for_each_entry(chunk, &blk->buffered_blocks, list) {
 		if (chunk->dirty) {
-			ret = blk->ops->write(blk, chunk->data,
-					      chunk->block_start,
-					      writebuffer_io_len(blk, chunk));
+			ret = chunk_writeback(blk, chunk);
 			if (ret < 0)
 				return ret;
-
-			chunk->dirty = 0;
 		}
 	}
 
@@ -70,7 +121,7 @@ static struct chunk *chunk_get_cached(struct block_device *blk, sector_t block)
 {
 	struct chunk *chunk;
 
-	list_for_each_entry(chunk, &blk->buffered_blocks, list) {
+	hlist_for_each_entry(chunk, chunk_bucket(blk, block), hash) {
 		if (block >= chunk->block_start &&
 				block < chunk->block_start + blk->rdbufsize) {
 			dev_dbg(blk->dev, "%s: found %llu in %d\n", __func__,
@@ -111,25 +162,98 @@ static struct chunk *get_chunk(struct block_device *blk)
 	struct chunk *chunk;
 	int ret;
 
-	if (list_empty(&blk->idle_blocks)) {
+	if (list_empty(&blk->idle_blocks))
 		/* use last entry which is the most unused */
 		chunk = list_last_entry(&blk->buffered_blocks, struct chunk, list);
-		if (chunk->dirty) {
-			ret = blk->ops->write(blk, chunk->data,
-					      chunk->block_start,
-					      writebuffer_io_len(blk, chunk));
-			if (ret < 0)
-				return ERR_PTR(ret);
+	else
+		chunk = list_first_entry(&blk->idle_blocks, struct chunk, list);
 
-			chunk->dirty = 0;
-		}
-	} else {
+	ret = chunk_evict(blk, chunk);
+	if (ret)
+		return ERR_PTR(ret);
+
+	return chunk;
+}
+
+/*
+ * Read the chunk containing @block and the chunks following it with a
+ * single request to the device. Stops at the first chunk that is cached
+ * already. Returns the number of chunks read, 0 if read-ahead is not
+ * worthwhile here, or a negative error code.
+ *
+ * The data is read directly into the cache. The chunks of a group share
+ * one contiguous buffer, so the request goes to consecutive chunks of the
+ * group containing the chunk that would be reused next.
+ */
+static int block_cache_readahead(struct block_device *blk, sector_t block)
+{
+	sector_t start = block & ~blk->blkmask;
+	unsigned int max, n, i = 0, first, last;
+	struct chunk *chunk;
+	blkcnt_t len;
+	int ret;
+
+	if (blk->discard_size)
+		return 0;
+
+	max = min3(blk->readahead, blk->cache_chunks / 2,
+		   (u32)BLOCK_READAHEAD_MAX);
+
+	for (n = 0; n < max; n++) {
+		sector_t s = start + n * blk->rdbufsize;
+
+		if (s >= blk->num_blocks)
+			break;
+		if (n && chunk_get_cached(blk, s))
+			break;
+	}
+
+	if (n < 2)
+		return 0;
+
+	if (list_empty(&blk->idle_blocks))
+		chunk = list_last_entry(&blk->buffered_blocks, struct chunk, list);
+	else
 		chunk = list_first_entry(&blk->idle_blocks, struct chunk, list);
+
+	first = round_down(chunk->num, BLOCK_READAHEAD_MAX);
+	last = min_t(unsigned int, first + BLOCK_READAHEAD_MAX, blk->cache_chunks);
+	n = min(n, last - first);
+	if (n < 2)
+		return 0;
+
+	first = min_t(unsigned int, chunk->num, last - n);
+
+	for (i = 0; i < n; i++) {
+		ret = chunk_evict(blk, &blk->chunks[first + i]);
+		if (ret)
+			goto err;
 	}
 
-	list_del(&chunk->list);
+	len = min_t(blkcnt_t, n * blk->rdbufsize, blk->num_blocks - start);
 
-	return chunk;
+	dev_dbg(blk->dev, "%s: %llu, %u chunks to %u\n", __func__, start, n,
+		first);
+
+	ret = blk->ops->read(blk, blk->chunks[first].data, start, len);
+	if (ret)
+		goto err;
+
+	/* add in reverse order so that the requested chunk becomes the MRU */
+	while (n--) {
+		chunk = &blk->chunks[first + n];
+
+		chunk->block_start = start + n * blk->rdbufsize;
+		list_add(&chunk->list, &blk->buffered_blocks);
+		hlist_add_head(&chunk->hash, chunk_bucket(blk, chunk->block_start));
+	}
+
+	return i;
+err:
+	while (i--)
+		list_add_tail(&blk->chunks[first + i].list, &blk->idle_blocks);
+
+	return ret;
 }
 
 /*
@@ -142,6 +266,12 @@ static int block_cache(struct block_device *blk, sector_t block)
 	struct chunk *chunk;
 	int ret;
 
+	if (blk->readahead_active) {
+		ret = block_cache_readahead(blk, block);
+		if (ret)
+			return ret < 0 ? ret : 0;
+	}
+
 	chunk = get_chunk(blk);
 	if (IS_ERR(chunk))
 		return PTR_ERR(chunk);
@@ -155,8 +285,7 @@ static int block_cache(struct block_device *blk, sector_t block)
 	    chunk->block_start * BLOCKSIZE(blk) + writebuffer_io_len(blk, chunk)
 	    <= blk->discard_start + blk->discard_size) {
 		memset(chunk->data, 0, writebuffer_io_len(blk, chunk));
-		list_add(&chunk->list, &blk->buffered_blocks);
-		return 0;
+		goto out;
 	}
 
 	ret = blk->ops->read(blk, chunk->data, chunk->block_start,
@@ -165,7 +294,9 @@ static int block_cache(struct block_device *blk, sector_t block)
 		list_add_tail(&chunk->list, &blk->idle_blocks);
 		return ret;
 	}
+out:
 	list_add(&chunk->list, &blk->buffered_blocks);
+	hlist_add_head(&chunk->hash, chunk_bucket(blk, chunk->block_start));
 
 	return 0;
 }
@@ -183,8 +314,12 @@ static void *block_get(struct block_device *blk, sector_t block)
 		return ERR_PTR(-ENXIO);
 
 	outdata = block_get_cached(blk, block);
-	if (outdata)
+	if (outdata) {
+		blk->cache_hits++;
 		return outdata;
+	}
+
+	blk->cache_misses++;
 
 	ret = block_cache(blk, block);
 	if (ret)
@@ -197,14 +332,74 @@ static void *block_get(struct block_device *blk, sector_t block)
 	return outdata;
 }
 
-static ssize_t block_op_read(struct cdev *cdev, void *buf, size_t count,
-		loff_t offset, unsigned long flags)
+/*
+ * The drivers map the buffers they get for DMA, which is only safe for
+ * memory from the malloc area (where dma_alloc() takes its buffers from)
+ * that doesn't share cache lines with other data and that the device can
+ * address.
+ */
+static bool block_buf_dma_capable(struct block_device *blk, void *buf,
+				  size_t len)
+{
+	unsigned long start = (unsigned long)buf;
+
+	if (!IS_ALIGNED(start, DMA_ALIGNMENT) || !IS_ALIGNED(len, DMA_ALIGNMENT))
+		return false;
+
+	if (start < mem_malloc_start() || start + len - 1 > mem_malloc_end())
+		return false;
+
+	return !dma_mapping_error(blk->dev, cpu_to_dma(blk->dev, buf + len - 1));
+}
+
+/*
+ * Large reads are not worth caching. Read them directly into the
+ * caller's buffer when it is suitable for DMA.
+ */
+static bool block_read_can_bypass(struct block_device *blk, void *buf,
+				  blkcnt_t blocks)
+{
+	if (blk->discard_size)
+		return false;
+
+	if (blocks < (blkcnt_t)blk->cache_chunks * blk->rdbufsize)
+		return false;
+
+	return block_buf_dma_capable(blk, buf, blocks << blk->blockbits);
+}
+
+static int block_read_direct(struct block_device *blk, void *buf,
+			     sector_t block, blkcnt_t blocks)
+{
+	struct chunk *chunk;
+	int ret;
+
+	/* make sure the device has the data we may still hold in the cache */
+	list_for_each_entry(chunk, &blk->buffered_blocks, list) {
+		if (!chunk->dirty)
+			continue;
+		if (chunk->block_start >= block + blocks ||
+		    chunk->block_start + blk->rdbufsize <= block)
+			continue;
+
+		ret = chunk_writeback(blk, chunk);
+		if (ret)
+			return ret;
+	}
+
+	dev_dbg(blk->dev, "%s: %llu, %llu blocks\n", __func__, block, blocks);
+
+	return blk->ops->read(blk, buf, block, blocks);
+}
+
+static ssize_t __block_op_read(struct block_device *blk, void *buf, size_t count,
+			       loff_t offset)
 {
-	struct block_device *blk = cdev->priv;
 	unsigned long mask = BLOCKSIZE(blk) - 1;
 	sector_t block = offset >> blk->blockbits;
 	size_t icount = count;
 	blkcnt_t blocks;
+	int ret;
 
 	if (offset & mask) {
 		size_t now = BLOCKSIZE(blk) - (offset & mask);
@@ -223,6 +418,17 @@ static ssize_t block_op_read(struct cdev *cdev, void *buf, size_t count,
 
 	blocks = count >> blk->blockbits;
 
+	if (block_read_can_bypass(blk, buf, blocks)) {
+		ret = block_read_direct(blk, buf, block, blocks);
+		if (ret)
+			return ret;
+
+		buf += blocks << blk->blockbits;
+		block += blocks;
+		count -= blocks << blk->blockbits;
+		blocks = 0;
+	}
+
 	while (blocks) {
 		void *iobuf = block_get(blk, block);
 
@@ -248,6 +454,27 @@ static ssize_t block_op_read(struct cdev *cdev, void *buf, size_t count,
 	return icount;
 }
 
+static ssize_t block_op_read(struct cdev *cdev, void *buf, size_t count,
+		loff_t offset, unsigned long flags)
+{
+	struct block_device *blk = cdev->priv;
+	ssize_t ret;
+
+	/*
+	 * A read continuing where the last one stopped is likely followed
+	 * by more. Fetch several chunks at once on cache misses then.
+	 */
+	blk->readahead_active = blk->readahead && offset == blk->readahead_next;
+
+	ret = __block_op_read(blk, buf, count, offset);
+
+	blk->readahead_active = false;
+	if (ret > 0)
+		blk->readahead_next = offset + ret;
+
+	return ret;
+}
+
 #ifdef CONFIG_BLOCK_WRITE
 
 /*
@@ -371,11 +598,161 @@ struct block_device *cdev_get_block_device(const struct cdev *cdev)
 	return cdev->priv;
 }
 
+static void block_cache_free(struct block_device *blk)
+{
+	int i;
+
+	for (i = 0; i < blk->chunk_groups; i++)
+		dma_free(blk->chunk_mem[i]);
+
+	free(blk->chunk_mem);
+	blk->chunk_mem = NULL;
+	blk->chunk_groups = 0;
+
+	free(blk->chunks);
+	blk->chunks = NULL;
+
+	INIT_LIST_HEAD(&blk->buffered_blocks);
+	INIT_LIST_HEAD(&blk->idle_blocks);
+
+	free(blk->chunk_hash);
+	blk->chunk_hash = NULL;
+}
+
+/*
+ * The chunks are allocated in groups of BLOCK_READAHEAD_MAX sharing one
+ * buffer, so read-ahead can fill consecutive chunks with a single request.
+ */
+static void block_cache_alloc(struct block_device *blk)
+{
+	int i;
+
+	blk->chunk_hash_size = roundup_pow_of_two(blk->cache_chunks);
+	blk->chunk_hash = xzalloc(blk->chunk_hash_size * sizeof(*blk->chunk_hash));
+
+	blk->chunks = xzalloc(blk->cache_chunks * sizeof(*blk->chunks));
+	blk->chunk_groups = DIV_ROUND_UP(blk->cache_chunks, BLOCK_READAHEAD_MAX);
+	blk->chunk_mem = xzalloc(blk->chunk_groups * sizeof(*blk->chunk_mem));
+
+	for (i = 0; i < blk->cache_chunks; i++) {
+		struct chunk *chunk = &blk->chunks[i];
+		int group = i / BLOCK_READAHEAD_MAX;
+
+		if (!(i % BLOCK_READAHEAD_MAX))
+			blk->chunk_mem[group] = dma_alloc(BUFSIZE *
+				min_t(int, blk->cache_chunks - i, BLOCK_READAHEAD_MAX));
+
+		chunk->data = blk->chunk_mem[group] +
+			      (i % BLOCK_READAHEAD_MAX) * BUFSIZE;
+		chunk->num = i;
+		INIT_HLIST_NODE(&chunk->hash);
+		list_add_tail(&chunk->list, &blk->idle_blocks);
+	}
+}
+
+static int block_set_cache_chunks(struct param_d *p, void *priv)
+{
+	struct block_device *blk = priv;
+	int ret;
+
+	if (blk->cache_chunks < 1 || blk->cache_chunks > BLOCK_CACHE_CHUNKS_MAX)
+		return -EINVAL;
+
+	ret = writebuffer_flush(blk);
+	if (ret)
+		return ret;
+
+	block_cache_free(blk);
+	block_cache_alloc(blk);
+
+	return 0;
+}
+
+static int block_set_readahead(struct param_d *p, void *priv)
+{
+	struct block_device *blk = priv;
+
+	if (blk->readahead > BLOCK_READAHEAD_MAX)
+		return -EINVAL;
+
+	return 0;
+}
+
+/*
+ * Several block devices may share a single device (e.g. the boot
+ * partitions of an eMMC), so prefix the parameters with the part of
+ * the cdev name that differs from the device name.
+ */
+static struct param_d *block_add_param(struct block_device *blk, const char *name,
+				       int (*set)(struct param_d *p, void *priv),
+				       void *value, enum param_type type)
+{
+	const char *devname = dev_name(blk->dev);
+	const char *cdevname = blk->cdev.name;
+	size_t len = strlen(devname);
+	struct param_d *p;
+	char *pname;
+
+	if (!strcmp(cdevname, devname)) {
+		pname = xstrdup(name);
+	} else {
+		if (!strncmp(cdevname, devname, len) && cdevname[len] == '.')
+			cdevname += len + 1;
+		pname = xasprintf("%s.%s", cdevname, name);
+	}
+
+	p = __dev_add_param_int(blk->dev, pname, set, NULL, value, type,
+				type == PARAM_TYPE_UINT64 ? "%llu" : "%u", blk);
+
+	free(pname);
+
+	return p;
+}
+
+static void block_register_params(struct block_device *blk)
+{
+	if (!blk->dev || !blk->cdev.name)
+		return;
+
+	blk->param_cache_chunks = block_add_param(blk, "cache_chunks",
+				block_set_cache_chunks, &blk->cache_chunks,
+				PARAM_TYPE_UINT32);
+	blk->param_readahead = block_add_param(blk, "readahead",
+				block_set_readahead, &blk->readahead,
+				PARAM_TYPE_UINT32);
+	blk->param_cache_hits = block_add_param(blk, "cache_hits",
+				param_set_readonly, &blk->cache_hits,
+				PARAM_TYPE_UINT64);
+	blk->param_cache_misses = block_add_param(blk, "cache_misses",
+				param_set_readonly, &blk->cache_misses,
+				PARAM_TYPE_UINT64);
+	blk->param_cache_writebacks = block_add_param(blk, "cache_writebacks",
+				param_set_readonly, &blk->cache_writebacks,
+				PARAM_TYPE_UINT64);
+}
+
+static void block_unregister_params(struct block_device *blk)
+{
+	struct param_d **params[] = {
+		&blk->param_cache_chunks,
+		&blk->param_readahead,
+		&blk->param_cache_hits,
+		&blk->param_cache_misses,
+		&blk->param_cache_writebacks,
+	};
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(params); i++) {
+		if (!IS_ERR_OR_NULL(*params[i]))
+			dev_remove_param(*params[i]);
+		*params[i] = NULL;
+	}
+}
+
 int blockdevice_register(struct block_device *blk)
 {
 	loff_t size = (loff_t)blk->num_blocks * BLOCKSIZE(blk);
 	int ret;
-	int i;
 
 	blk->cdev.size = size;
 	blk->cdev.dev = blk->dev;
@@ -395,19 +772,24 @@ int blockdevice_register(struct block_device *blk)
 		return -ENOSYS;
 	}
 
-	for (i = 0; i < 8; i++) {
-		struct chunk *chunk = xzalloc(sizeof(*chunk));
-		chunk->data = dma_alloc(BUFSIZE);
-		chunk->num = i;
-		list_add_tail(&chunk->list, &blk->idle_blocks);
-	}
+	if (!blk->cache_chunks)
+		blk->cache_chunks = BLOCK_CACHE_CHUNKS_DEFAULT;
+	if (!blk->readahead)
+		blk->readahead = BLOCK_READAHEAD_DEFAULT;
+	blk->readahead_next = -1;
+
+	block_cache_alloc(blk);
 
 	ret = devfs_create(&blk->cdev);
-	if (ret)
+	if (ret) {
+		block_cache_free(blk);
 		return ret;
+	}
 
 	list_add_tail(&blk->list, &block_device_list);
 
+	block_register_params(blk);
+
 	cdev_create_default_automount(&blk->cdev);
 
 	/* Lack of partition table is unusual, but not a failure */
@@ -418,19 +800,10 @@ int blockdevice_register(struct block_device *blk)
 
 int blockdevice_unregister(struct block_device *blk)
 {
-	struct chunk *chunk, *tmp;
-
 	writebuffer_flush(blk);
 
-	list_for_each_entry_safe(chunk, tmp, &blk->buffered_blocks, list) {
-		dma_free(chunk->data);
-		free(chunk);
-	}
-
-	list_for_each_entry_safe(chunk, tmp, &blk->idle_blocks, list) {
-		dma_free(chunk->data);
-		free(chunk);
-	}
+	block_unregister_params(blk);
+	block_cache_free(blk);
 
 	devfs_remove(&blk->cdev);
 	list_del(&blk->list);
@@ -460,6 +833,30 @@ int block_write(struct block_device *blk, void *buf, sector_t block, blkcnt_t nu
 	return ret < 0 ? ret : 0;
 }
 
+/*
+ * Write back all dirty chunks and drop the cache contents, so that the next
+ * access goes to the device. For users that call the device operations
+ * directly and must neither miss cached writes nor see stale data later.
+ */
+int block_invalidate(struct block_device *blk)
+{
+	struct chunk *chunk, *tmp;
+	int ret;
+
+	ret = writebuffer_flush(blk);
+	if (ret)
+		return ret;
+
+	list_for_each_entry_safe(chunk, tmp, &blk->buffered_blocks, list) {
+		hlist_del_init(&chunk->hash);
+		list_move_tail(&chunk->list, &blk->idle_blocks);
+	}
+
+	blk->readahead_next = -1;
+
+	return 0;
+}
+
 unsigned file_list_add_blockdevs(struct file_list *files)
 {
 	struct block_device *blk;
@@ -0,0 +1,292 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * boot-profile.c - record where the time during startup goes
+ *
+ * Initcalls, driver probes, init scripts and the commands they run are
+ * timed from power-on until the interactive shell is reached or the
+ * kernel is started. Entries nest: the time spent in a probe triggered
+ * from within another probe or command is accounted to both as total
+ * time, but only to the innermost one as self time.
+ */
+
+#define pr_fmt(fmt) "boot-profile: " fmt
+
+#include <common.h>
+#include <clock.h>
+#include <init.h>
+#include <malloc.h>
+#include <of.h>
+#include <qsort.h>
+#include <boot-profile.h>
+#include <linux/math64.h>
+
+#define BOOT_PROFILE_MAX_ENTRIES	4096
+#define BOOT_PROFILE_MAX_DEPTH		32
+#define BOOT_PROFILE_OF_TOP		16
+
+struct boot_profile_entry {
+	enum boot_profile_type type;
+	const void *fn;
+	char *name;
+	u64 start;
+	u64 total;
+	u64 self;
+	int result;
+	unsigned int depth;
+};
+
+static struct boot_profile_entry *entries;
+static unsigned int num_entries, max_entries;
+static unsigned int dropped;
+static bool stopped;
+
+/* time spent in nested entries, per nesting level */
+static u64 child_ns[BOOT_PROFILE_MAX_DEPTH];
+static unsigned int depth;
+
+static const char * const type_names[] = {
+	[BOOT_PROFILE_INITCALL] = "initcall",
+	[BOOT_PROFILE_PROBE] = "probe",
+	[BOOT_PROFILE_SCRIPT] = "script",
+	[BOOT_PROFILE_COMMAND] = "command",
+};
+
+/**
+ * boot_profile_begin - start timing an entry
+ *
+ * Return: the start time to pass to boot_profile_end()
+ */
+u64 boot_profile_begin(void)
+{
+	if (stopped)
+		return 0;
+
+	if (depth < BOOT_PROFILE_MAX_DEPTH)
+		child_ns[depth] = 0;
+	depth++;
+
+	return get_time_ns();
+}
+
+/**
+ * boot_profile_end - record an entry
+ * @type: what has been timed
+ * @fn: function for initcalls, printed with %pS, may be NULL
+ * @start: the value returned from the matching boot_profile_begin()
+ * @result: return value of the timed operation
+ * @fmt: printf format for the description of the entry, may be NULL if
+ *       @fn is given
+ */
+void boot_profile_end(enum boot_profile_type type, const void *fn,
+		      u64 start, int result, const char *fmt, ...)
+{
+	struct boot_profile_entry *e;
+	u64 total, self;
+	va_list args;
+
+	if (stopped || !depth)
+		return;
+
+	total = get_time_ns() - start;
+
+	depth--;
+	self = total;
+	if (depth < BOOT_PROFILE_MAX_DEPTH && child_ns[depth] <= total)
+		self -= child_ns[depth];
+	if (depth && depth - 1 < BOOT_PROFILE_MAX_DEPTH)
+		child_ns[depth - 1] += total;
+
+	if (num_entries == max_entries) {
+		unsigned int n = max_entries ? max_entries * 2 : 256;
+		void *p;
+
+		n = min_t(unsigned int, n, BOOT_PROFILE_MAX_ENTRIES);
+		p = n > max_entries ? realloc(entries, n * sizeof(*e)) : NULL;
+		if (!p) {
+			dropped++;
+			return;
+		}
+
+		entries = p;
+		max_entries = n;
+	}
+
+	e = &entries[num_entries++];
+	e->type = type;
+	e->fn = fn;
+	e->name = NULL;
+	if (fmt) {
+		va_start(args, fmt);
+		e->name = bvasprintf(fmt, args);
+		va_end(args);
+	}
+	e->start = start;
+	e->total = total;
+	e->self = self;
+	e->result = result;
+	e->depth = depth;
+}
+
+/**
+ * boot_profile_stop - stop recording
+ *
+ * Called once the boot is over, so that interactive use doesn't fill up
+ * the profile.
+ */
+void boot_profile_stop(void)
+{
+	if (stopped)
+		return;
+
+	stopped = true;
+
+	pr_debug("%u entries recorded, %u dropped\n", num_entries, dropped);
+}
+
+static int boot_profile_cmp(const void *a, const void *b)
+{
+	const struct boot_profile_entry *ea = a, *eb = b;
+
+	if (ea->self == eb->self)
+		return 0;
+
+	return ea->self < eb->self ? 1 : -1;
+}
+
+static char *boot_profile_entry_name(const struct boot_profile_entry *e)
+{
+	if (e->fn)
+		return xasprintf("%pS", e->fn);
+
+	return xstrdup(e->name ?: "");
+}
+
+/**
+ * boot_profile_format - format the recorded profile as text
+ * @flags: BOOT_PROFILE_SORTED to sort by self time, otherwise chronological
+ * @max: maximum number of entries to print, 0 for all
+ *
+ * Return: an allocated string, to be freed by the caller
+ */
+char *boot_profile_format(unsigned int flags, unsigned int max)
+{
+	struct boot_profile_entry *sorted;
+	u64 sum[BOOT_PROFILE_NUM_TYPES] = {};
+	char *str = xstrdup(""), *tmp;
+	unsigned int i;
+
+	sorted = xmemdup(entries, num_entries * sizeof(*entries));
+
+	if (flags & BOOT_PROFILE_SORTED)
+		qsort(sorted, num_entries, sizeof(*sorted), boot_profile_cmp);
+
+	if (!max || max > num_entries)
+		max = num_entries;
+
+	tmp = str;
+	str = xasprintf("%s%10s %10s %10s  %-8s %s\n", tmp, "start/us",
+			"total/us", "self/us", "type", "name");
+	free(tmp);
+
+	for (i = 0; i < max; i++) {
+		struct boot_profile_entry *e = &sorted[i];
+		char *name = boot_profile_entry_name(e);
+
+		tmp = str;
+		str = xasprintf("%s%10llu %10llu %10llu  %-8s %*s%s%s\n", tmp,
+				div_u64(e->start, USECOND),
+				div_u64(e->total, USECOND),
+				div_u64(e->self, USECOND),
+				type_names[e->type],
+				flags & BOOT_PROFILE_SORTED ? 0 : e->depth * 2, "",
+				name,
+				e->result ? " (failed)" : "");
+		free(tmp);
+		free(name);
+	}
+
+	for (i = 0; i < num_entries; i++)
+		sum[entries[i].type] += entries[i].self;
+
+	tmp = str;
+	str = xasprintf("%s\ntotal self time: initcalls %llu us, probes %llu us, "
+			"scripts %llu us, commands %llu us%s\n", tmp,
+			div_u64(sum[BOOT_PROFILE_INITCALL], USECOND),
+			div_u64(sum[BOOT_PROFILE_PROBE], USECOND),
+			div_u64(sum[BOOT_PROFILE_SCRIPT], USECOND),
+			div_u64(sum[BOOT_PROFILE_COMMAND], USECOND),
+			dropped ? " (profile incomplete)" : "");
+	free(tmp);
+
+	free(sorted);
+
+	return str;
+}
+
+/*
+ * Pass a summary and the most expensive entries to the kernel, so that
+ * the boot time can be analyzed together with the kernel's own data.
+ */
+static int boot_profile_of_fixup(struct device_node *root, void *unused)
+{
+	struct boot_profile_entry *sorted;
+	struct device_node *node;
+	u64 sum[BOOT_PROFILE_NUM_TYPES] = {};
+	unsigned int i, n;
+	size_t len;
+	char *top;
+	int ret;
+
+	node = of_create_node(root, "/chosen/barebox-boot-profile");
+	if (!node)
+		return -ENOMEM;
+
+	for (i = 0; i < num_entries; i++)
+		sum[entries[i].type] += entries[i].self;
+
+	of_property_write_u32(node, "total-us",
+			      div_u64(get_time_ns(), USECOND));
+	of_property_write_u32(node, "initcalls-us",
+			      div_u64(sum[BOOT_PROFILE_INITCALL], USECOND));
+	of_property_write_u32(node, "probes-us",
+			      div_u64(sum[BOOT_PROFILE_PROBE], USECOND));
+	of_property_write_u32(node, "scripts-us",
+			      div_u64(sum[BOOT_PROFILE_SCRIPT], USECOND));
+	of_property_write_u32(node, "commands-us",
+			      div_u64(sum[BOOT_PROFILE_COMMAND], USECOND));
+
+	sorted = xmemdup(entries, num_entries * sizeof(*entries));
+	qsort(sorted, num_entries, sizeof(*sorted), boot_profile_cmp);
+
+	/* "top" is a stringlist of "<type> <name> <self-us>" entries */
+	n = min_t(unsigned int, num_entries, BOOT_PROFILE_OF_TOP);
+	top = xstrdup("");
+	len = 0;
+
+	for (i = 0; i < n; i++) {
+		char *name = boot_profile_entry_name(&sorted[i]);
+		char *str = xasprintf("%s %s %llu", type_names[sorted[i].type],
+				      name, div_u64(sorted[i].self, USECOND));
+		size_t slen = strlen(str) + 1;
+
+		top = xrealloc(top, len + slen);
+		memcpy(top + len, str, slen);
+		len += slen;
+
+		free(str);
+		free(name);
+	}
+
+	ret = len ? of_set_property(node, "top", top, len, 1) : 0;
+
+	free(top);
+	free(sorted);
+
+	return ret;
+}
+
+static int boot_profile_init(void)
+{
+	return of_register_fixup(boot_profile_of_fixup, NULL);
+}
+late_initcall(boot_profile_init);
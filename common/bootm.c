@@ -362,7 +362,8 @@ void *bootm_get_devicetree(struct image_data *data)
 		if (ret)
 			return ERR_PTR(ret);
 
-		data->of_root_node = of_unflatten_dtb(of_tree, of_size);
+		/* the FIT image stays open until the tree is deleted */
+		data->of_root_node = of_unflatten_dtb_const(of_tree, of_size);
 	} else if (data->oftree_file) {
 		size_t size;
 
@@ -390,11 +391,9 @@ void *bootm_get_devicetree(struct image_data *data)
 		if (ret)
 			return ERR_PTR(ret);
 
-		data->of_root_node = of_unflatten_dtb(oftree, size);
-
-		free(oftree);
-
+		data->of_root_node = of_unflatten_dtb_owned(oftree, size);
 		if (IS_ERR(data->of_root_node)) {
+			free(oftree);
 			data->of_root_node = NULL;
 			pr_err("unable to unflatten devicetree\n");
 			return ERR_PTR(-EINVAL);
@@ -833,10 +832,10 @@ int bootm_boot(struct bootm_data *bootm_data)
 		uimage_close(data->os);
 	if (IS_ENABLED(CONFIG_ELF) && data->elf)
 		elf_close(data->elf);
-	if (IS_ENABLED(CONFIG_FITIMAGE) && data->os_fit)
-		fit_close(data->os_fit);
 	if (data->of_root_node && data->of_root_node != of_get_root_node())
 		of_delete_node(data->of_root_node);
+	if (IS_ENABLED(CONFIG_FITIMAGE) && data->os_fit)
+		fit_close(data->os_fit);
 
 	globalvar_remove("linux.bootargs.bootm.earlycon");
 	globalvar_remove("linux.bootargs.bootm.appendroot");
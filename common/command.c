@@ -17,6 +17,7 @@
 #include <init.h>
 #include <complete.h>
 #include <getopt.h>
+#include <boot-profile.h>
 
 LIST_HEAD(command_list);
 EXPORT_SYMBOL(command_list);
@@ -53,13 +54,18 @@ int execute_command(int argc, char **argv)
 	struct command *cmdtp;
 	int ret;
 	struct getopt_context gc;
+	u64 start;
 
 	getopt_context_store(&gc);
 
 	/* Look up command in command table */
 	if ((cmdtp = find_cmd(argv[0]))) {
 		/* OK - call function to do the command */
+		start = boot_profile_begin();
 		ret = cmdtp->cmd(argc, argv);
+		boot_profile_end(BOOT_PROFILE_COMMAND, NULL, start, ret,
+				 "%s%s%s", argv[0], argc > 1 ? " " : "",
+				 argc > 1 ? argv[1] : "");
 		if (ret == COMMAND_ERROR_USAGE) {
 			barebox_cmd_usage(cmdtp);
 			ret = COMMAND_ERROR;
@@ -205,6 +205,8 @@ void fastboot_generic_free(struct fastboot *fb)
 	}
 
 	free(fb->tempname);
+	free(fb->stream_partition);
+	fb->stream_partition = NULL;
 
 	fb->active = false;
 }
@@ -320,14 +322,35 @@ static void cb_getvar(struct fastboot *fb, const char *cmd)
 	fastboot_tx_print(fb, FASTBOOT_MSG_OKAY, "");
 }
 
+/* sparse image streaming, see struct fastboot_stream */
+static bool fastboot_stream_wanted(struct fastboot *fb, const void *buffer,
+				   unsigned int len);
+static int fastboot_stream_start(struct fastboot *fb);
+static int fastboot_stream_feed(struct fastboot *fb, const void *buffer,
+				unsigned int len);
+static int fastboot_stream_finish(struct fastboot *fb);
+static void fastboot_stream_free(struct fastboot *fb);
+
 int fastboot_handle_download_data(struct fastboot *fb, const void *buffer,
 				  unsigned int len)
 {
 	int ret;
 
-	ret = write(fb->download_fd, buffer, len);
-	if (ret < 0)
-		return ret;
+	if (!fb->download_bytes && fastboot_stream_wanted(fb, buffer, len)) {
+		ret = fastboot_stream_start(fb);
+		if (ret)
+			return ret;
+	}
+
+	if (fb->stream) {
+		ret = fastboot_stream_feed(fb, buffer, len);
+		if (ret)
+			return ret;
+	} else {
+		ret = write(fb->download_fd, buffer, len);
+		if (ret < 0)
+			return ret;
+	}
 
 	fb->download_bytes += len;
 	show_progress(fb->download_bytes);
@@ -341,8 +364,19 @@ void fastboot_download_finished(struct fastboot *fb)
 
 	printf("\n");
 
-	fastboot_tx_print(fb, FASTBOOT_MSG_INFO, "Downloading %d bytes finished",
-			  fb->download_bytes);
+	if (fb->stream) {
+		int ret = fastboot_stream_finish(fb);
+
+		if (ret) {
+			fastboot_tx_print(fb, FASTBOOT_MSG_FAIL,
+					  "writing sparse image: %s",
+					  strerror(-ret));
+			return;
+		}
+	}
+
+	fastboot_tx_print(fb, FASTBOOT_MSG_INFO,
+			  "Downloading %d bytes finished", fb->download_bytes);
 
 	fastboot_tx_print(fb, FASTBOOT_MSG_OKAY, "");
 }
@@ -354,6 +388,10 @@ void fastboot_abort(struct fastboot *fb)
 		fb->download_fd = 0;
 	}
 
+	fastboot_stream_free(fb);
+	free(fb->stream_partition);
+	fb->stream_partition = NULL;
+
 	fb->active = false;
 
 	unlink(fb->tempname);
@@ -364,13 +402,16 @@ static void cb_download(struct fastboot *fb, const char *cmd)
 	fb->download_size = simple_strtoul(cmd, NULL, 16);
 	fb->download_bytes = 0;
 
+	fastboot_stream_free(fb);
+
 	fastboot_tx_print(fb, FASTBOOT_MSG_INFO, "Downloading %d bytes...",
 			  fb->download_size);
 
 	init_progression_bar(fb->download_size);
 
 	if (fb->download_fd > 0) {
-		pr_err("%s called and %s is still opened\n", __func__, fb->tempname);
+		pr_err("%s called and %s is still opened\n", __func__,
+		       fb->tempname);
 		close(fb->download_fd);
 	}
 
@@ -506,16 +547,20 @@ static int check_ubi(struct fastboot *fb, struct file_list_entry *fentry,
 	}
 }
 
-static int fastboot_handle_sparse(struct fastboot *fb,
-				  struct file_list_entry *fentry)
+struct fastboot_sparse_target {
+	struct fastboot *fb;
+	struct file_list_entry *fentry;
+	struct mtd_info *mtd;
+	int fd;
+};
+
+static int fastboot_sparse_target_open(struct fastboot_sparse_target *t,
+				       loff_t size)
 {
-	struct sparse_image_ctx *sparse;
-	void *buf = NULL;
-	int ret, fd;
+	struct file_list_entry *fentry = t->fentry;
 	unsigned int flags = O_RDWR;
-	int bufsiz = SZ_128K;
 	struct stat s;
-	struct mtd_info *mtd = NULL;
+	int ret;
 
 	ret = stat(fentry->filename, &s);
 	if (ret) {
@@ -525,26 +570,103 @@ static int fastboot_handle_sparse(struct fastboot *fb,
 			return ret;
 	}
 
-	fd = open(fentry->filename, flags);
-	if (fd < 0)
+	t->fd = open(fentry->filename, flags);
+	if (t->fd < 0)
 		return -errno;
 
-	ret = fstat(fd, &s);
+	ret = fstat(t->fd, &s);
 	if (ret)
-		goto out_close_fd;
+		goto err;
+
+	if (S_ISREG(s.st_mode)) {
+		ret = ftruncate(t->fd, size);
+		if (ret)
+			goto err;
+	}
+
+	if (fentry->flags & FILE_LIST_FLAG_UBI) {
+		t->mtd = get_mtd(t->fb, fentry->filename);
+		if (IS_ERR(t->mtd)) {
+			ret = PTR_ERR(t->mtd);
+			goto err;
+		}
+	}
+
+	return 0;
+err:
+	close(t->fd);
+	t->fd = -1;
+
+	return ret;
+}
+
+static int fastboot_sparse_target_write(struct fastboot_sparse_target *t,
+					const void *buf, size_t len, loff_t pos)
+{
+	struct file_list_entry *fentry = t->fentry;
+	int ret;
+
+	if (pos == 0) {
+		ret = check_ubi(t->fb, fentry, file_detect_type(buf, len));
+		if (ret < 0)
+			return ret;
+	}
+
+	if (fentry->flags & FILE_LIST_FLAG_UBI) {
+		if (!IS_ENABLED(CONFIG_UBIFORMAT))
+			return -ENOSYS;
+
+		if (pos == 0) {
+			ret = do_ubiformat(t->fb, t->mtd, NULL, 0);
+			if (ret)
+				return ret;
+		}
+
+		return ubiformat_write(t->mtd, buf, len, pos);
+	}
+
+	discard_range(t->fd, len, pos);
+
+	pos = lseek(t->fd, pos, SEEK_SET);
+	if (pos == -1)
+		return -errno;
+
+	ret = write_full(t->fd, buf, len);
+	if (ret < 0)
+		return ret;
+
+	return 0;
+}
+
+static void fastboot_sparse_target_close(struct fastboot_sparse_target *t)
+{
+	if (t->fd >= 0)
+		close(t->fd);
+	t->fd = -1;
+}
+
+static int fastboot_handle_sparse(struct fastboot *fb,
+				  struct file_list_entry *fentry)
+{
+	struct fastboot_sparse_target t = {
+		.fb = fb,
+		.fentry = fentry,
+		.fd = -1,
+	};
+	struct sparse_image_ctx *sparse;
+	void *buf = NULL;
+	int ret;
+	int bufsiz = SZ_128K;
 
 	sparse = sparse_image_open(fb->tempname);
 	if (IS_ERR(sparse)) {
 		pr_err("Cannot open sparse image\n");
-		ret = PTR_ERR(sparse);
-		goto out_close_fd;
+		return PTR_ERR(sparse);
 	}
 
-	if (S_ISREG(s.st_mode)) {
-		ret = ftruncate(fd, sparse_image_size(sparse));
-		if (ret)
-			goto out;
-	}
+	ret = fastboot_sparse_target_open(&t, sparse_image_size(sparse));
+	if (ret)
+		goto out;
 
 	buf = malloc(bufsiz);
 	if (!buf) {
@@ -552,14 +674,6 @@ static int fastboot_handle_sparse(struct fastboot *fb,
 		goto out;
 	}
 
-	if (fentry->flags & FILE_LIST_FLAG_UBI) {
-		mtd = get_mtd(fb, fentry->filename);
-		if (IS_ERR(mtd)) {
-			ret = PTR_ERR(mtd);
-			goto out;
-		}
-	}
-
 	while (1) {
 		size_t retlen;
 		loff_t pos;
@@ -570,53 +684,136 @@ static int fastboot_handle_sparse(struct fastboot *fb,
 		if (!retlen)
 			break;
 
-		if (pos == 0) {
-			ret = check_ubi(fb, fentry, file_detect_type(buf, retlen));
-			if (ret < 0)
-				goto out;
-		}
-
-		if (fentry->flags & FILE_LIST_FLAG_UBI) {
-			if (!IS_ENABLED(CONFIG_UBIFORMAT)) {
-				ret = -ENOSYS;
-				goto out;
-			}
-
-			if (pos == 0) {
-				ret = do_ubiformat(fb, mtd, NULL, 0);
-				if (ret)
-					goto out;
-			}
-
-			ret = ubiformat_write(mtd, buf, retlen, pos);
-			if (ret)
-				goto out;
-		} else {
-			discard_range(fd, retlen, pos);
-
-			pos = lseek(fd, pos, SEEK_SET);
-			if (pos == -1) {
-				ret = -errno;
-				goto out;
-			}
-
-			ret = write_full(fd, buf, retlen);
-			if (ret < 0)
-				goto out;
-		}
+		ret = fastboot_sparse_target_write(&t, buf, retlen, pos);
+		if (ret)
+			goto out;
 	}
 
 	ret = 0;
 
 out:
 	free(buf);
+	fastboot_sparse_target_close(&t);
 	sparse_image_close(sparse);
-out_close_fd:
-	close(fd);
 
 	return ret;
 }
 
+/*
+ * A sparse image downloaded after the host named its target partition with
+ * "oem stream <partition>" is not stored in the temporary file, but parsed
+ * and written to that partition as it arrives. Memory usage is independent
+ * of the image size, and the partition is written while the remaining image
+ * is still being received. The following flash command only reports the
+ * result.
+ */
+struct fastboot_stream {
+	struct sparse_image_stream *ss;
+	struct fastboot_sparse_target target;
+	int ret;
+};
+
+static int fastboot_stream_write(void *priv, const void *buf, size_t len,
+				 loff_t pos)
+{
+	struct fastboot_stream *stream = priv;
+	struct fastboot_sparse_target *t = &stream->target;
+	int ret;
+
+	/* the image size is known once the first chunk arrives */
+	if (t->fd < 0) {
+		ret = fastboot_sparse_target_open(t,
+					sparse_image_stream_size(stream->ss));
+		if (ret)
+			return ret;
+	}
+
+	return fastboot_sparse_target_write(t, buf, len, pos);
+}
+
+static void fastboot_stream_free(struct fastboot *fb)
+{
+	struct fastboot_stream *stream = fb->stream;
+
+	if (!stream)
+		return;
+
+	fastboot_sparse_target_close(&stream->target);
+	sparse_image_stream_free(stream->ss);
+	free(stream);
+
+	fb->stream = NULL;
+}
+
+static int fastboot_stream_start(struct fastboot *fb)
+{
+	struct fastboot_stream *stream;
+	struct file_list_entry *fentry;
+
+	fentry = file_list_entry_by_name(fb->files, fb->stream_partition);
+	if (!fentry) {
+		fastboot_tx_print(fb, FASTBOOT_MSG_INFO,
+				  "No such partition: %s", fb->stream_partition);
+		return -ENOENT;
+	}
+
+	stream = xzalloc(sizeof(*stream));
+	stream->target.fb = fb;
+	stream->target.fentry = fentry;
+	stream->target.fd = -1;
+
+	stream->ss = sparse_image_stream_new(SZ_128K, fastboot_stream_write,
+					     stream);
+	if (!stream->ss) {
+		free(stream);
+		return -ENOMEM;
+	}
+
+	fb->stream = stream;
+
+	fastboot_tx_print(fb, FASTBOOT_MSG_INFO,
+			  "Streaming sparse image to %s...", fentry->name);
+
+	return 0;
+}
+
+/* Only sparse images are streamed, everything else is downloaded */
+static bool fastboot_stream_wanted(struct fastboot *fb, const void *buffer,
+				   unsigned int len)
+{
+	if (!IS_ENABLED(CONFIG_FASTBOOT_SPARSE))
+		return false;
+
+	/* flash handlers of the board must see the image */
+	if (fb->cmd_flash)
+		return false;
+
+	if (!fb->stream_partition)
+		return false;
+
+	return len >= sizeof(struct sparse_header) && is_sparse_image(buffer);
+}
+
+static int fastboot_stream_feed(struct fastboot *fb, const void *buffer,
+				unsigned int len)
+{
+	struct fastboot_stream *stream = fb->stream;
+
+	stream->ret = sparse_image_stream_feed(stream->ss, buffer, len);
+
+	return stream->ret;
+}
+
+static int fastboot_stream_finish(struct fastboot *fb)
+{
+	struct fastboot_stream *stream = fb->stream;
+
+	stream->ret = sparse_image_stream_finish(stream->ss);
+	fastboot_sparse_target_close(&stream->target);
+
+	return stream->ret;
+}
+
 static void cb_flash(struct fastboot *fb, const char *cmd)
 {
 	struct file_list_entry *fentry;
@@ -624,6 +821,27 @@ static void cb_flash(struct fastboot *fb, const char *cmd)
 	const char *filename = NULL;
 	enum filetype filetype;
 
+	if (fb->stream) {
+		struct fastboot_stream *stream = fb->stream;
+
+		/* the image has already been written while downloading */
+		if (strcmp(cmd, stream->target.fentry->name)) {
+			fastboot_tx_print(fb, FASTBOOT_MSG_FAIL,
+					  "image was streamed to %s",
+					  stream->target.fentry->name);
+			ret = -EINVAL;
+		} else {
+			ret = stream->ret;
+			if (ret)
+				fastboot_tx_print(fb, FASTBOOT_MSG_FAIL,
+						  "writing sparse image: %s",
+						  strerror(-ret));
+		}
+
+		fastboot_stream_free(fb);
+		goto out;
+	}
+
 	filetype = file_name_detect_type(fb->tempname);
 
 	fastboot_tx_print(fb, FASTBOOT_MSG_INFO, "Copying file to %s...",
@@ -856,6 +1074,46 @@ static void cb_oem_exec(struct fastboot *fb, const char *cmd)
 		fastboot_tx_print(fb, FASTBOOT_MSG_OKAY, "");
 }
 
+static void cb_oem_stream(struct fastboot *fb, const char *cmd)
+{
+	pr_debug("%s: \"%s\"\n", __func__, cmd);
+
+	/* matched by prefix, so only accept "stream" and "stream <partition>" */
+	if (*cmd && *cmd != ' ') {
+		fastboot_tx_print(fb, FASTBOOT_MSG_FAIL,
+				  "unknown command stream%s", cmd);
+		return;
+	}
+
+	/* flash handlers of the board must see the image */
+	if (!IS_ENABLED(CONFIG_FASTBOOT_SPARSE) || fb->cmd_flash) {
+		fastboot_tx_print(fb, FASTBOOT_MSG_FAIL,
+				  "streaming not supported");
+		return;
+	}
+
+	cmd = skip_spaces(cmd);
+
+	free(fb->stream_partition);
+	fb->stream_partition = NULL;
+
+	/* without a partition streaming is switched off again */
+	if (!*cmd) {
+		fastboot_tx_print(fb, FASTBOOT_MSG_OKAY, "");
+		return;
+	}
+
+	if (!file_list_entry_by_name(fb->files, cmd)) {
+		fastboot_tx_print(fb, FASTBOOT_MSG_FAIL,
+				  "No such partition: %s", cmd);
+		return;
+	}
+
+	fb->stream_partition = xstrdup(cmd);
+
+	fastboot_tx_print(fb, FASTBOOT_MSG_OKAY, "");
+}
+
 static const struct cmd_dispatch_info cmd_oem_dispatch_info[] = {
 	{
 		.cmd = "getenv ",
@@ -866,6 +1124,9 @@ static const struct cmd_dispatch_info cmd_oem_dispatch_info[] = {
 	}, {
 		.cmd = "exec ",
 		.cb = cb_oem_exec,
+	}, {
+		.cmd = "stream",
+		.cb = cb_oem_stream,
 	},
 };
 
@@ -357,8 +357,21 @@ static int fit_verify_signature(struct device_node *sig_node, const void *fit)
 	return ret;
 }
 
-static int fit_verify_hash(struct fit_handle *handle, struct device_node *image,
-			   const void *data, int data_len)
+/*
+ * State of an image verification in progress. The image data is fed into
+ * @digest while it is being processed, the result is checked afterwards.
+ */
+struct fit_image_verify {
+	struct device_node *node;	/* hash or signature node */
+	struct digest *digest;		/* NULL if there is nothing to check */
+	enum hash_algo algo;
+	const void *value;		/* expected hash value */
+	bool signature;
+};
+
+static int fit_verify_hash_start(struct fit_handle *handle,
+				 struct device_node *image,
+				 struct fit_image_verify *v)
 {
 	struct digest *d;
 	const char *algo;
@@ -405,35 +418,41 @@ static int fit_verify_hash(struct fit_handle *handle, struct device_node *image,
 
 	if (hash_len != digest_length(d)) {
 		pr_err("%s: invalid hash length %d\n", hash->full_name, hash_len);
-		ret = -EINVAL;
-		goto err_digest_free;
+		digest_free(d);
+		return -EINVAL;
 	}
 
 	digest_init(d);
-	digest_update(d, data, data_len);
 
-	if (digest_verify(d, value_read)) {
-		pr_info("%s: hash BAD\n", hash->full_name);
+	v->node = hash;
+	v->digest = d;
+	v->value = value_read;
+
+	return 0;
+}
+
+static int fit_verify_hash_finish(struct fit_image_verify *v)
+{
+	int ret;
+
+	if (digest_verify(v->digest, v->value)) {
+		pr_info("%s: hash BAD\n", v->node->full_name);
 		ret =  -EBADMSG;
 	} else {
-		pr_info("%s: hash OK\n", hash->full_name);
+		pr_info("%s: hash OK\n", v->node->full_name);
 		ret = 0;
 	}
 
-err_digest_free:
-	digest_free(d);
-
 	return ret;
 }
 
-static int fit_image_verify_signature(struct fit_handle *handle,
-				      struct device_node *image,
-				      const void *data, int data_len)
+static int fit_image_verify_signature_start(struct fit_handle *handle,
+					    struct device_node *image,
+					    struct fit_image_verify *v)
 {
 	struct digest *digest;
 	struct device_node *sig_node;
 	enum hash_algo algo = 0;
-	void *hash;
 	int ret;
 
 	if (!IS_ENABLED(CONFIG_FITIMAGE_SIGNATURE))
@@ -461,15 +480,61 @@ static int fit_image_verify_signature(struct fit_handle *handle,
 	if (IS_ERR(digest))
 		return PTR_ERR(digest);
 
-	digest_update(digest, data, data_len);
-	hash = xzalloc(digest_length(digest));
-	digest_final(digest, hash);
+	v->node = sig_node;
+	v->digest = digest;
+	v->algo = algo;
+	v->signature = true;
 
-	ret = fit_check_rsa_signature(sig_node, algo, hash);
+	return 0;
+}
+
+static int fit_image_verify_signature_finish(struct fit_image_verify *v)
+{
+	void *hash;
+	int ret;
+
+	hash = xzalloc(digest_length(v->digest));
+	digest_final(v->digest, hash);
+
+	ret = fit_check_rsa_signature(v->node, v->algo, hash);
 
 	free(hash);
 
-	digest_free(digest);
+	return ret;
+}
+
+/*
+ * Set up the verification of an image: the hash is checked when the image
+ * is opened as part of a configuration (whose signature covers the hash),
+ * otherwise the signature of the image itself.
+ */
+static int fit_image_verify_start(struct fit_handle *handle,
+				  struct device_node *image,
+				  bool configuration,
+				  struct fit_image_verify *v)
+{
+	memset(v, 0, sizeof(*v));
+
+	if (configuration)
+		return fit_verify_hash_start(handle, image, v);
+	else
+		return fit_image_verify_signature_start(handle, image, v);
+}
+
+static int fit_image_verify_finish(struct fit_image_verify *v)
+{
+	int ret;
+
+	if (!v->digest)
+		return 0;
+
+	if (v->signature)
+		ret = fit_image_verify_signature_finish(v);
+	else
+		ret = fit_verify_hash_finish(v);
+
+	digest_free(v->digest);
+	v->digest = NULL;
 
 	return ret;
 }
@@ -589,7 +654,9 @@ int fit_open_image(struct fit_handle *handle, void *configuration,
 	struct device_node *image;
 	const char *unit = name, *type = NULL, *compression = NULL,
 	      *desc= "(no description)";
+	struct fit_image_verify verify;
 	const void *data;
+	void *uc_data = NULL;
 	int data_len;
 	int ret = 0;
 
@@ -612,31 +679,56 @@ int fit_open_image(struct fit_handle *handle, void *configuration,
 		return -EINVAL;
 	}
 
-	if (configuration)
-		ret = fit_verify_hash(handle, image, data, data_len);
-	else
-		ret = fit_image_verify_signature(handle, image, data, data_len);
+	of_property_read_string(image, "compression", &compression);
+	if (compression && !strcmp(compression, "none"))
+		compression = NULL;
 
+	if (compression && !IS_ENABLED(CONFIG_UNCOMPRESS)) {
+		pr_err("image has compression = \"%s\", but support not compiled in\n",
+		       compression);
+		return -ENOSYS;
+	}
+
+	ret = fit_image_verify_start(handle, image, configuration, &verify);
 	if (ret < 0)
 		return ret;
 
-	of_property_read_string(image, "compression", &compression);
-	if (compression && strcmp(compression, "none") != 0) {
-		void *uc_data;
+	/*
+	 * With BOOTM_VERIFY_HASH the hash only guards against corruption.
+	 * Whoever can modify the image can update its hash as well, so
+	 * nothing is gained by keeping unchecked data from the decompressor,
+	 * and compressed data is hashed chunk by chunk while it is fed to the
+	 * decompressor. In all other modes the hash or signature may be all
+	 * that authenticates the data, so it is checked before a decompressor
+	 * parses it. Either way the result is only handed out once the
+	 * verification has succeeded.
+	 */
+	if (verify.digest &&
+	    (!compression || handle->verify != BOOTM_VERIFY_HASH)) {
+		digest_update(verify.digest, data, data_len);
+
+		ret = fit_image_verify_finish(&verify);
+		if (ret < 0)
+			return ret;
+	}
 
-		if (!IS_ENABLED(CONFIG_UNCOMPRESS)) {
-			pr_err("image has compression = \"%s\", but support not compiled in\n",
-			       compression);
-			return -ENOSYS;
-		}
+	if (compression)
+		data_len = uncompress_buf_to_buf_digest(data, data_len, &uc_data,
+							verify.digest,
+							fit_uncompress_error_fn);
 
-		data_len = uncompress_buf_to_buf(data, data_len, &uc_data,
-					    fit_uncompress_error_fn);
-		if (data_len < 0) {
-			pr_err("data couldn't be decompressed\n");
-			return data_len;
-		}
+	/* a bad hash takes precedence over decompression errors */
+	ret = fit_image_verify_finish(&verify);
+	if (ret < 0)
+		goto err;
+
+	if (data_len < 0) {
+		pr_err("data couldn't be decompressed\n");
+		ret = data_len;
+		goto err;
+	}
 
+	if (uc_data) {
 		data = uc_data;
 
 		/* associate buffer with FIT, so it's not leaked */
@@ -647,6 +739,9 @@ int fit_open_image(struct fit_handle *handle, void *configuration,
 	*outsize = data_len;
 
 	return 0;
+err:
+	free(uc_data);
+	return ret;
 }
 
 static int fit_config_verify_signature(struct fit_handle *handle, struct device_node *conf_node)
@@ -822,6 +917,39 @@ struct fit_handle *fit_open_buf(const void *buf, size_t size, bool verbose,
 	return handle;
 }
 
+/*
+ * Use the image in place when the file can be memmapped, like a file in
+ * a ramfs, instead of reading a copy of it.
+ */
+static int fit_map_file(struct fit_handle *handle, const char *filename,
+			loff_t max_size)
+{
+	struct stat s;
+	void *map;
+	int fd, ret;
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return -errno;
+
+	ret = fstat(fd, &s);
+	if (ret)
+		goto out;
+
+	map = memmap(fd, PROT_READ);
+	if (map == MAP_FAILED) {
+		ret = -errno;
+		goto out;
+	}
+
+	handle->fit = map;
+	handle->size = min_t(loff_t, s.st_size, max_size);
+out:
+	close(fd);
+
+	return ret;
+}
+
 /**
  * fit_open - open a FIT image
  * @filename:	The filename of the FIT image
@@ -845,14 +973,16 @@ struct fit_handle *fit_open(const char *filename, bool verbose,
 	handle->verbose = verbose;
 	handle->verify = verify;
 
-	ret = read_file_2(filename, &handle->size, &handle->fit_alloc,
-			  max_size);
-	if (ret && ret != -EFBIG) {
-		pr_err("unable to read %s: %s\n", filename, strerror(-ret));
-		return ERR_PTR(ret);
-	}
+	if (fit_map_file(handle, filename, max_size)) {
+		ret = read_file_2(filename, &handle->size, &handle->fit_alloc,
+				  max_size);
+		if (ret && ret != -EFBIG) {
+			pr_err("unable to read %s: %s\n", filename, strerror(-ret));
+			return ERR_PTR(ret);
+		}
 
-	handle->fit = handle->fit_alloc;
+		handle->fit = handle->fit_alloc;
+	}
 
 	ret = fit_do_open(handle);
 	if (ret) {
@@ -39,6 +39,7 @@
 #include <glob.h>
 #include <net.h>
 #include <bselftest.h>
+#include <boot-profile.h>
 
 extern initcall_t __barebox_initcalls_start[], __barebox_early_initcalls_end[],
 		  __barebox_initcalls_end[];
@@ -236,6 +237,21 @@ static int register_autoboot_vars(void)
 }
 postcore_initcall(register_autoboot_vars);
 
+static void run_init_script(const char *path)
+{
+	char *scr;
+	u64 start;
+	int ret;
+
+	scr = basprintf("source %s", path);
+
+	start = boot_profile_begin();
+	ret = run_command(scr);
+	boot_profile_end(BOOT_PROFILE_SCRIPT, NULL, start, ret, "%s", path);
+
+	free(scr);
+}
+
 static int run_init(void)
 {
 	const char *bmode;
@@ -252,7 +268,7 @@ static int run_init(void)
 	env_bin_init_exists = stat(INITFILE, &s) == 0;
 	if (env_bin_init_exists) {
 		pr_info("running %s...\n", INITFILE);
-		run_command("source " INITFILE);
+		run_init_script(INITFILE);
 		return 0;
 	}
 
@@ -269,7 +285,6 @@ static int run_init(void)
 	if (!ret) {
 		for (i = 0; i < g.gl_pathc; i++) {
 			const char *path = g.gl_pathv[i];
-			char *scr;
 
 			ret = stat(path, &s);
 			if (ret)
@@ -279,9 +294,7 @@ static int run_init(void)
 				continue;
 
 			pr_debug("Executing '%s'...\n", path);
-			scr = basprintf("source %s", path);
-			run_command(scr);
-			free(scr);
+			run_init_script(path);
 		}
 
 		globfree(&g);
@@ -290,15 +303,14 @@ static int run_init(void)
 	/* source matching script in /env/bmode/ */
 	bmode = reboot_mode_get();
 	if (bmode) {
-		char *scr, *path;
+		char *path;
 
-		scr = xasprintf("source /env/bmode/%s", bmode);
-		path = &scr[strlen("source ")];
+		path = xasprintf("/env/bmode/%s", bmode);
 		if (stat(path, &s) == 0) {
 			pr_info("Invoking '%s'...\n", path);
-			run_command(scr);
+			run_init_script(path);
 		}
-		free(scr);
+		free(path);
 	}
 
 	autoboot = do_autoboot_countdown();
@@ -308,6 +320,9 @@ static int run_init(void)
 	if (autoboot == AUTOBOOT_BOOT)
 		run_command("boot");
 
+	/* everything from here on is interactive */
+	boot_profile_stop();
+
 	if (IS_ENABLED(CONFIG_NET))
 		eth_open_all();
 
@@ -341,6 +356,7 @@ int (*barebox_main)(void);
 void __noreturn start_barebox(void)
 {
 	initcall_t *initcall;
+	u64 start;
 	int result;
 
 	if (!IS_ENABLED(CONFIG_SHELL_NONE) && IS_ENABLED(CONFIG_COMMAND_SUPPORT))
@@ -351,7 +367,10 @@ void __noreturn start_barebox(void)
 	for (initcall = __barebox_initcalls_start;
 			initcall < __barebox_initcalls_end; initcall++) {
 		pr_debug("initcall-> %pS\n", *initcall);
+		start = boot_profile_begin();
 		result = (*initcall)();
+		boot_profile_end(BOOT_PROFILE_INITCALL, *initcall, start,
+				 result, NULL);
 		if (result)
 			pr_err("initcall %pS failed: %s\n", *initcall,
 					strerror(-result));
@@ -365,6 +384,8 @@ void __noreturn start_barebox(void)
 	if (barebox_main)
 		barebox_main();
 
+	boot_profile_stop();
+
 	if (IS_ENABLED(CONFIG_SHELL_NONE)) {
 		pr_err("Nothing left to do\n");
 		hang();
@@ -136,29 +136,90 @@ static const ulong crc_table[256] = {
 
 /* ========================================================================= */
 #define DO1(buf) crc = crc_table[((int)crc ^ (*buf++)) & 0xff] ^ (crc >> 8);
-#define DO2(buf)  DO1(buf); DO1(buf);
-#define DO4(buf)  DO2(buf); DO2(buf);
-#define DO8(buf)  DO4(buf); DO4(buf);
 
-/* ========================================================================= */
-STATIC uint32_t crc32(uint32_t crc, const void *_buf, unsigned int len)
+/*
+ * Slicing-by-8: crc_slice[k][n] is the CRC of byte n followed by k zero
+ * bytes, so eight bytes can be processed with eight independent lookups.
+ * The tables are derived from crc_table on first use.
+ */
+static uint32_t crc_slice[8][256];
+static int crc_slice_valid;
+
+static void make_crc_slice_table(void)
 {
-    const unsigned char *buf = _buf;
+	int n, k;
 
 #ifdef CONFIG_DYNAMIC_CRC_TABLE
 	if (!crc_table)
 		make_crc_table();
 #endif
-    crc = crc ^ 0xffffffffL;
-    while (len >= 8)
-    {
-      DO8(buf);
-      len -= 8;
-    }
-    if (len) do {
-      DO1(buf);
-    } while (--len);
-    return crc ^ 0xffffffffL;
+	for (n = 0; n < 256; n++)
+		crc_slice[0][n] = crc_table[n];
+
+	for (k = 1; k < 8; k++)
+		for (n = 0; n < 256; n++)
+			crc_slice[k][n] = (crc_slice[k - 1][n] >> 8) ^
+				crc_table[crc_slice[k - 1][n] & 0xff];
+
+	crc_slice_valid = 1;
+}
+
+static inline uint32_t crc_le32(const unsigned char *p)
+{
+	return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+/*
+ * Reflected CRC-32 without the pre- and post-inversion. This is the
+ * portable implementation, the architecture may provide a faster one as
+ * crc32_le_arch() which falls back to this one if the CPU lacks support.
+ */
+STATIC uint32_t crc32_le_generic(uint32_t crc, const void *_buf, unsigned int len)
+{
+	const unsigned char *buf = _buf;
+	uint32_t one, two;
+
+	if (!crc_slice_valid)
+		make_crc_slice_table();
+
+	while (len && ((unsigned long)buf & 3)) {
+		DO1(buf);
+		len--;
+	}
+
+	while (len >= 8) {
+		one = crc_le32(buf) ^ crc;
+		two = crc_le32(buf + 4);
+
+		crc = crc_slice[7][one & 0xff] ^
+		      crc_slice[6][(one >> 8) & 0xff] ^
+		      crc_slice[5][(one >> 16) & 0xff] ^
+		      crc_slice[4][one >> 24] ^
+		      crc_slice[3][two & 0xff] ^
+		      crc_slice[2][(two >> 8) & 0xff] ^
+		      crc_slice[1][(two >> 16) & 0xff] ^
+		      crc_slice[0][two >> 24];
+
+		buf += 8;
+		len -= 8;
+	}
+
+	while (len--)
+		DO1(buf);
+
+	return crc;
+}
+
+#if defined(__BAREBOX__) && defined(CONFIG_CRC32_ARCH)
+#define crc32_le	crc32_le_arch
+#else
+#define crc32_le	crc32_le_generic
+#endif
+
+/* ========================================================================= */
+STATIC uint32_t crc32(uint32_t crc, const void *buf, unsigned int len)
+{
+	return crc32_le(crc ^ 0xffffffffL, buf, len) ^ 0xffffffffL;
 }
 #ifdef __BAREBOX__
 EXPORT_SYMBOL(crc32);
@@ -167,24 +228,9 @@ EXPORT_SYMBOL(crc32);
 /* No ones complement version. JFFS2 (and other things ?)
  * don't use ones compliment in their CRC calculations.
  */
-STATIC uint32_t crc32_no_comp(uint32_t crc, const void *_buf, unsigned int len)
+STATIC uint32_t crc32_no_comp(uint32_t crc, const void *buf, unsigned int len)
 {
-   const unsigned char *buf = _buf;
-
-#ifdef CONFIG_DYNAMIC_CRC_TABLE
-	if (!crc_table)
-		make_crc_table();
-#endif
-    while (len >= 8)
-    {
-      DO8(buf);
-      len -= 8;
-    }
-    if (len) do {
-      DO1(buf);
-    } while (--len);
-
-    return crc;
+	return crc32_le(crc, buf, len);
 }
 
 STATIC uint32_t crc32_be(uint32_t crc, const void *_buf, unsigned int len)
@@ -17,11 +17,6 @@
 #include <rsa.h>
 #include <asm/unaligned.h>
 
-#define UINT64_MULT32(v, multby)  (((uint64_t)(v)) * ((uint32_t)(multby)))
-
-#define get_unaligned_be32(a) fdt32_to_cpu(*(uint32_t *)a)
-#define put_unaligned_be32(a, b) (*(uint32_t *)(b) = cpu_to_fdt32(a))
-
 /* Default public exponent for backward compatibility */
 #define RSA_DEFAULT_PUBEXP	65537
 
@@ -29,40 +24,70 @@
 #define RSA_MIN_KEY_BITS	1024
 #define RSA_MAX_KEY_BITS	4096
 
+/*
+ * The keys are stored as 32 bit words, but the arithmetic uses limbs of
+ * the native word size. On 64 bit CPUs this needs a quarter of the
+ * multiplications.
+ */
+#if BITS_PER_LONG == 64 && defined(__SIZEOF_INT128__)
+typedef u64 rsa_limb;
+typedef unsigned __int128 rsa_dlimb;
+#else
+typedef u32 rsa_limb;
+typedef u64 rsa_dlimb;
+#endif
+
+#define RSA_LIMB_BITS		(sizeof(rsa_limb) * 8)
+#define RSA_MAX_LIMBS		(RSA_MAX_KEY_BITS / RSA_LIMB_BITS)
+
+/**
+ * struct rsa_mont - Montgomery constants of a key in native limbs
+ *
+ * Computed once by rsa_key_prepare() when a key is read or registered,
+ * so that verifying a signature only has to convert the signature.
+ */
+struct rsa_mont {
+	uint len;				/* number of limbs */
+	rsa_limb n0inv;				/* -1 / modulus[0] mod 2^RSA_LIMB_BITS */
+	rsa_limb modulus[RSA_MAX_LIMBS];	/* little endian limbs */
+	rsa_limb rr[RSA_MAX_LIMBS];		/* R^2 mod modulus, R = 2^(len * RSA_LIMB_BITS) */
+};
+
 /**
  * subtract_modulus() - subtract modulus from the given value
  *
- * @key:	Key containing modulus to subtract
- * @num:	Number to subtract modulus from, as little endian word array
+ * @mont:	Montgomery constants of the key
+ * @num:	Number to subtract modulus from, as little endian limb array
  */
-static void subtract_modulus(const struct rsa_public_key *key, uint32_t num[])
+static void subtract_modulus(const struct rsa_mont *mont, rsa_limb num[])
 {
-	int64_t acc = 0;
+	rsa_limb borrow = 0;
 	uint i;
 
-	for (i = 0; i < key->len; i++) {
-		acc += (uint64_t)num[i] - key->modulus[i];
-		num[i] = (uint32_t)acc;
-		acc >>= 32;
+	for (i = 0; i < mont->len; i++) {
+		rsa_limb a = num[i], b = mont->modulus[i];
+
+		num[i] = a - b - borrow;
+		borrow = borrow ? a <= b : a < b;
 	}
 }
 
 /**
  * greater_equal_modulus() - check if a value is >= modulus
  *
- * @key:	Key containing modulus to check
- * @num:	Number to check against modulus, as little endian word array
+ * @mont:	Montgomery constants of the key
+ * @num:	Number to check against modulus, as little endian limb array
  * @return 0 if num < modulus, 1 if num >= modulus
  */
-static int greater_equal_modulus(const struct rsa_public_key *key,
-				 uint32_t num[])
+static int greater_equal_modulus(const struct rsa_mont *mont,
+				 const rsa_limb num[])
 {
 	int i;
 
-	for (i = (int)key->len - 1; i >= 0; i--) {
-		if (num[i] < key->modulus[i])
+	for (i = (int)mont->len - 1; i >= 0; i--) {
+		if (num[i] < mont->modulus[i])
 			return 0;
-		if (num[i] > key->modulus[i])
+		if (num[i] > mont->modulus[i])
 			return 1;
 	}
 
@@ -74,34 +99,34 @@ static int greater_equal_modulus(const struct rsa_public_key *key,
  *
  * Operation: montgomery result[] += a * b[] / n0inv % modulus
  *
- * @key:	RSA key
- * @result:	Place to put result, as little endian word array
+ * @mont:	Montgomery constants of the key
+ * @result:	Place to put result, as little endian limb array
  * @a:		Multiplier
- * @b:		Multiplicand, as little endian word array
+ * @b:		Multiplicand, as little endian limb array
  */
-static void montgomery_mul_add_step(const struct rsa_public_key *key,
-		uint32_t result[], const uint32_t a, const uint32_t b[])
+static void montgomery_mul_add_step(const struct rsa_mont *mont,
+		rsa_limb result[], const rsa_limb a, const rsa_limb b[])
 {
-	uint64_t acc_a, acc_b;
-	uint32_t d0;
+	rsa_dlimb acc_a, acc_b;
+	rsa_limb d0;
 	uint i;
 
-	acc_a = (uint64_t)a * b[0] + result[0];
-	d0 = (uint32_t)acc_a * key->n0inv;
-	acc_b = (uint64_t)d0 * key->modulus[0] + (uint32_t)acc_a;
-	for (i = 1; i < key->len; i++) {
-		acc_a = (acc_a >> 32) + (uint64_t)a * b[i] + result[i];
-		acc_b = (acc_b >> 32) + (uint64_t)d0 * key->modulus[i] +
-				(uint32_t)acc_a;
-		result[i - 1] = (uint32_t)acc_b;
+	acc_a = (rsa_dlimb)a * b[0] + result[0];
+	d0 = (rsa_limb)acc_a * mont->n0inv;
+	acc_b = (rsa_dlimb)d0 * mont->modulus[0] + (rsa_limb)acc_a;
+	for (i = 1; i < mont->len; i++) {
+		acc_a = (acc_a >> RSA_LIMB_BITS) + (rsa_dlimb)a * b[i] + result[i];
+		acc_b = (acc_b >> RSA_LIMB_BITS) +
+			(rsa_dlimb)d0 * mont->modulus[i] + (rsa_limb)acc_a;
+		result[i - 1] = (rsa_limb)acc_b;
 	}
 
-	acc_a = (acc_a >> 32) + (acc_b >> 32);
+	acc_a = (acc_a >> RSA_LIMB_BITS) + (acc_b >> RSA_LIMB_BITS);
 
-	result[i - 1] = (uint32_t)acc_a;
+	result[i - 1] = (rsa_limb)acc_a;
 
-	if (acc_a >> 32)
-		subtract_modulus(key, result);
+	if (acc_a >> RSA_LIMB_BITS)
+		subtract_modulus(mont, result);
 }
 
 /**
@@ -109,20 +134,20 @@ static void montgomery_mul_add_step(const struct rsa_public_key *key,
  *
  * Operation: montgomery result[] = a[] * b[] / n0inv % modulus
  *
- * @key:	RSA key
- * @result:	Place to put result, as little endian word array
- * @a:		Multiplier, as little endian word array
- * @b:		Multiplicand, as little endian word array
+ * @mont:	Montgomery constants of the key
+ * @result:	Place to put result, as little endian limb array
+ * @a:		Multiplier, as little endian limb array
+ * @b:		Multiplicand, as little endian limb array
  */
-static void montgomery_mul(const struct rsa_public_key *key,
-		uint32_t result[], uint32_t a[], const uint32_t b[])
+static void montgomery_mul(const struct rsa_mont *mont,
+		rsa_limb result[], const rsa_limb a[], const rsa_limb b[])
 {
 	uint i;
 
-	for (i = 0; i < key->len; ++i)
+	for (i = 0; i < mont->len; ++i)
 		result[i] = 0;
-	for (i = 0; i < key->len; ++i)
-		montgomery_mul_add_step(key, result, a[i], b);
+	for (i = 0; i < mont->len; ++i)
+		montgomery_mul_add_step(mont, result, a[i], b);
 }
 
 /**
@@ -167,33 +192,46 @@ static int is_public_exponent_bit_set(const struct rsa_public_key *key,
 	return key->exponent & (1ULL << pos);
 }
 
+/* @src has @len bytes, which may not fill the most significant limb */
+static void rsa_be_to_limbs(rsa_limb *dst, uint limbs, const u8 *src, uint len)
+{
+	uint i;
+
+	memset(dst, 0, limbs * sizeof(*dst));
+
+	for (i = 0; i < len; i++)
+		dst[i / sizeof(rsa_limb)] |=
+			(rsa_limb)src[len - 1 - i] << (8 * (i % sizeof(rsa_limb)));
+}
+
+static void rsa_limbs_to_be(u8 *dst, uint len, const rsa_limb *src)
+{
+	uint i;
+
+	for (i = 0; i < len; i++)
+		dst[len - 1 - i] = src[i / sizeof(rsa_limb)] >>
+				   (8 * (i % sizeof(rsa_limb)));
+}
+
 /**
  * pow_mod() - in-place public exponentiation
  *
  * @key:	RSA key
- * @inout:	Big-endian word array containing value and result
+ * @inout:	Big-endian byte array containing value and result
  */
-static int pow_mod(const struct rsa_public_key *key, void *__inout)
+static int pow_mod(const struct rsa_public_key *key, void *inout)
 {
-	uint32_t *inout = __inout;
-	uint32_t *result, *ptr;
-	uint i;
+	const struct rsa_mont *mont = key->mont;
+	rsa_limb val[RSA_MAX_LIMBS], acc[RSA_MAX_LIMBS], tmp[RSA_MAX_LIMBS];
+	rsa_limb a_scaled[RSA_MAX_LIMBS];
 	int j, k;
-	uint32_t val[RSA_MAX_KEY_BITS / 32], acc[RSA_MAX_KEY_BITS / 32], tmp[RSA_MAX_KEY_BITS / 32];
-	uint32_t a_scaled[RSA_MAX_KEY_BITS / 32];
 
-	/* Sanity check for stack size - key->len is in 32-bit words */
-	if (key->len > RSA_MAX_KEY_BITS / 32) {
-		pr_debug("RSA key words %u exceeds maximum %d\n", key->len,
-			 RSA_MAX_KEY_BITS / 32);
+	if (!mont) {
+		pr_debug("RSA key %s is not prepared\n", key->key_name_hint);
 		return -EINVAL;
 	}
 
-	result = tmp;  /* Re-use location. */
-
-	/* Convert from big endian byte array to little endian word array. */
-	for (i = 0, ptr = inout + key->len - 1; i < key->len; i++, ptr--)
-		val[i] = get_unaligned_be32(ptr);
+	rsa_be_to_limbs(val, mont->len, inout, key->len * sizeof(uint32_t));
 
 	if (0 != num_public_exponent_bits(key, &k))
 		return -EINVAL;
@@ -210,34 +248,105 @@ static int pow_mod(const struct rsa_public_key *key, void *__inout)
 	}
 
 	/* the bit at e[k-1] is 1 by definition, so start with: C := M */
-	montgomery_mul(key, acc, val, key->rr); /* acc = a * RR / R mod n */
+	montgomery_mul(mont, acc, val, mont->rr); /* acc = a * RR / R mod n */
 	/* retain scaled version for intermediate use */
-	memcpy(a_scaled, acc, key->len * sizeof(a_scaled[0]));
+	memcpy(a_scaled, acc, mont->len * sizeof(a_scaled[0]));
 
 	for (j = k - 2; j > 0; --j) {
-		montgomery_mul(key, tmp, acc, acc); /* tmp = acc^2 / R mod n */
+		montgomery_mul(mont, tmp, acc, acc); /* tmp = acc^2 / R mod n */
 
 		if (is_public_exponent_bit_set(key, j)) {
 			/* acc = tmp * val / R mod n */
-			montgomery_mul(key, acc, tmp, a_scaled);
+			montgomery_mul(mont, acc, tmp, a_scaled);
 		} else {
 			/* e[j] == 0, copy tmp back to acc for next operation */
-			memcpy(acc, tmp, key->len * sizeof(acc[0]));
+			memcpy(acc, tmp, mont->len * sizeof(acc[0]));
 		}
 	}
 
 	/* the bit at e[0] is always 1 */
-	montgomery_mul(key, tmp, acc, acc); /* tmp = acc^2 / R mod n */
-	montgomery_mul(key, acc, tmp, val); /* acc = tmp * a / R mod M */
-	memcpy(result, acc, key->len * sizeof(result[0]));
+	montgomery_mul(mont, tmp, acc, acc); /* tmp = acc^2 / R mod n */
+	montgomery_mul(mont, acc, tmp, val); /* acc = tmp * a / R mod M */
 
 	/* Make sure result < mod; result is at most 1x mod too large. */
-	if (greater_equal_modulus(key, result))
-		subtract_modulus(key, result);
+	if (greater_equal_modulus(mont, acc))
+		subtract_modulus(mont, acc);
+
+	rsa_limbs_to_be(inout, key->len * sizeof(uint32_t), acc);
+
+	return 0;
+}
+
+/* -1 / n0 mod 2^RSA_LIMB_BITS with Newton's method, n0 must be odd */
+static rsa_limb rsa_n0inv(rsa_limb n0)
+{
+	rsa_limb inv = n0;	/* correct in the lower 3 bits */
+	int i;
+
+	/* each step doubles the number of correct bits */
+	for (i = 0; i < 5; i++)
+		inv *= 2 - n0 * inv;
+
+	return -inv;
+}
+
+/**
+ * rsa_key_prepare() - precompute the Montgomery constants of a key
+ *
+ * @key:	RSA key with modulus and R^2 as 32 bit words
+ *
+ * The R^2 of the key is for R = 2^(32 * key->len). When the key does not
+ * fill the last limb, it is scaled to the R of the limbs.
+ */
+static int rsa_key_prepare(struct rsa_public_key *key)
+{
+	struct rsa_mont *mont;
+	uint i, shift;
+
+	if (!key->len || key->len * 32 > RSA_MAX_LIMBS * RSA_LIMB_BITS) {
+		pr_debug("RSA key %s has unsupported size of %u bits\n",
+			 key->key_name_hint, key->len * 32);
+		return -EINVAL;
+	}
+
+	if (!(key->modulus[0] & 1)) {
+		pr_debug("RSA modulus of %s must be odd\n", key->key_name_hint);
+		return -EINVAL;
+	}
+
+	mont = xzalloc(sizeof(*mont));
+
+	mont->len = DIV_ROUND_UP(key->len * 32, RSA_LIMB_BITS);
+
+	for (i = 0; i < key->len; i++) {
+		shift = 32 * (i % (RSA_LIMB_BITS / 32));
+		mont->modulus[i * 32 / RSA_LIMB_BITS] |=
+			(rsa_limb)key->modulus[i] << shift;
+		mont->rr[i * 32 / RSA_LIMB_BITS] |= (rsa_limb)key->rr[i] << shift;
+	}
+
+	mont->n0inv = rsa_n0inv(mont->modulus[0]);
+
+	/* R^2 * 2^(2 * shift), doubling modulo n */
+	shift = mont->len * RSA_LIMB_BITS - key->len * 32;
+	for (i = 0; i < 2 * shift; i++) {
+		rsa_limb carry = 0;
+		uint j;
+
+		for (j = 0; j < mont->len; j++) {
+			rsa_limb l = mont->rr[j];
+
+			mont->rr[j] = l << 1 | carry;
+			carry = l >> (RSA_LIMB_BITS - 1);
+		}
+
+		/* the last limb is not filled, so there is no carry out */
+		if (greater_equal_modulus(mont, mont->rr))
+			subtract_modulus(mont, mont->rr);
+	}
+
+	key->mont = mont;
 
-	/* Convert to bigendian byte array */
-	for (i = key->len - 1, ptr = inout; (int)i >= 0; i--, ptr++)
-		put_unaligned_be32(result[i], ptr);
 	return 0;
 }
 
@@ -429,7 +538,11 @@ struct rsa_public_key *rsa_of_read_key(struct device_node *node)
 	rsa_convert_big_endian(key->modulus, modulus, key->len);
 	rsa_convert_big_endian(key->rr, rr, key->len);
 
-	err = 0;
+	err = rsa_key_prepare(key);
+	if (err) {
+		rsa_key_free(key);
+		return ERR_PTR(err);
+	}
 out:
 	if (err)
 		free(key);
@@ -441,6 +554,7 @@ void rsa_key_free(struct rsa_public_key *key)
 {
 	free(key->modulus);
 	free(key->rr);
+	free(key->mont);
 	free(key);
 }
 
@@ -480,10 +594,18 @@ static int rsa_key_add(struct rsa_public_key *key)
 static struct rsa_public_key *rsa_key_dup(const struct rsa_public_key *key)
 {
 	struct rsa_public_key *new;
+	int ret;
 
 	new = xmemdup(key, sizeof(*key));
 	new->modulus = xmemdup(key->modulus, key->len * sizeof(uint32_t));
 	new->rr = xmemdup(key->rr, key->len  * sizeof(uint32_t));
+	new->mont = NULL;
+
+	ret = rsa_key_prepare(new);
+	if (ret) {
+		rsa_key_free(new);
+		return ERR_PTR(ret);
+	}
 
 	return new;
 }
@@ -527,6 +649,12 @@ static int rsa_init_keys(void)
 
 	for (iter = &__rsa_keys_start; iter != &__rsa_keys_end; iter++) {
 		key = rsa_key_dup(*iter);
+		if (IS_ERR(key)) {
+			pr_err("Cannot prepare rsa key %s: %pe\n",
+			       (*iter)->key_name_hint, key);
+			continue;
+		}
+
 		ret = rsa_key_add(key);
 		if (ret)
 			pr_err("Cannot add rsa key %s: %s\n",
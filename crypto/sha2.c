@@ -245,34 +245,42 @@ int sha256_init(struct digest *desc)
 	return 0;
 }
 
+static void sha256_blocks(u32 *state, const u8 *src, unsigned int blocks)
+{
+	if (!blocks || sha256_arch_blocks(state, src, blocks))
+		return;
+
+	while (blocks--) {
+		sha256_transform(state, src);
+		src += 64;
+	}
+}
+
 int sha256_update(struct digest *desc, const void *data,
 				unsigned long len)
 {
 	struct sha256_state *sctx = digest_ctx(desc);
-	unsigned int partial, done;
-	const u8 *src;
+	unsigned int partial, done, blocks;
 
 	partial = sctx->count & 0x3f;
 	sctx->count += len;
 	done = 0;
-	src = data;
 
 	if ((partial + len) > 63) {
 		if (partial) {
 			done = -partial;
 			memcpy(sctx->buf + partial, data, done + 64);
-			src = sctx->buf;
+			sha256_blocks(sctx->state, sctx->buf, 1);
+			done += 64;
 		}
 
-		do {
-			sha256_transform(sctx->state, src);
-			done += 64;
-			src = data + done;
-		} while (done + 63 < len);
+		blocks = (len - done) / 64;
+		sha256_blocks(sctx->state, data + done, blocks);
+		done += blocks * 64;
 
 		partial = 0;
 	}
-	memcpy(sctx->buf + partial, src, len - done);
+	memcpy(sctx->buf + partial, data + done, len - done);
 
 	return 0;
 }
@@ -13,6 +13,7 @@
 #define dev_err_probe dev_err_probe
 
 #include <common.h>
+#include <boot-profile.h>
 #include <command.h>
 #include <deep-probe.h>
 #include <driver.h>
@@ -45,6 +46,8 @@ EXPORT_SYMBOL(driver_list);
 LIST_HEAD(active_device_list);
 EXPORT_SYMBOL(active_device_list);
 static LIST_HEAD(deferred);
+static LIST_HEAD(deferred_ready);
+static unsigned int deferred_progress;
 
 struct device *find_device(const char *str)
 {
@@ -97,9 +100,168 @@ int get_free_deviceid(const char *name_template)
 	};
 }
 
+/*
+ * Device tree properties referencing the providers a device may depend on.
+ * Names starting with '-' match as suffix, names ending with '-' as prefix
+ * followed by a number.
+ */
+static const struct {
+	const char *name;
+	const char *cells;
+} supplier_bindings[] = {
+	{ "clocks", "#clock-cells" },
+	{ "resets", "#reset-cells" },
+	{ "phys", "#phy-cells" },
+	{ "pwms", "#pwm-cells" },
+	{ "dmas", "#dma-cells" },
+	{ "mboxes", "#mbox-cells" },
+	{ "power-domains", "#power-domain-cells" },
+	{ "io-channels", "#io-channel-cells" },
+	{ "gpios", "#gpio-cells" },
+	{ "-gpios", "#gpio-cells" },
+	{ "-gpio", "#gpio-cells" },
+	{ "nvmem-cells", NULL },
+	{ "-supply", NULL },
+	{ "pinctrl-", NULL },
+};
+
+static bool supplier_binding_match(const char *binding, const char *prop)
+{
+	size_t blen = strlen(binding), plen = strlen(prop);
+
+	if (binding[0] == '-')
+		return plen > blen && !strcmp(prop + plen - blen, binding);
+	if (binding[blen - 1] == '-')
+		return plen > blen && !strncmp(prop, binding, blen) &&
+			isdigit(prop[blen]);
+
+	return !strcmp(prop, binding);
+}
+
+/*
+ * A supplier is pending if the nearest device created for it or one of its
+ * parents has not been probed yet. Suppliers without any device, like
+ * providers registered from initcalls, can't be waited for.
+ */
+static bool supplier_is_pending(struct device *dev, struct device_node *np)
+{
+	for (; np && np->parent; np = np->parent) {
+		if (!np->dev)
+			continue;
+		if (np->dev == dev)
+			return false;
+		return !np->dev->driver;
+	}
+
+	return false;
+}
+
+static void device_add_supplier(struct device *dev, struct device_node *np)
+{
+	int i;
+
+	if (!supplier_is_pending(dev, np))
+		return;
+
+	for (i = 0; i < dev->num_deferred_suppliers; i++)
+		if (dev->deferred_suppliers[i] == np)
+			return;
+
+	dev->deferred_suppliers = xrealloc(dev->deferred_suppliers,
+			(dev->num_deferred_suppliers + 1) * sizeof(np));
+	dev->deferred_suppliers[dev->num_deferred_suppliers++] = np;
+}
+
+/*
+ * Record the suppliers a deferred device is waiting for, so that it is only
+ * probed again once one of them is probed. A device without any pending
+ * supplier is deferred for an unknown reason and retried whenever any other
+ * device is probed successfully.
+ */
+static void device_collect_suppliers(struct device *dev)
+{
+	struct device_node *np = dev_of_node(dev);
+	struct property *pp;
+	int i, j;
+
+	dev->num_deferred_suppliers = 0;
+
+	if (!np)
+		return;
+
+	for_each_property_of_node(np, pp) {
+		for (i = 0; i < ARRAY_SIZE(supplier_bindings); i++) {
+			const char *cells = supplier_bindings[i].cells;
+			struct of_phandle_args args;
+			struct device_node *supplier;
+
+			if (!supplier_binding_match(supplier_bindings[i].name,
+						    pp->name))
+				continue;
+
+			for (j = 0; ; j++) {
+				if (cells) {
+					if (of_parse_phandle_with_args(np, pp->name,
+							cells, j, &args))
+						break;
+					supplier = args.np;
+				} else {
+					supplier = of_parse_phandle(np, pp->name, j);
+					if (!supplier)
+						break;
+				}
+
+				device_add_supplier(dev, supplier);
+			}
+
+			break;
+		}
+	}
+}
+
+static bool device_waits_for(struct device *dev, struct device *supplier)
+{
+	struct device_node *np, *supplier_np = dev_of_node(supplier);
+	int i;
+
+	if (!dev->num_deferred_suppliers)
+		return true;
+
+	if (!supplier_np)
+		return false;
+
+	for (i = 0; i < dev->num_deferred_suppliers; i++)
+		for (np = dev->deferred_suppliers[i]; np; np = np->parent)
+			if (np == supplier_np)
+				return true;
+
+	return false;
+}
+
+/*
+ * A device has been probed successfully, queue the deferred devices waiting
+ * for it for another probe.
+ */
+static void device_deferred_wake(struct device *supplier)
+{
+	struct device *dev, *tmp;
+
+	deferred_progress++;
+
+	list_for_each_entry_safe(dev, tmp, &deferred, active) {
+		if (!device_waits_for(dev, supplier))
+			continue;
+
+		dev_dbg(dev, "%s probed, queue for re-probe\n",
+			dev_name(supplier));
+		list_move_tail(&dev->active, &deferred_ready);
+	}
+}
+
 int device_probe(struct device *dev)
 {
 	static int depth = 0;
+	u64 start;
 	int ret;
 
 	ret = of_feature_controller_check(dev->of_node);
@@ -119,13 +281,20 @@ int device_probe(struct device *dev)
 
 	list_add(&dev->active, &active_device_list);
 
+	start = boot_profile_begin();
 	ret = dev->bus->probe(dev);
-	if (ret == 0)
+	boot_profile_end(BOOT_PROFILE_PROBE, NULL, start, ret, "%s (%s)",
+			 dev_name(dev), dev->driver ? dev->driver->name : "");
+	if (ret == 0) {
+		device_deferred_wake(dev);
 		goto out;
+	}
 
 	if (ret == -EPROBE_DEFER) {
 		list_del(&dev->active);
-		list_add(&dev->active, &deferred);
+		device_collect_suppliers(dev);
+		dev->deferred_stamp = deferred_progress;
+		list_add_tail(&dev->active, &deferred);
 
 		/*
 		 * -EPROBE_DEFER should never appear on a deep-probe machine so
@@ -311,6 +480,9 @@ void free_device_res(struct device *dev)
 	free(dev->unique_name);
 	dev->unique_name = NULL;
 	free(dev->deferred_probe_reason);
+	free(dev->deferred_suppliers);
+	dev->deferred_suppliers = NULL;
+	dev->num_deferred_suppliers = 0;
 }
 EXPORT_SYMBOL(free_device_res);
 
@@ -329,9 +501,16 @@ void free_device(struct device *dev)
 EXPORT_SYMBOL(free_device);
 
 /*
- * Loop over list of deferred devices as long as at least one
- * device is successfully probed. Devices that again request
- * deferral are re-added to deferred list in device_probe().
+ * Probe deferred devices again once all drivers are registered. Each
+ * deferred device is retried once, afterwards only when a supplier it is
+ * waiting for has been probed: device_probe() queues these on deferred_ready
+ * and they are probed from there until the queue runs empty.
+ *
+ * As the supplier detection only knows the common bindings, the devices
+ * still deferred without any known pending supplier are then retried once
+ * more if any device has been probed since their last attempt, to catch the
+ * dependencies it missed. Devices waiting for a known supplier are left
+ * alone, they can't succeed before that supplier is probed.
  * For devices finally left in deferred list -EPROBE_DEFER
  * becomes a fatal error.
  */
@@ -339,27 +518,31 @@ static int device_probe_deferred(void)
 {
 	struct device *dev, *tmp;
 	struct driver *drv;
-	bool success;
 
-	do {
-		success = false;
+	list_splice_tail_init(&deferred, &deferred_ready);
 
-		if (list_empty(&deferred))
-			return 0;
-
-		list_for_each_entry_safe(dev, tmp, &deferred, active) {
+	while (1) {
+		while (!list_empty(&deferred_ready)) {
+			dev = list_first_entry(&deferred_ready, struct device,
+					       active);
 			list_del(&dev->active);
 			INIT_LIST_HEAD(&dev->active);
 
 			dev_dbg(dev, "re-probe device\n");
 			bus_for_each_driver(dev->bus, drv) {
-				if (match(drv, dev))
-					continue;
-				success = true;
-				break;
+				if (!match(drv, dev))
+					break;
 			}
 		}
-	} while (success);
+
+		list_for_each_entry_safe(dev, tmp, &deferred, active)
+			if (!dev->num_deferred_suppliers &&
+			    dev->deferred_stamp != deferred_progress)
+				list_move_tail(&dev->active, &deferred_ready);
+
+		if (list_empty(&deferred_ready))
+			break;
+	}
 
 	list_for_each_entry(dev, &deferred, active) {
 		if (dev->deferred_probe_reason)
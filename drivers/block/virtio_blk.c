@@ -7,33 +7,60 @@
 #include <common.h>
 #include <driver.h>
 #include <block.h>
+#include <clock.h>
 #include <disks.h>
+#include <dma.h>
+#include <linux/sizes.h>
 #include <linux/virtio_types.h>
 #include <linux/virtio.h>
 #include <linux/virtio_ring.h>
 #include <uapi/linux/virtio_blk.h>
 
+/* maximum number of requests in flight on the virtqueue */
+#define VIRTIO_BLK_MAX_REQS	16
+/* don't split transfers into segments smaller than this */
+#define VIRTIO_BLK_MIN_SEG	(SZ_64K >> SECTOR_SHIFT)
+
+/*
+ * Header and status of a single request. Each one gets its own cache
+ * line(s), as the status is written by the device while the CPU fills in
+ * the header of the next request.
+ */
+struct virtio_blk_req {
+	struct virtio_blk_outhdr hdr;
+	u8 status;
+} __aligned(DMA_ALIGNMENT);
+
 struct virtio_blk_priv {
 	struct virtqueue *vq;
 	struct virtio_device *vdev;
 	struct block_device blk;
+
+	struct virtio_blk_req *reqs;
+	u32 max_reqs;
+
+	u64 requests;
+	u64 read_bytes;
+	u64 read_ns;
+	u64 write_bytes;
+	u64 write_ns;
 };
 
-static int virtio_blk_do_req(struct virtio_blk_priv *priv, void *buffer,
-			     sector_t sector, blkcnt_t blkcnt, u32 type)
+static int virtio_blk_add_req(struct virtio_blk_priv *priv,
+			      struct virtio_blk_req *req, void *buffer,
+			      sector_t sector, blkcnt_t blkcnt, u32 type)
 {
 	unsigned int num_out = 0, num_in = 0;
 	struct virtio_sg *sgs[3];
-	u8 status;
-	int ret;
 
-	struct virtio_blk_outhdr out_hdr = {
-		.type = cpu_to_virtio32(priv->vdev, type),
-		.sector = cpu_to_virtio64(priv->vdev, sector),
-	};
-	struct virtio_sg hdr_sg = { &out_hdr, sizeof(out_hdr) };
+	struct virtio_sg hdr_sg = { &req->hdr, sizeof(req->hdr) };
 	struct virtio_sg data_sg = { buffer, blkcnt * 512 };
-	struct virtio_sg status_sg = { &status, sizeof(status) };
+	struct virtio_sg status_sg = { &req->status, sizeof(req->status) };
+
+	req->hdr.type = cpu_to_virtio32(priv->vdev, type);
+	req->hdr.ioprio = 0;
+	req->hdr.sector = cpu_to_virtio64(priv->vdev, sector);
+	req->status = VIRTIO_BLK_S_IOERR;
 
 	sgs[num_out++] = &hdr_sg;
 
@@ -48,32 +75,93 @@ static int virtio_blk_do_req(struct virtio_blk_priv *priv, void *buffer,
 
 	sgs[num_out + num_in++] = &status_sg;
 
-	ret = virtqueue_add(priv->vq, sgs, num_out, num_in);
-	if (ret)
-		return ret;
+	return virtqueue_add(priv->vq, sgs, num_out, num_in);
+}
+
+/*
+ * Split a transfer into segments which are all put on the virtqueue before
+ * the device is notified, so the host can process them in parallel. Once
+ * the batch is complete the segments are checked in order, so the first
+ * failing one determines the result.
+ */
+static int virtio_blk_do_req(struct virtio_blk_priv *priv, void *buffer,
+			     sector_t sector, blkcnt_t blkcnt, u32 type)
+{
+	blkcnt_t seg;
+	int ret = 0;
+
+	seg = max_t(blkcnt_t, DIV_ROUND_UP(blkcnt, priv->max_reqs),
+		    VIRTIO_BLK_MIN_SEG);
+
+	while (blkcnt) {
+		unsigned int nreqs = 0, i;
+
+		while (blkcnt && nreqs < priv->max_reqs) {
+			blkcnt_t now = min(blkcnt, seg);
+
+			ret = virtio_blk_add_req(priv, &priv->reqs[nreqs],
+						 buffer, sector, now, type);
+			if (ret)
+				break;
+
+			nreqs++;
+			buffer += now * 512;
+			sector += now;
+			blkcnt -= now;
+		}
 
-	virtqueue_kick(priv->vq);
+		/* a full virtqueue only limits the size of this batch */
+		if (!nreqs)
+			return ret;
 
-	while (!virtqueue_get_buf(priv->vq, NULL))
-		;
+		virtqueue_kick(priv->vq);
 
-	return status == VIRTIO_BLK_S_OK ? 0 : -EIO;
+		for (i = 0; i < nreqs; i++)
+			while (!virtqueue_get_buf(priv->vq, NULL))
+				;
+
+		priv->requests += nreqs;
+
+		for (i = 0; i < nreqs; i++)
+			if (priv->reqs[i].status != VIRTIO_BLK_S_OK)
+				return -EIO;
+	}
+
+	return 0;
 }
 
 static int virtio_blk_read(struct block_device *blk, void *buffer,
 			   sector_t start, blkcnt_t blkcnt)
 {
 	struct virtio_blk_priv *priv = container_of(blk, struct virtio_blk_priv, blk);
-	return virtio_blk_do_req(priv, buffer, start, blkcnt,
-				 VIRTIO_BLK_T_IN);
+	u64 t = get_time_ns();
+	int ret;
+
+	ret = virtio_blk_do_req(priv, buffer, start, blkcnt,
+				VIRTIO_BLK_T_IN);
+	if (!ret) {
+		priv->read_bytes += blkcnt * 512;
+		priv->read_ns += get_time_ns() - t;
+	}
+
+	return ret;
 }
 
 static int virtio_blk_write(struct block_device *blk, const void *buffer,
 			    sector_t start, blkcnt_t blkcnt)
 {
 	struct virtio_blk_priv *priv = container_of(blk, struct virtio_blk_priv, blk);
-	return virtio_blk_do_req(priv, (void *)buffer, start, blkcnt,
-				 VIRTIO_BLK_T_OUT);
+	u64 t = get_time_ns();
+	int ret;
+
+	ret = virtio_blk_do_req(priv, (void *)buffer, start, blkcnt,
+				VIRTIO_BLK_T_OUT);
+	if (!ret) {
+		priv->write_bytes += blkcnt * 512;
+		priv->write_ns += get_time_ns() - t;
+	}
+
+	return ret;
 }
 
 static struct block_device_ops virtio_blk_ops = {
@@ -81,6 +169,32 @@ static struct block_device_ops virtio_blk_ops = {
 	.write	= virtio_blk_write,
 };
 
+static int virtio_blk_set_max_reqs(struct param_d *p, void *priv)
+{
+	struct virtio_blk_priv *vblk = priv;
+	/* each request takes three descriptors */
+	u32 max = min_t(u32, virtqueue_get_vring_size(vblk->vq) / 3,
+			VIRTIO_BLK_MAX_REQS);
+
+	if (!vblk->max_reqs || vblk->max_reqs > max)
+		return -EINVAL;
+
+	return 0;
+}
+
+static void virtio_blk_add_params(struct virtio_blk_priv *priv)
+{
+	struct device *dev = &priv->vdev->dev;
+
+	dev_add_param_uint32(dev, "max_requests", virtio_blk_set_max_reqs,
+			     NULL, &priv->max_reqs, "%u", priv);
+	dev_add_param_uint64_ro(dev, "requests", &priv->requests, "%llu");
+	dev_add_param_uint64_ro(dev, "read_bytes", &priv->read_bytes, "%llu");
+	dev_add_param_uint64_ro(dev, "read_ns", &priv->read_ns, "%llu");
+	dev_add_param_uint64_ro(dev, "write_bytes", &priv->write_bytes, "%llu");
+	dev_add_param_uint64_ro(dev, "write_ns", &priv->write_ns, "%llu");
+}
+
 static int virtio_blk_probe(struct virtio_device *vdev)
 {
 	struct virtio_blk_priv *priv;
@@ -97,6 +211,10 @@ static int virtio_blk_probe(struct virtio_device *vdev)
 	priv->vdev = vdev;
 	vdev->priv = priv;
 
+	priv->max_reqs = clamp_t(u32, virtqueue_get_vring_size(priv->vq) / 3,
+				 1, VIRTIO_BLK_MAX_REQS);
+	priv->reqs = dma_alloc(VIRTIO_BLK_MAX_REQS * sizeof(*priv->reqs));
+
 	devnum = cdev_find_free_index("virtioblk");
 	priv->blk.cdev.name = xasprintf("virtioblk%d", devnum);
 	priv->blk.dev = &vdev->dev;
@@ -105,7 +223,13 @@ static int virtio_blk_probe(struct virtio_device *vdev)
 	priv->blk.num_blocks = cap;
 	priv->blk.ops = &virtio_blk_ops;
 
-	return blockdevice_register(&priv->blk);
+	ret = blockdevice_register(&priv->blk);
+	if (ret)
+		return ret;
+
+	virtio_blk_add_params(priv);
+
+	return 0;
 }
 
 static void virtio_blk_remove(struct virtio_device *vdev)
@@ -116,6 +240,7 @@ static void virtio_blk_remove(struct virtio_device *vdev)
 	blockdevice_unregister(&priv->blk);
 	vdev->config->del_vqs(vdev);
 
+	dma_free(priv->reqs);
 	free(priv);
 }
 
@@ -318,6 +318,15 @@ static int fsl_esdhc_probe(struct device *dev)
 	if (esdhc_is_usdhc(host))
 		mci->host_caps |= MMC_CAP_MMC_3_3V_DDR | MMC_CAP_MMC_1_8V_DDR;
 
+	/*
+	 * Commands are sent as they are, without Auto CMD12. The SoCs that
+	 * need special handling of CMD12 to end multi block transfers keep
+	 * ending them that way.
+	 */
+	if (!(host->socdata->flags &
+	      (ESDHC_FLAG_MULTIBLK_NO_INT | ESDHC_FLAG_ENGCM07207)))
+		mci->host_caps |= MMC_CAP_CMD23;
+
 	rate = clk_get_rate(host->clk);
 	host->mci.f_min = rate >> 12;
 	if (host->mci.f_min < 200000)
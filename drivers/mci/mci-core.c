@@ -205,6 +205,33 @@ static int mci_poll_until_ready(struct mci *mci, int timeout_ms)
 }
 
 
+/* CMD23 has a 16 bit block count */
+#define MCI_SBC_MAX_BLOCKS	0xffff
+
+/**
+ * Announce the number of blocks of the following multiple block transfer
+ * @param mci MCI instance
+ * @param blocks Block count of the transfer
+ * @return true when the transfer ends without CMD12 STOP_TRANSMISSION
+ *
+ * With a pre-defined block count the card knows the size of the transfer
+ * in advance, which many eMMCs reward with a faster transfer, and saves
+ * the additional STOP_TRANSMISSION command after each request.
+ */
+static bool mci_set_block_count(struct mci *mci, int blocks)
+{
+	struct mci_cmd cmd;
+
+	if (blocks < 2 || blocks > MCI_SBC_MAX_BLOCKS ||
+	    !(mci_caps(mci) & MMC_CAP_CMD23))
+		return false;
+
+	mci_setup_cmd(&cmd, MMC_CMD_SET_BLOCK_COUNT, blocks, MMC_RSP_R1);
+
+	/* fall back to an open-ended transfer */
+	return mci_send_cmd(mci, &cmd, NULL) == 0;
+}
+
 /**
  * Write one or several blocks of data to the card
  * @param mci_dev MCI instance
@@ -220,6 +247,7 @@ static int mci_block_write(struct mci *mci, const void *src, int blocknum,
 	struct mci_data data;
 	const void *buf;
 	unsigned mmccmd;
+	bool sbc;
 	int ret;
 
 	/*
@@ -245,6 +273,8 @@ static int mci_block_write(struct mci *mci, const void *src, int blocknum,
 		buf = src;
 	}
 
+	sbc = mci_set_block_count(mci, blocks);
+
 	mci_setup_cmd(&cmd,
 		mmccmd,
 		mci->high_capacity != 0 ? blocknum : blocknum * mci->write_bl_len,
@@ -257,7 +287,7 @@ static int mci_block_write(struct mci *mci, const void *src, int blocknum,
 
 	ret = mci_send_cmd(mci, &cmd, &data);
 
-	if (ret || blocks > 1) {
+	if (ret || (blocks > 1 && !sbc)) {
 		mci_setup_cmd(&cmd, MMC_CMD_STOP_TRANSMISSION, 0, MMC_RSP_R1b);
 		mci_send_cmd(mci, &cmd, NULL);
         }
@@ -279,12 +309,15 @@ static int mci_read_block(struct mci *mci, void *dst, int blocknum,
 	struct mci_data data;
 	int ret;
 	unsigned mmccmd;
+	bool sbc;
 
 	if (blocks > 1)
 		mmccmd = MMC_CMD_READ_MULTIPLE_BLOCK;
 	else
 		mmccmd = MMC_CMD_READ_SINGLE_BLOCK;
 
+	sbc = mci_set_block_count(mci, blocks);
+
 	mci_setup_cmd(&cmd,
 		mmccmd,
 		mci->high_capacity != 0 ? blocknum : blocknum * mci->read_bl_len,
@@ -297,7 +330,7 @@ static int mci_read_block(struct mci *mci, void *dst, int blocknum,
 
 	ret = mci_send_cmd(mci, &cmd, &data);
 
-	if (ret || blocks > 1) {
+	if (ret || (blocks > 1 && !sbc)) {
 		mci_setup_cmd(&cmd, MMC_CMD_STOP_TRANSMISSION, 0, MMC_RSP_R1b);
 		mci_send_cmd(mci, &cmd, NULL);
 	}
@@ -617,6 +650,9 @@ static int mmc_change_freq(struct mci *mci)
 	mci->ext_csd = xmalloc(512);
 	mci->card_caps = 0;
 
+	if (mci->version >= MMC_VERSION_3)
+		mci->card_caps |= MMC_CAP_CMD23;
+
 	/* Only version 4 supports high-speed */
 	if (mci->version < MMC_VERSION_4)
 		return 0;
@@ -793,6 +829,9 @@ static int sd_change_freq(struct mci *mci)
 	if (mci->scr[0] & SD_DATA_4BIT)
 		mci->card_caps |= MMC_CAP_4_BIT_DATA;
 
+	if (mci->scr[0] & SD_SCR_CMD23_SUPPORT)
+		mci->card_caps |= MMC_CAP_CMD23;
+
 	/* Version 1.0 doesn't support switching */
 	if (mci->version == SD_VERSION_1_0)
 		return 0;
@@ -1733,7 +1772,7 @@ static const char *mci_timing_tostr(unsigned timing)
 
 static void mci_print_caps(unsigned caps)
 {
-	printf("  capabilities: %s%s%s%s%s%s%s%s\n",
+	printf("  capabilities: %s%s%s%s%s%s%s%s%s\n",
 		caps & MMC_CAP_4_BIT_DATA ? "4bit " : "",
 		caps & MMC_CAP_8_BIT_DATA ? "8bit " : "",
 		caps & MMC_CAP_SD_HIGHSPEED ? "sd-hs " : "",
@@ -1741,7 +1780,8 @@ static void mci_print_caps(unsigned caps)
 		caps & MMC_CAP_MMC_HIGHSPEED_52MHZ ? "mmc-52MHz " : "",
 		caps & MMC_CAP_MMC_3_3V_DDR ? "ddr-3.3v " : "",
 		caps & MMC_CAP_MMC_1_8V_DDR ? "ddr-1.8v " : "",
-		caps & MMC_CAP_MMC_1_2V_DDR ? "ddr-1.2v " : "");
+		caps & MMC_CAP_MMC_1_2V_DDR ? "ddr-1.2v " : "",
+		caps & MMC_CAP_CMD23 ? "cmd23 " : "");
 }
 
 /**
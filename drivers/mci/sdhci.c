@@ -6,6 +6,7 @@
 #include <io.h>
 #include <dma.h>
 #include <linux/bitfield.h>
+#include <linux/sizes.h>
 
 #include "sdhci.h"
 
@@ -160,6 +161,68 @@ void sdhci_setup_data_pio(struct sdhci *sdhci, struct mci_data *data)
 		      SDHCI_TRANSFER_BLOCK_SIZE(data->blocksize) | data->blocks << 16);
 }
 
+static void sdhci_set_dma_mode(struct sdhci *host, u8 mode)
+{
+	u8 ctrl;
+
+	ctrl = sdhci_read8(host, SDHCI_HOST_CONTROL);
+	ctrl &= ~SDHCI_CTRL_DMA_MASK;
+	ctrl |= mode;
+	sdhci_write8(host, SDHCI_HOST_CONTROL, ctrl);
+}
+
+static void sdhci_adma_write_desc(struct sdhci *host, void **desc,
+				  dma_addr_t addr, unsigned int len,
+				  unsigned int cmd)
+{
+	struct sdhci_adma2_64_desc *dma_desc = *desc;
+
+	/* the 32 bit descriptor is a prefix of the 64 bit one */
+	dma_desc->cmd = cpu_to_le16(cmd);
+	dma_desc->len = cpu_to_le16(len);
+	dma_desc->addr_lo = cpu_to_le32(lower_32_bits(addr));
+
+	if (host->adma_desc_size == sizeof(struct sdhci_adma2_64_desc))
+		dma_desc->addr_hi = cpu_to_le32(upper_32_bits(addr));
+
+	*desc += host->adma_desc_size;
+}
+
+/*
+ * Describe the mapped buffer with a descriptor chain, so the whole
+ * transfer runs without the CPU restarting it at SDMA boundaries.
+ */
+static void sdhci_adma_table_setup(struct sdhci *host, dma_addr_t addr,
+				   unsigned int nbytes)
+{
+	void *desc = host->adma_table;
+	unsigned int len;
+
+	while (nbytes) {
+		len = min_t(unsigned int, nbytes, SDHCI_ADMA2_BOUNDARY -
+			    (addr & (SDHCI_ADMA2_BOUNDARY - 1)));
+
+		sdhci_adma_write_desc(host, &desc, addr, len, ADMA2_TRAN_VALID);
+
+		addr += len;
+		nbytes -= len;
+	}
+
+	/* mark the last descriptor as the end */
+	desc -= host->adma_desc_size;
+	((struct sdhci_adma2_32_desc *)desc)->cmd |= cpu_to_le16(ADMA2_END);
+
+	sdhci_write32(host, SDHCI_ADMA_ADDRESS, lower_32_bits(host->adma_addr));
+
+	if (host->adma_desc_size == sizeof(struct sdhci_adma2_64_desc)) {
+		sdhci_write32(host, SDHCI_ADMA_ADDRESS_HI,
+			      upper_32_bits(host->adma_addr));
+		sdhci_set_dma_mode(host, SDHCI_CTRL_ADMA64);
+	} else {
+		sdhci_set_dma_mode(host, SDHCI_CTRL_ADMA32);
+	}
+}
+
 void sdhci_setup_data_dma(struct sdhci *sdhci, struct mci_data *data,
 			  dma_addr_t *dma)
 {
@@ -188,7 +251,10 @@ void sdhci_setup_data_dma(struct sdhci *sdhci, struct mci_data *data,
 		return;
 	}
 
-	sdhci_write32(sdhci, SDHCI_DMA_ADDRESS, *dma);
+	if (sdhci->adma_table)
+		sdhci_adma_table_setup(sdhci, *dma, nbytes);
+	else
+		sdhci_write32(sdhci, SDHCI_DMA_ADDRESS, *dma);
 }
 
 int sdhci_transfer_data_dma(struct sdhci *sdhci, struct mci_data *data,
@@ -222,7 +288,14 @@ int sdhci_transfer_data_dma(struct sdhci *sdhci, struct mci_data *data,
 			goto out;
 		}
 
-		if (irqstat & SDHCI_INT_DMA) {
+		if (irqstat & SDHCI_INT_ADMA_ERROR) {
+			dev_err(dev, "ADMA error: 0x%02x\n",
+				sdhci_read8(sdhci, SDHCI_ADMA_ERROR));
+			ret = -EIO;
+			goto out;
+		}
+
+		if ((irqstat & SDHCI_INT_DMA) && !sdhci->adma_table) {
 			u32 addr = sdhci_read32(sdhci, SDHCI_DMA_ADDRESS);
 
 			/*
@@ -244,7 +317,7 @@ int sdhci_transfer_data_dma(struct sdhci *sdhci, struct mci_data *data,
 	else
 		dma_unmap_single(dev, dma, nbytes, DMA_TO_DEVICE);
 
-	return 0;
+	return ret;
 }
 
 int sdhci_transfer_data_pio(struct sdhci *sdhci, struct mci_data *data)
@@ -526,6 +599,47 @@ void __sdhci_read_caps(struct sdhci *host, const u16 *ver,
 	}
 }
 
+/*
+ * Use ADMA2 instead of SDMA for DMA transfers when the controller
+ * supports it. The descriptor table is allocated once and sized for
+ * requests of up to max_req_size.
+ */
+static void sdhci_setup_adma(struct sdhci *host)
+{
+	struct mci_host *mci = host->mci;
+	unsigned int max_req_size;
+
+	if (IN_PBL)
+		return;
+
+	if (host->version < SDHCI_SPEC_200 ||
+	    !(host->caps & SDHCI_CAN_DO_ADMA2) ||
+	    (host->quirks & SDHCI_QUIRK_BROKEN_ADMA))
+		return;
+
+	if (host->caps & SDHCI_CAN_64BIT)
+		host->adma_desc_size = sizeof(struct sdhci_adma2_64_desc);
+	else
+		host->adma_desc_size = sizeof(struct sdhci_adma2_32_desc);
+
+	host->adma_table = dma_alloc_coherent(SDHCI_ADMA2_DESC_NUM *
+					      host->adma_desc_size,
+					      &host->adma_addr);
+	if (!host->adma_table) {
+		dev_warn(mci->hw_dev, "cannot allocate ADMA table, using SDMA\n");
+		return;
+	}
+
+	/* one descriptor more for a buffer not aligned to the boundary */
+	max_req_size = (SDHCI_ADMA2_DESC_NUM - 1) * SDHCI_ADMA2_BOUNDARY;
+	if (!mci->max_req_size || mci->max_req_size > max_req_size)
+		mci->max_req_size = max_req_size;
+
+	dev_dbg(mci->hw_dev, "using %d bit ADMA2\n",
+		host->adma_desc_size == sizeof(struct sdhci_adma2_64_desc) ?
+		64 : 32);
+}
+
 int sdhci_setup_host(struct sdhci *host)
 {
 	struct mci_host *mci = host->mci;
@@ -570,5 +684,11 @@ int sdhci_setup_host(struct sdhci *host)
 
 	host->sdma_boundary = SDHCI_DMA_BOUNDARY_512K;
 
+	/* the block count register is 16 bit wide */
+	if (!mci->max_req_size || mci->max_req_size > SDHCI_MAX_BLK_COUNT * 512)
+		mci->max_req_size = SDHCI_MAX_BLK_COUNT * 512;
+
+	sdhci_setup_adma(host);
+
 	return 0;
 }
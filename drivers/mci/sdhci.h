@@ -20,6 +20,7 @@
 #define  SDHCI_DMA_BOUNDARY(x)			(((x) & 0x7) << 12)
 #define  SDHCI_TRANSFER_BLOCK_SIZE(x)		((x) & 0xfff)
 #define SDHCI_BLOCK_COUNT					0x06
+#define  SDHCI_MAX_BLK_COUNT			0xffff
 #define SDHCI_ARGUMENT						0x08
 #define SDHCI_TRANSFER_MODE__COMMAND				0x0c
 #define SDHCI_TRANSFER_MODE					0x0c
@@ -97,6 +98,7 @@
 #define  SDHCI_RESET_DATA			BIT(2)
 #define SDHCI_INT_STATUS					0x30
 #define SDHCI_INT_NORMAL_STATUS					0x30
+#define  SDHCI_INT_ADMA_ERROR			BIT(25)
 #define  SDHCI_INT_DATA_END_BIT			BIT(22)
 #define  SDHCI_INT_DATA_CRC			BIT(21)
 #define  SDHCI_INT_DATA_TIMEOUT			BIT(20)
@@ -128,6 +130,7 @@
 #define  SDHCI_CAN_DO_ADMA2			0x00080000
 #define  SDHCI_CAN_DO_ADMA1			0x00100000
 #define  SDHCI_CAN_DO_HISPD			0x00200000
+#define  SDHCI_CAN_64BIT			0x10000000
 #define  SDHCI_CAN_DO_SDMA			0x00400000
 #define  SDHCI_CAN_DO_SUSPEND			0x00800000
 #define  SDHCI_CAN_VDD_330			0x01000000
@@ -150,6 +153,10 @@
 #define  SDHCI_CAN_DO_ADMA3			0x08000000
 #define  SDHCI_SUPPORT_HS400			0x80000000 /* Non-standard */
 
+#define SDHCI_ADMA_ERROR					0x54
+#define SDHCI_ADMA_ADDRESS					0x58
+#define SDHCI_ADMA_ADDRESS_HI					0x5c
+
 #define SDHCI_PRESET_FOR_SDR12	0x66
 #define SDHCI_PRESET_FOR_SDR25	0x68
 #define SDHCI_PRESET_FOR_SDR50	0x6A
@@ -178,6 +185,33 @@
 #define SDHCI_MAX_DIV_SPEC_200	256
 #define SDHCI_MAX_DIV_SPEC_300	2046
 
+/* ADMA2 descriptor attributes */
+#define ADMA2_TRAN_VALID	0x21
+#define ADMA2_END		0x2
+
+/* 32 bit addresses */
+struct sdhci_adma2_32_desc {
+	__le16	cmd;
+	__le16	len;
+	__le32	addr;
+} __packed __aligned(4);
+
+/* 64 bit addresses, the 96 bit descriptor format without v4 mode */
+struct sdhci_adma2_64_desc {
+	__le16	cmd;
+	__le16	len;
+	__le32	addr_lo;
+	__le32	addr_hi;
+} __packed __aligned(4);
+
+/*
+ * A descriptor never crosses a 32K boundary, which keeps it shorter than
+ * the 64K that not all controllers can express, and away from the
+ * 128M boundaries that some cannot cross.
+ */
+#define SDHCI_ADMA2_BOUNDARY	SZ_32K
+#define SDHCI_ADMA2_DESC_NUM	512
+
 struct sdhci {
 	u32 (*read32)(struct sdhci *host, int reg);
 	u16 (*read16)(struct sdhci *host, int reg);
@@ -197,6 +231,7 @@ struct sdhci {
 	bool preset_enabled; /* Preset is enabled */
 
 	unsigned int quirks;
+#define SDHCI_QUIRK_BROKEN_ADMA			BIT(6)
 #define SDHCI_QUIRK_MISSING_CAPS		BIT(27)
 	unsigned int quirks2;
 #define SDHCI_QUIRK2_CLOCK_DIV_ZERO_BROKEN	BIT(15)
@@ -205,6 +240,10 @@ struct sdhci {
 	bool read_caps;	/* Capability flags have been read */
 	u32 sdma_boundary;
 
+	void *adma_table;	/* ADMA2 descriptors, NULL when using SDMA */
+	dma_addr_t adma_addr;
+	size_t adma_desc_size;
+
 	struct mci_host	*mci;
 };
 
@@ -239,6 +239,99 @@ static void nvme_setup_flush(struct nvme_ns *ns, struct nvme_command *cmnd)
 	cmnd->common.nsid = cpu_to_le32(ns->head->ns_id);
 }
 
+static void nvme_rw_error(struct nvme_ns *ns, sector_t block,
+			  blkcnt_t num_blocks, int ret)
+{
+	if (ret < 0)
+		dev_err(ns->ctrl->dev,
+			"I/O failed: block: %llu, num blocks: %llu: %pe\n",
+			block, num_blocks, ERR_PTR(ret));
+	else
+		dev_err(ns->ctrl->dev,
+			"I/O failed: block: %llu, num blocks: %llu, status code type: %xh, status code %02xh\n",
+			block, num_blocks, (ret >> 8) & 0xf,
+			ret & 0xff);
+}
+
+/*
+ * Don't split requests into commands smaller than this when spreading
+ * them over the queue, the per-command overhead would dominate.
+ * In units of 512 bytes.
+ */
+#define NVME_MIN_QUEUED_SECTORS	256
+
+static bool nvme_can_queue_rw(struct nvme_ns *ns, blkcnt_t num_blocks)
+{
+	const struct nvme_ctrl_ops *ops = ns->ctrl->ops;
+
+	if (!ops->submit_async_cmd || !ops->reap_async_cmds || !ops->queue_depth)
+		return false;
+
+	if (ops->queue_depth(ns->ctrl, NVME_QID_IO) < 2)
+		return false;
+
+	return num_blocks > NVME_MIN_QUEUED_SECTORS >> (ns->lba_shift - 9);
+}
+
+/*
+ * Split a large transfer into several commands which are all submitted
+ * before waiting for the first one, so that the controller can work on
+ * them in parallel. Completions are reaped in bulk whenever the queue
+ * runs full and once more at the end.
+ */
+static int nvme_submit_queued_rw(struct nvme_ns *ns, struct nvme_command *cmnd,
+				 void *buffer, sector_t block,
+				 blkcnt_t num_blocks)
+{
+	struct nvme_ctrl *ctrl = ns->ctrl;
+	const struct nvme_ctrl_ops *ops = ctrl->ops;
+	const u32 max_hw_sectors =
+		ctrl->max_hw_sectors >> (ns->lba_shift - 9);
+	const u32 min_sectors = NVME_MIN_QUEUED_SECTORS >> (ns->lba_shift - 9);
+	unsigned int depth = ops->queue_depth(ctrl, NVME_QID_IO);
+	sector_t start = block;
+	blkcnt_t total = num_blocks;
+	u32 max_chunk;
+	int ret = 0, err;
+
+	/* spread the transfer evenly over the available queue slots */
+	max_chunk = DIV_ROUND_UP(num_blocks, depth);
+	max_chunk = min(max(max_chunk, min_sectors), max_hw_sectors);
+
+	while (num_blocks) {
+		const u32 chunk = min_t(blkcnt_t, num_blocks, max_chunk);
+
+		nvme_setup_rw(ns, cmnd, block, chunk);
+
+		ret = ops->submit_async_cmd(ctrl, cmnd, buffer,
+					    chunk << ns->lba_shift,
+					    NVME_QID_IO);
+		if (ret == -EBUSY) {
+			ret = ops->reap_async_cmds(ctrl, false, 0, NVME_QID_IO);
+			if (ret)
+				break;
+			continue;
+		}
+		if (ret)
+			break;
+
+		num_blocks -= chunk;
+		buffer += chunk << ns->lba_shift;
+		block += chunk;
+	}
+
+	err = ops->reap_async_cmds(ctrl, true, 0, NVME_QID_IO);
+	if (!ret)
+		ret = err;
+
+	if (ret) {
+		nvme_rw_error(ns, start, total, ret);
+		return -EIO;
+	}
+
+	return 0;
+}
+
 static int nvme_submit_sync_rw(struct nvme_ns *ns, struct nvme_command *cmnd,
 			       void *buffer, sector_t block, blkcnt_t num_blocks)
 {
@@ -250,6 +343,10 @@ static int nvme_submit_sync_rw(struct nvme_ns *ns, struct nvme_command *cmnd,
 		ns->ctrl->max_hw_sectors >> (ns->lba_shift - 9);
 	int ret;
 
+	if (nvme_can_queue_rw(ns, num_blocks))
+		return nvme_submit_queued_rw(ns, cmnd, buffer, block,
+					     num_blocks);
+
 	if (num_blocks > max_hw_sectors) {
 		while (num_blocks) {
 			const u32 chunk = min_t(blkcnt_t, num_blocks,
@@ -261,7 +358,7 @@ static int nvme_submit_sync_rw(struct nvme_ns *ns, struct nvme_command *cmnd,
 				break;
 
 			num_blocks -= chunk;
-			buffer += chunk;
+			buffer += chunk << ns->lba_shift;
 			block += chunk;
 		}
 
@@ -275,10 +372,7 @@ static int nvme_submit_sync_rw(struct nvme_ns *ns, struct nvme_command *cmnd,
 				     0, NVME_QID_IO);
 
 	if (ret) {
-		dev_err(ns->ctrl->dev,
-			"I/O failed: block: %llu, num blocks: %llu, status code type: %xh, status code %02xh\n",
-			block, num_blocks, (ret >> 8) & 0xf,
-			ret & 0xff);
+		nvme_rw_error(ns, block, num_blocks, ret);
 		return -EIO;
 	}
 
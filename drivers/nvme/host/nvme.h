@@ -78,6 +78,22 @@ struct nvme_ctrl_ops {
 			       void *buffer,
 			       unsigned bufflen,
 			       unsigned timeout, int qid);
+
+	/*
+	 * Optional: queue a command without waiting for it. Returns -EBUSY
+	 * when the queue is full, in which case reap_async_cmds() must be
+	 * called before submitting more.
+	 */
+	int (*submit_async_cmd)(struct nvme_ctrl *ctrl,
+				struct nvme_command *cmd,
+				void *buffer, unsigned bufflen, int qid);
+	/*
+	 * Wait for one (or, with @all set, every) outstanding asynchronous
+	 * command. Returns the first error seen since the previous call.
+	 */
+	int (*reap_async_cmds)(struct nvme_ctrl *ctrl, bool all,
+			       unsigned timeout, int qid);
+	unsigned int (*queue_depth)(struct nvme_ctrl *ctrl, int qid);
 };
 
 static inline bool nvme_ctrl_ready(struct nvme_ctrl *ctrl)
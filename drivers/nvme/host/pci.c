@@ -15,17 +15,33 @@
 
 #define NVME_MAX_KB_SZ	4096
 
-static int io_queue_depth = 2;
+static int io_queue_depth = CONFIG_NVME_IO_QUEUE_DEPTH;
 
 struct nvme_dev;
 
+/*
+ * Per-tag request state. Each outstanding command owns one of these, so
+ * several commands can be in flight on a queue at the same time without
+ * sharing PRP lists.
+ */
+struct nvme_iod {
+	struct nvme_request req;	/* must be first */
+	struct nvme_command cmd;
+	__le64 *prp_list;
+	dma_addr_t prp_dma;
+	unsigned int prp_list_size;
+	bool busy;
+	bool async;
+	bool done;
+};
+
 /*
  * An NVM Express queue.  Each device has at least two (one for admin
  * commands and one for I/O commands).
  */
 struct nvme_queue {
 	struct nvme_dev *dev;
-	struct nvme_request *req;
+	struct nvme_iod *iods;
 	struct nvme_command *sq_cmds;
 	volatile struct nvme_completion *cqes;
 	dma_addr_t sq_dma_addr;
@@ -38,6 +54,9 @@ struct nvme_queue {
 	u8 cq_phase;
 
 	u16 counter;
+	u16 inflight;		/* number of busy iods */
+	u16 max_inflight;	/* limit for asynchronous submission */
+	int error;		/* first failed async command since the last reap */
 };
 
 /*
@@ -54,9 +73,7 @@ struct nvme_dev {
 	void __iomem *bar;
 	bool subsystem;
 	struct nvme_ctrl ctrl;
-	__le64 *prp_pool;
-	unsigned int prp_pool_size;
-	dma_addr_t prp_dma;
+	u32 io_depth;
 };
 
 static inline struct nvme_dev *to_nvme_dev(struct nvme_ctrl *ctrl)
@@ -64,10 +81,10 @@ static inline struct nvme_dev *to_nvme_dev(struct nvme_ctrl *ctrl)
 	return container_of(ctrl, struct nvme_dev, ctrl);
 }
 
-static int nvme_pci_setup_prps(struct nvme_dev *dev,
-			       const struct nvme_request *req,
-			       struct nvme_rw_command *cmnd)
+static int nvme_pci_setup_prps(struct nvme_dev *dev, struct nvme_iod *iod)
 {
+	const struct nvme_request *req = &iod->req;
+	struct nvme_rw_command *cmnd = &iod->cmd.rw;
 	int length = req->buffer_len;
 	const int page_size = dev->ctrl.page_size;
 	dma_addr_t dma_addr = req->buffer_dma_addr;
@@ -91,17 +108,28 @@ static int nvme_pci_setup_prps(struct nvme_dev *dev,
 		goto done;
 	}
 
+	/*
+	 * One extra entry per list page for the chain pointer that moves the
+	 * last PRP of a full page to the start of the next one.
+	 */
 	nprps = DIV_ROUND_UP(length, page_size);
-	if (nprps > dev->prp_pool_size) {
-		dma_free_coherent(dev->prp_pool, dev->prp_dma,
-				  dev->prp_pool_size * sizeof(u64));
-		dev->prp_pool_size = nprps;
-		dev->prp_pool = dma_alloc_coherent(nprps * sizeof(u64),
-						   &dev->prp_dma);
+	nprps += DIV_ROUND_UP(nprps, (page_size >> 3) - 1);
+	if (nprps > iod->prp_list_size) {
+		if (iod->prp_list)
+			dma_free_coherent(iod->prp_list, iod->prp_dma,
+					  iod->prp_list_size * sizeof(u64));
+		iod->prp_list_size = 0;
+		iod->prp_list = dma_alloc_coherent(ALIGN(nprps * sizeof(u64),
+							 page_size),
+						   &iod->prp_dma);
+		if (!iod->prp_list)
+			return -ENOMEM;
+		iod->prp_list_size = ALIGN(nprps * sizeof(u64),
+					   page_size) / sizeof(u64);
 	}
 
-	prp_list = dev->prp_pool;
-	prp_dma  = dev->prp_dma;
+	prp_list = iod->prp_list;
+	prp_dma  = iod->prp_dma;
 
 	i = 0;
 	for (;;) {
@@ -128,8 +156,11 @@ static int nvme_pci_setup_prps(struct nvme_dev *dev,
 	return 0;
 }
 
-static int nvme_map_data(struct nvme_dev *dev, struct nvme_request *req)
+static int nvme_map_data(struct nvme_dev *dev, struct nvme_iod *iod)
 {
+	struct nvme_request *req = &iod->req;
+	int ret;
+
 	if (!req->buffer || !req->buffer_len)
 		return 0;
 
@@ -138,7 +169,12 @@ static int nvme_map_data(struct nvme_dev *dev, struct nvme_request *req)
 	if (dma_mapping_error(dev->dev, req->buffer_dma_addr))
 		return -EFAULT;
 
-	return nvme_pci_setup_prps(dev, req, &req->cmd->rw);
+	ret = nvme_pci_setup_prps(dev, iod);
+	if (ret)
+		dma_unmap_single(dev->dev, req->buffer_dma_addr,
+				 req->buffer_len, req->dma_dir);
+
+	return ret;
 }
 
 static void nvme_unmap_data(struct nvme_dev *dev, struct nvme_request *req)
@@ -167,11 +203,15 @@ static int nvme_alloc_queue(struct nvme_dev *dev, int qid, int depth)
 	if (!nvmeq->sq_cmds)
 		goto free_cqdma;
 
+	nvmeq->iods = xzalloc(depth * sizeof(*nvmeq->iods));
+
 	nvmeq->dev = dev;
 	nvmeq->cq_head = 0;
 	nvmeq->cq_phase = 1;
 	nvmeq->q_db = &dev->dbs[qid * 2 * dev->db_stride];
 	nvmeq->q_depth = depth;
+	/* a queue is full when the tail is one entry behind the head */
+	nvmeq->max_inflight = depth - 1;
 	nvmeq->qid = qid;
 	dev->ctrl.queue_count++;
 
@@ -307,10 +347,16 @@ static inline void nvme_ring_cq_doorbell(struct nvme_queue *nvmeq)
 	writel(head, nvmeq->q_db + nvmeq->dev->db_stride);
 }
 
+static void nvme_put_iod(struct nvme_queue *nvmeq, struct nvme_iod *iod)
+{
+	iod->busy = false;
+	nvmeq->inflight--;
+}
+
 static inline void nvme_handle_cqe(struct nvme_queue *nvmeq, u16 idx)
 {
 	volatile struct nvme_completion *cqe = &nvmeq->cqes[idx];
-	struct nvme_request *req = nvmeq->req;
+	struct nvme_iod *iod;
 
 	if (unlikely(cqe->command_id >= nvmeq->q_depth)) {
 		dev_warn(nvmeq->dev->ctrl.dev,
@@ -319,10 +365,23 @@ static inline void nvme_handle_cqe(struct nvme_queue *nvmeq, u16 idx)
 		return;
 	}
 
-	if (WARN_ON(cqe->command_id != req->cmd->common.command_id))
+	iod = &nvmeq->iods[cqe->command_id];
+
+	if (WARN_ON(!iod->busy || iod->done))
 		return;
 
-	nvme_end_request(req, cqe->status, cqe->result);
+	nvme_end_request(&iod->req, cqe->status, cqe->result);
+	nvme_unmap_data(nvmeq->dev, &iod->req);
+	iod->done = true;
+
+	/* synchronous submitters collect the result themselves */
+	if (!iod->async)
+		return;
+
+	if (iod->req.status && !nvmeq->error)
+		nvmeq->error = iod->req.status;
+
+	nvme_put_iod(nvmeq, iod);
 }
 
 static void nvme_complete_cqes(struct nvme_queue *nvmeq, u16 start, u16 end)
@@ -360,34 +419,69 @@ static inline bool nvme_process_cq(struct nvme_queue *nvmeq, u16 *start,
 	return found;
 }
 
-static bool nvme_poll(struct nvme_queue *nvmeq, unsigned int tag)
+/*
+ * Reap all pending completions. Completing the whole batch at once, rather
+ * than stopping at the first matching tag, lets a single doorbell write
+ * acknowledge many commands when the queue is deep.
+ */
+static void nvme_poll(struct nvme_queue *nvmeq)
 {
 	u16 start, end;
-	bool found;
 
 	if (!nvme_cqe_pending(nvmeq))
-		return false;
+		return;
 
-	found = nvme_process_cq(nvmeq, &start, &end, tag);
+	nvme_process_cq(nvmeq, &start, &end, -1);
 
 	nvme_complete_cqes(nvmeq, start, end);
-	return found;
 }
 
-static int nvme_pci_submit_sync_cmd(struct nvme_ctrl *ctrl,
-				    struct nvme_command *cmd,
-				    union nvme_result *result,
-				    void *buffer,
-				    unsigned int buffer_len,
-				    unsigned timeout, int qid)
+static bool nvme_poll_iod(struct nvme_queue *nvmeq, struct nvme_iod *iod)
 {
-	struct nvme_dev *dev = to_nvme_dev(ctrl);
-	struct nvme_queue *nvmeq = &dev->queues[qid];
-	struct nvme_request req = { };
-	const u16 tag = nvmeq->counter++ & (nvmeq->q_depth - 1);
-	enum dma_data_direction dma_dir;
-	int ret;
+	nvme_poll(nvmeq);
 
+	return iod->done;
+}
+
+static bool nvme_poll_inflight(struct nvme_queue *nvmeq, unsigned int max)
+{
+	nvme_poll(nvmeq);
+
+	return nvmeq->inflight <= max;
+}
+
+static struct nvme_iod *nvme_get_iod(struct nvme_queue *nvmeq)
+{
+	struct nvme_iod *iod;
+	int i;
+
+	if (nvmeq->inflight >= nvmeq->q_depth - 1)
+		return NULL;
+
+	for (i = 0; i < nvmeq->q_depth; i++) {
+		u16 tag = nvmeq->counter++ % nvmeq->q_depth;
+
+		iod = &nvmeq->iods[tag];
+		if (iod->busy)
+			continue;
+
+		iod->busy = true;
+		iod->async = false;
+		iod->done = false;
+		memset(&iod->req, 0, sizeof(iod->req));
+		iod->req.cmd = &iod->cmd;
+		iod->cmd.common.command_id = tag;
+		nvmeq->inflight++;
+
+		return iod;
+	}
+
+	return NULL;
+}
+
+static int nvme_pci_dma_dir(struct nvme_command *cmd, int qid,
+			    enum dma_data_direction *dma_dir)
+{
 	switch (qid) {
 	case NVME_QID_ADMIN:
 		switch (cmd->common.opcode) {
@@ -396,10 +490,13 @@ static int nvme_pci_submit_sync_cmd(struct nvme_ctrl *ctrl,
 		case nvme_admin_delete_sq:
 		case nvme_admin_delete_cq:
 		case nvme_admin_set_features:
-			dma_dir = DMA_TO_DEVICE;
+			*dma_dir = DMA_TO_DEVICE;
 			break;
 		case nvme_admin_identify:
-			dma_dir = DMA_FROM_DEVICE;
+			*dma_dir = DMA_FROM_DEVICE;
+			break;
+		case nvme_admin_abort_cmd:
+			*dma_dir = DMA_NONE;
 			break;
 		default:
 			return -EINVAL;
@@ -408,10 +505,10 @@ static int nvme_pci_submit_sync_cmd(struct nvme_ctrl *ctrl,
 	case NVME_QID_IO:
 		switch (cmd->rw.opcode) {
 		case nvme_cmd_write:
-			dma_dir = DMA_TO_DEVICE;
+			*dma_dir = DMA_TO_DEVICE;
 			break;
 		case nvme_cmd_read:
-			dma_dir = DMA_FROM_DEVICE;
+			*dma_dir = DMA_FROM_DEVICE;
 			break;
 		default:
 			return -EINVAL;
@@ -421,33 +518,198 @@ static int nvme_pci_submit_sync_cmd(struct nvme_ctrl *ctrl,
 		return -EINVAL;
 	}
 
-	cmd->common.command_id = tag;
+	return 0;
+}
+
+static struct nvme_iod *nvme_pci_start_cmd(struct nvme_dev *dev,
+					   struct nvme_queue *nvmeq,
+					   struct nvme_command *cmd,
+					   void *buffer,
+					   unsigned int buffer_len,
+					   int qid, bool async)
+{
+	enum dma_data_direction dma_dir;
+	struct nvme_iod *iod;
+	u16 tag;
+	int ret;
 
-	timeout = timeout ?: ADMIN_TIMEOUT;
+	ret = nvme_pci_dma_dir(cmd, qid, &dma_dir);
+	if (ret)
+		return ERR_PTR(ret);
+
+	iod = nvme_get_iod(nvmeq);
+	if (!iod)
+		return ERR_PTR(-EBUSY);
 
-	req.cmd        = cmd;
-	req.buffer     = buffer;
-	req.buffer_len = buffer_len;
-	req.dma_dir    = dma_dir;
+	tag = iod->cmd.common.command_id;
+	iod->cmd = *cmd;
+	iod->cmd.common.command_id = tag;
+	iod->async = async;
 
-	ret = nvme_map_data(dev, &req);
+	iod->req.buffer     = buffer;
+	iod->req.buffer_len = buffer_len;
+	iod->req.dma_dir    = dma_dir;
+
+	ret = nvme_map_data(dev, iod);
 	if (ret) {
 		dev_err(dev->dev, "Failed to map request data\n");
-		return ret;
+		nvme_put_iod(nvmeq, iod);
+		return ERR_PTR(ret);
 	}
 
-	nvme_submit_cmd(nvmeq, cmd);
+	nvme_submit_cmd(nvmeq, &iod->cmd);
 
-	nvmeq->req = &req;
-	ret = wait_on_timeout(timeout, nvme_poll(nvmeq, tag));
-	nvmeq->req = NULL;
+	return iod;
+}
 
-	nvme_unmap_data(dev, &req);
+static int nvme_pci_submit_sync_cmd(struct nvme_ctrl *ctrl,
+				    struct nvme_command *cmd,
+				    union nvme_result *result,
+				    void *buffer,
+				    unsigned int buffer_len,
+				    unsigned timeout, int qid);
+
+/*
+ * A command that timed out may still be processed by the controller, which
+ * could write to its buffer at any time. Ask the controller to abort it and
+ * wait for its completion. If that fails as well, disable the controller to
+ * stop all DMA. Only then the iod and its buffer may be given back. Returns
+ * true when the controller was disabled.
+ */
+static bool nvme_pci_cancel_iod(struct nvme_dev *dev, struct nvme_queue *nvmeq,
+				struct nvme_iod *iod)
+{
+	struct nvme_command c = {};
+
+	if (nvmeq->qid != NVME_QID_ADMIN) {
+		c.abort.opcode = nvme_admin_abort_cmd;
+		c.abort.cid = iod->cmd.common.command_id;
+		c.abort.sqid = cpu_to_le16(nvmeq->qid);
+
+		if (!nvme_pci_submit_sync_cmd(&dev->ctrl, &c, NULL, NULL, 0,
+					      0, NVME_QID_ADMIN) &&
+		    !wait_on_timeout(ADMIN_TIMEOUT, nvme_poll_iod(nvmeq, iod)))
+			return false;
+	}
+
+	dev_err(dev->dev, "cannot abort command %u on queue %d, disabling controller\n",
+		iod->cmd.common.command_id, nvmeq->qid);
+
+	nvme_disable_ctrl(&dev->ctrl, dev->ctrl.cap);
+
+	return true;
+}
+
+static int nvme_pci_submit_sync_cmd(struct nvme_ctrl *ctrl,
+				    struct nvme_command *cmd,
+				    union nvme_result *result,
+				    void *buffer,
+				    unsigned int buffer_len,
+				    unsigned timeout, int qid)
+{
+	struct nvme_dev *dev = to_nvme_dev(ctrl);
+	struct nvme_queue *nvmeq = &dev->queues[qid];
+	struct nvme_iod *iod;
+	int ret;
+
+	timeout = timeout ?: ADMIN_TIMEOUT;
+
+	/* make room if asynchronous commands occupy the whole queue */
+	ret = wait_on_timeout(timeout,
+			      nvme_poll_inflight(nvmeq, nvmeq->q_depth - 2));
+	if (ret)
+		return ret;
+
+	iod = nvme_pci_start_cmd(dev, nvmeq, cmd, buffer, buffer_len,
+				 qid, false);
+	if (IS_ERR(iod))
+		return PTR_ERR(iod);
+
+	ret = wait_on_timeout(timeout, nvme_poll_iod(nvmeq, iod));
+	if (ret) {
+		nvme_pci_cancel_iod(dev, nvmeq, iod);
+		if (!iod->done)
+			nvme_unmap_data(dev, &iod->req);
+	}
 
 	if (result)
-		*result = req.result;
+		*result = iod->req.result;
+
+	nvme_put_iod(nvmeq, iod);
+
+	return ret ?: iod->req.status;
+}
+
+static int nvme_pci_submit_async_cmd(struct nvme_ctrl *ctrl,
+				     struct nvme_command *cmd,
+				     void *buffer, unsigned int buffer_len,
+				     int qid)
+{
+	struct nvme_dev *dev = to_nvme_dev(ctrl);
+	struct nvme_queue *nvmeq = &dev->queues[qid];
+	struct nvme_iod *iod;
+
+	if (nvmeq->error)
+		return -EIO;
+
+	if (nvmeq->inflight >= nvmeq->max_inflight)
+		return -EBUSY;
 
-	return ret ?: req.status;
+	iod = nvme_pci_start_cmd(dev, nvmeq, cmd, buffer, buffer_len,
+				 qid, true);
+
+	return PTR_ERR_OR_ZERO(iod);
+}
+
+static int nvme_pci_reap_async_cmds(struct nvme_ctrl *ctrl, bool all,
+				    unsigned timeout, int qid)
+{
+	struct nvme_dev *dev = to_nvme_dev(ctrl);
+	struct nvme_queue *nvmeq = &dev->queues[qid];
+	unsigned int max = 0;
+	bool disabled = false;
+	int ret, i;
+
+	if (!all && nvmeq->inflight)
+		max = nvmeq->inflight - 1;
+
+	timeout = timeout ?: ADMIN_TIMEOUT;
+
+	ret = wait_on_timeout(timeout, nvme_poll_inflight(nvmeq, max));
+	if (ret) {
+		/* give up on everything still in flight */
+		for (i = 0; i < nvmeq->q_depth; i++) {
+			struct nvme_iod *iod = &nvmeq->iods[i];
+
+			if (!iod->busy || !iod->async)
+				continue;
+
+			if (!disabled)
+				disabled = nvme_pci_cancel_iod(dev, nvmeq, iod);
+
+			/* completed iods were given back by nvme_handle_cqe() */
+			if (iod->done)
+				continue;
+
+			nvme_unmap_data(dev, &iod->req);
+			nvme_put_iod(nvmeq, iod);
+		}
+	}
+
+	if (!ret)
+		ret = nvmeq->error;
+
+	if (ret)
+		nvmeq->error = 0;
+
+	return ret;
+}
+
+static unsigned int nvme_pci_queue_depth(struct nvme_ctrl *ctrl, int qid)
+{
+	struct nvme_dev *dev = to_nvme_dev(ctrl);
+
+	return dev->queues[qid].max_inflight;
 }
 
 static int nvme_pci_configure_admin_queue(struct nvme_dev *dev)
@@ -552,6 +814,19 @@ static int nvme_pci_enable(struct nvme_dev *dev)
 	return 0;
 }
 
+static int nvme_set_io_depth(struct param_d *p, void *priv)
+{
+	struct nvme_dev *dev = priv;
+	struct nvme_queue *nvmeq = &dev->queues[NVME_QID_IO];
+
+	if (!dev->io_depth || dev->io_depth > nvmeq->q_depth - 1)
+		return -EINVAL;
+
+	nvmeq->max_inflight = dev->io_depth;
+
+	return 0;
+}
+
 static void nvme_reset_work(struct nvme_dev *dev)
 {
 	int result = -ENODEV;
@@ -580,6 +855,13 @@ static void nvme_reset_work(struct nvme_dev *dev)
 		goto out;
 	}
 
+	if (dev->online_queues > NVME_QID_IO) {
+		dev->io_depth = dev->queues[NVME_QID_IO].max_inflight;
+		dev_add_param_uint32(dev->dev, "io_queue_depth",
+				     nvme_set_io_depth, NULL, &dev->io_depth,
+				     "%u", dev);
+	}
+
 	nvme_start_ctrl(&dev->ctrl);
 out:
 	return;
@@ -608,6 +890,9 @@ static const struct nvme_ctrl_ops nvme_pci_ctrl_ops = {
 	.reg_write32		= nvme_pci_reg_write32,
 	.reg_read64		= nvme_pci_reg_read64,
 	.submit_sync_cmd	= nvme_pci_submit_sync_cmd,
+	.submit_async_cmd	= nvme_pci_submit_async_cmd,
+	.reap_async_cmds	= nvme_pci_reap_async_cmds,
+	.queue_depth		= nvme_pci_queue_depth,
 };
 
 static void nvme_dev_map(struct nvme_dev *dev)
@@ -21,6 +21,7 @@
 #include <linux/clk.h>
 #include <linux/ctype.h>
 #include <linux/err.h>
+#include <linux/log2.h>
 
 static struct device_node *root_node;
 
@@ -329,6 +330,87 @@ struct device_node *of_find_node_by_alias(struct device_node *root, const char *
 }
 EXPORT_SYMBOL_GPL(of_find_node_by_alias);
 
+/*
+ * Phandles are resolved through a per tree hash table with linear probing.
+ * It is built on the first lookup in a tree, so trees which are only
+ * unflattened to be inspected or copied don't pay for it. New phandles
+ * are added to it, all other changes to the phandles of a tree drop it
+ * to be rebuilt on the next lookup.
+ */
+struct of_phandle_cache {
+	struct device_node **nodes;
+	unsigned int mask;
+	unsigned int num;
+	phandle max;
+};
+
+static void of_phandle_cache_insert(struct of_phandle_cache *cache,
+				    struct device_node *node)
+{
+	unsigned int i = node->phandle & cache->mask;
+
+	while (cache->nodes[i])
+		i = (i + 1) & cache->mask;
+
+	cache->nodes[i] = node;
+	cache->num++;
+	cache->max = max(cache->max, node->phandle);
+}
+
+static void of_phandle_cache_free(struct device_node *root)
+{
+	struct of_phandle_cache *cache = root->phandle_cache;
+
+	if (!cache)
+		return;
+
+	free(cache->nodes);
+	free(cache);
+	root->phandle_cache = NULL;
+}
+
+static struct of_phandle_cache *of_phandle_cache_get(struct device_node *root)
+{
+	struct of_phandle_cache *cache = root->phandle_cache;
+	struct device_node *node;
+	unsigned int num = 0, size;
+
+	if (cache)
+		return cache;
+
+	of_tree_for_each_node_from(node, root)
+		if (node->phandle)
+			num++;
+
+	/* keep the table at most half full */
+	size = roundup_pow_of_two(max(num * 2, 64U));
+
+	cache = xzalloc(sizeof(*cache));
+	cache->nodes = xzalloc(size * sizeof(*cache->nodes));
+	cache->mask = size - 1;
+
+	of_tree_for_each_node_from(node, root)
+		if (node->phandle)
+			of_phandle_cache_insert(cache, node);
+
+	root->phandle_cache = cache;
+
+	return cache;
+}
+
+/*
+ * of_phandle_cache_invalidate - drop the phandle cache of a tree
+ * @node:    any node of the tree
+ *
+ * Must be called after changing the phandle of a node, adding nodes with
+ * a phandle or moving them to another tree.
+ */
+void of_phandle_cache_invalidate(struct device_node *node)
+{
+	of_phandle_cache_free(of_find_root_node(node));
+}
+EXPORT_SYMBOL(of_phandle_cache_invalidate);
+
 /*
  * of_find_node_by_phandle_from - Find a node given a phandle from given
  * root node.
@@ -339,9 +421,26 @@ EXPORT_SYMBOL_GPL(of_find_node_by_alias);
 struct device_node *of_find_node_by_phandle_from(phandle phandle,
 		struct device_node *root)
 {
+	struct of_phandle_cache *cache;
 	struct device_node *node;
+	unsigned int i;
 
-	of_tree_for_each_node_from(node, root)
+	if (!root)
+		root = root_node;
+
+	/* searches starting at a subnode are rare, walk the tree for them */
+	if (!root || root->parent || !phandle) {
+		of_tree_for_each_node_from(node, root)
+			if (node->phandle == phandle)
+				return node;
+
+		return NULL;
+	}
+
+	cache = of_phandle_cache_get(root);
+
+	for (i = phandle & cache->mask; (node = cache->nodes[i]);
+	     i = (i + 1) & cache->mask)
 		if (node->phandle == phandle)
 			return node;
 
@@ -369,6 +468,12 @@ phandle of_get_tree_max_phandle(struct device_node *root)
 	struct device_node *n;
 	phandle max = 0;
 
+	if (!root)
+		root = root_node;
+
+	if (root && !root->parent)
+		return of_phandle_cache_get(root)->max;
+
 	of_tree_for_each_node_from(n, root) {
 		if (n->phandle > max)
 			max = n->phandle;
@@ -387,6 +492,7 @@ EXPORT_SYMBOL(of_get_tree_max_phandle);
  */
 phandle of_node_create_phandle(struct device_node *node)
 {
+	struct of_phandle_cache *cache;
 	phandle p;
 	struct device_node *root;
 
@@ -399,6 +505,12 @@ phandle of_node_create_phandle(struct device_node *node)
 
 	node->phandle = p;
 
+	cache = root->phandle_cache;
+	if (cache && (cache->num + 1) * 2 <= cache->mask + 1)
+		of_phandle_cache_insert(cache, node);
+	else
+		of_phandle_cache_free(root);
+
 	p = cpu_to_be32(p);
 
 	of_set_property(node, "phandle", &p, sizeof(p), 1);
@@ -833,7 +945,7 @@ int of_property_count_elems_of_size(const struct device_node *np,
 
 	if (!prop)
 		return -EINVAL;
-	if (!prop->value)
+	if (!of_property_get_value(prop))
 		return -ENODATA;
 
 	if (prop->length % elem_size != 0) {
@@ -1992,9 +2104,9 @@ int of_property_read_string_helper(const struct device_node *np,
 
 	if (!prop)
 		return -EINVAL;
-	if (!prop->value)
+	p = of_property_get_value(prop);
+	if (!p)
 		return -ENODATA;
-	p = prop->value;
 	end = p + prop->length;
 
 	for (i = 0; p < end && (!out_strs || i < skip + sz); i++, p += l) {
@@ -2197,11 +2309,13 @@ int of_diff(struct device_node *a, struct device_node *b, int indent)
 	return diff;
 }
 
-struct device_node *of_new_node(struct device_node *parent, const char *name)
+/**
+ * __of_link_node - add an allocated node to a tree
+ * @node:	the new node, with its names set up by the caller
+ * @parent:	the parent node or NULL for a new root node
+ */
+void __of_link_node(struct device_node *node, struct device_node *parent)
 {
-	struct device_node *node;
-
-	node = xzalloc(sizeof(*node));
 	node->parent = parent;
 	if (parent)
 		list_add_tail(&node->parent_list, &parent->children);
@@ -2209,17 +2323,28 @@ struct device_node *of_new_node(struct device_node *parent, const char *name)
 	INIT_LIST_HEAD(&node->children);
 	INIT_LIST_HEAD(&node->properties);
 
+	if (parent)
+		list_add(&node->list, &parent->list);
+	else
+		INIT_LIST_HEAD(&node->list);
+}
+
+struct device_node *of_new_node(struct device_node *parent, const char *name)
+{
+	struct device_node *node;
+
+	node = xzalloc(sizeof(*node));
+
 	if (parent) {
 		node->name = xstrdup(name);
-		node->full_name = basprintf("%s/%s",
-					      node->parent->full_name, name);
-		list_add(&node->list, &parent->list);
+		node->full_name = basprintf("%s/%s", parent->full_name, name);
 	} else {
 		node->name = xstrdup("");
 		node->full_name = xstrdup("");
-		INIT_LIST_HEAD(&node->list);
 	}
 
+	__of_link_node(node, parent);
+
 	return node;
 }
 
@@ -2298,9 +2423,11 @@ void of_delete_property(struct property *pp)
 
 	list_del(&pp->list);
 
-	free(pp->name);
+	if (!(pp->flags & OF_PROPERTY_CONST_NAME))
+		free(pp->name);
 	free(pp->value);
-	free(pp);
+	if (!(pp->flags & OF_PROPERTY_ARENA))
+		free(pp);
 }
 
 struct property *of_rename_property(struct device_node *np,
@@ -2314,8 +2441,10 @@ struct property *of_rename_property(struct device_node *np,
 
 	of_property_write_bool(np, new_name, false);
 
-	free(pp->name);
+	if (!(pp->flags & OF_PROPERTY_CONST_NAME))
+		free(pp->name);
 	pp->name = xstrdup(new_name);
+	pp->flags &= ~OF_PROPERTY_CONST_NAME;
 	return pp;
 }
 
@@ -2642,7 +2771,8 @@ void of_merge_nodes(struct device_node *np, const struct device_node *other)
 	struct property *pp;
 
 	list_for_each_entry(pp, &other->properties, list)
-		of_new_property(np, pp->name, pp->value, pp->length);
+		of_new_property(np, pp->name, of_property_get_value(pp),
+				pp->length);
 
 	for_each_child_of_node(other, child)
 		of_copy_node(np, child);
@@ -2654,6 +2784,8 @@ struct device_node *of_copy_node(struct device_node *parent, const struct device
 
 	np = of_new_node(parent, other->name);
 	np->phandle = other->phandle;
+	if (np->phandle)
+		of_phandle_cache_invalidate(np);
 
 	of_merge_nodes(np, other);
 
@@ -2668,33 +2800,55 @@ struct device_node *of_dup(const struct device_node *root)
 	return of_copy_node(NULL, root);
 }
 
-void of_delete_node(struct device_node *node)
+/* returns true if any of the deleted nodes had a phandle */
+static bool __of_delete_node(struct device_node *node)
 {
 	struct device_node *n, *nt;
 	struct property *p, *pt;
-
-	if (!node)
-		return;
-
-	if (node == root_node) {
-		pr_err("Won't delete root device node\n");
-		return;
-	}
+	bool had_phandle = node->phandle;
 
 	list_for_each_entry_safe(p, pt, &node->properties, list)
 		of_delete_property(p);
 
 	list_for_each_entry_safe(n, nt, &node->children, parent_list)
-		of_delete_node(n);
+		had_phandle |= __of_delete_node(n);
 
 	if (node->parent) {
 		list_del(&node->parent_list);
 		list_del(&node->list);
 	}
 
-	free(node->name);
-	free(node->full_name);
-	free(node);
+	if (node->flags & OF_NODE_ARENA) {
+		/* the arena goes away with the root node */
+		if (!node->parent)
+			of_arena_free(node);
+	} else {
+		free(node->name);
+		free(node->full_name);
+		free(node);
+	}
+
+	return had_phandle;
+}
+
+void of_delete_node(struct device_node *node)
+{
+	struct device_node *root;
+
+	if (!node)
+		return;
+
+	if (node == root_node) {
+		pr_err("Won't delete root device node\n");
+		return;
+	}
+
+	root = of_find_root_node(node);
+	if (root == node)
+		of_phandle_cache_free(root);
+
+	if (__of_delete_node(node) && root != node)
+		of_phandle_cache_free(root);
 }
 
 /*
@@ -2922,6 +3076,10 @@ struct device_node *of_read_file(const char *filename)
 		goto out;
 	}
 
+	/*
+	 * Not unflattened in place: callers install the tree as live tree or
+	 * move parts of it into other trees, which both outlive the arena.
+	 */
 	root = of_unflatten_dtb(fdt, size);
 out:
 	free(fdt);
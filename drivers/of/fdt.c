@@ -88,6 +88,110 @@ static int of_unflatten_reservemap(struct device_node *root,
 	return 0;
 }
 
+/*
+ * Trees unflattened without copying the blob allocate their nodes and
+ * properties from an arena of a few large chunks, with names and values
+ * pointing into the blob. The arena is freed as a whole together with the
+ * root node, which is embedded in it. Nodes and properties deleted before
+ * are only unlinked. Properties which are written to get a copy of their
+ * value as usual, see of_property_get_value().
+ */
+struct of_arena_chunk {
+	struct of_arena_chunk *next;
+	size_t size;
+	size_t used;
+	char data[];
+};
+
+struct of_arena {
+	const void *blob;	/* the blob unflattened in place */
+	void *fdt;		/* freed together with the tree, may be NULL */
+	struct of_arena_chunk *chunks;
+	size_t chunk_size;
+	struct device_node root;
+};
+
+static void *of_arena_alloc(struct of_arena *arena, size_t size)
+{
+	struct of_arena_chunk *chunk = arena->chunks;
+	void *p;
+
+	size = ALIGN(size, sizeof(long));
+
+	if (!chunk || chunk->used + size > chunk->size) {
+		size_t chunk_size = max(arena->chunk_size, size);
+
+		chunk = xzalloc(sizeof(*chunk) + chunk_size);
+		chunk->size = chunk_size;
+		chunk->next = arena->chunks;
+		arena->chunks = chunk;
+	}
+
+	p = chunk->data + chunk->used;
+	chunk->used += size;
+
+	return p;
+}
+
+static struct device_node *of_arena_new_node(struct of_arena *arena,
+					     struct device_node *parent,
+					     const char *name)
+{
+	struct device_node *node;
+	size_t len;
+
+	node = of_arena_alloc(arena, sizeof(*node));
+	node->flags = OF_NODE_ARENA;
+	node->name = (char *)name;
+
+	len = strlen(parent->full_name) + strlen(name) + 2;
+	node->full_name = of_arena_alloc(arena, len);
+	snprintf(node->full_name, len, "%s/%s", parent->full_name, name);
+
+	__of_link_node(node, parent);
+
+	return node;
+}
+
+static struct property *of_arena_new_property(struct of_arena *arena,
+					      struct device_node *node,
+					      const char *name,
+					      const void *data, int len)
+{
+	struct property *prop;
+
+	prop = of_arena_alloc(arena, sizeof(*prop));
+	prop->flags = OF_PROPERTY_ARENA | OF_PROPERTY_CONST_NAME;
+	prop->name = (char *)name;
+	prop->length = len;
+	prop->value_const = data;
+
+	list_add_tail(&prop->list, &node->properties);
+
+	return prop;
+}
+
+/**
+ * of_arena_free - free the arena of a tree unflattened in place
+ * @root - the root node of the tree
+ *
+ * Called from of_delete_node() for the root node, after all other nodes
+ * are unlinked.
+ */
+void of_arena_free(struct device_node *root)
+{
+	struct of_arena *arena = container_of(root, struct of_arena, root);
+	struct of_arena_chunk *chunk, *next;
+
+	for (chunk = arena->chunks; chunk; chunk = next) {
+		next = chunk->next;
+		free(chunk);
+	}
+
+	free(arena->fdt);
+	free(arena);
+}
+
 /**
  * of_unflatten_dtb - unflatten a dtb binary blob
  * @infdt - the fdt blob to unflatten
@@ -98,6 +202,7 @@ static int of_unflatten_reservemap(struct device_node *root,
 static struct device_node *__of_unflatten_dtb(const void *infdt, int size,
 					      bool constprops)
 {
+	struct of_arena *arena = NULL;
 	const void *nodep;	/* property node pointer */
 	uint32_t tag;		/* tag */
 	int  len;		/* length of the property */
@@ -148,9 +253,20 @@ static struct device_node *__of_unflatten_dtb(const void *infdt, int size,
 	dt_struct = f.off_dt_struct;
 	dt_strings = (void *)fdt + f.off_dt_strings;
 
-	root = of_new_node(NULL, NULL);
-	if (!root)
-		return ERR_PTR(-ENOMEM);
+	if (constprops) {
+		arena = xzalloc(sizeof(*arena));
+		arena->blob = infdt;
+		/* the struct block is a rough measure for the size of the tree */
+		arena->chunk_size = max_t(size_t, f.size_dt_struct, SZ_64K);
+		root = &arena->root;
+		root->flags = OF_NODE_ARENA;
+		root->name = root->full_name = "";
+		__of_link_node(root, NULL);
+	} else {
+		root = of_new_node(NULL, NULL);
+		if (!root)
+			return ERR_PTR(-ENOMEM);
+	}
 
 	ret = of_unflatten_reservemap(root, fdt);
 	if (ret)
@@ -185,9 +301,15 @@ static struct device_node *__of_unflatten_dtb(const void *infdt, int size,
 					ret = -EINVAL;
 					goto err;
 				}
-				node = of_new_node(node, pathp);
+				if (arena)
+					node = of_arena_new_node(arena, node, pathp);
+				else
+					node = of_new_node(node, pathp);
 			}
 
+			if (arena)
+				node->fdt_offset = dt_struct - f.off_dt_struct;
+
 			dt_struct = dt_struct_advance(&f, dt_struct,
 					sizeof(struct fdt_node_header) + len + 1);
 
@@ -217,8 +339,9 @@ static struct device_node *__of_unflatten_dtb(const void *infdt, int size,
 				goto err;
 			}
 
-			if (constprops)
-				p = of_new_property_const(node, name, nodep, len);
+			if (arena)
+				p = of_arena_new_property(arena, node, name,
+							  nodep, len);
 			else
 				p = of_new_property(node, name, nodep, len);
 
@@ -273,23 +396,67 @@ struct device_node *of_unflatten_dtb(const void *infdt, int size)
  *
  * Parse a flat device tree binary blob and return a pointer to the unflattened
  * tree. The tree must be freed after use with of_delete_node(). Unlike the
- * above version this function uses the property data directly from the input
- * flattened tree instead of copying the data, thus @infdt must be valid for the
- * whole lifetime of the returned tree. This is normally not what you want, so
- * use of_unflatten_dtb() instead.
+ * above version this function uses the names and property data directly from
+ * the input flattened tree instead of copying them and allocates the nodes
+ * from a single arena, thus @infdt must be valid for the whole lifetime of the
+ * returned tree. Use of_unflatten_dtb_owned() if @infdt can be handed over to
+ * the tree, otherwise this is normally not what you want, so use
+ * of_unflatten_dtb() instead.
  */
 struct device_node *of_unflatten_dtb_const(const void *infdt, int size)
 {
 	return __of_unflatten_dtb(infdt, size, true);
 }
 
+/**
+ * of_unflatten_dtb_owned - unflatten a dtb binary blob in place
+ * @infdt - the malloced fdt blob to unflatten
+ *
+ * Like of_unflatten_dtb_const(), but on success the returned tree takes over
+ * @infdt, which is freed together with the tree. On failure, @infdt is left
+ * to the caller.
+ */
+struct device_node *of_unflatten_dtb_owned(void *infdt, int size)
+{
+	struct device_node *root;
+
+	root = __of_unflatten_dtb(infdt, size, true);
+	if (!IS_ERR(root))
+		container_of(root, struct of_arena, root)->fdt = infdt;
+
+	return root;
+}
+
+/*
+ * The device tree is flattened in two passes. The first one determines the
+ * exact size of the structure block and collects the strings, so that the
+ * second one can write the result to a single allocation. Property names
+ * are stored only once in the strings block.
+ *
+ * Trees unflattened in place still have their source blob. Subtrees which
+ * are exactly as they were unflattened are copied from there verbatim. For
+ * this the strings block of the source blob is used as the start of the new
+ * strings block, so that the name offsets in the copied properties stay
+ * valid.
+ */
 struct fdt {
 	void *dt;
 	uint32_t dt_nextofs;
-	uint32_t dt_size;
+
 	char *strings;
 	uint32_t str_nextofs;
 	uint32_t str_size;
+
+	/* offsets + 1 of the strings, 0 for empty slots */
+	uint32_t *str_hash;
+	uint32_t str_hash_mask;
+	uint32_t str_count;
+
+	/* the blob the tree was unflattened in place from, if any */
+	const void *src_struct;
+	uint32_t src_struct_size;
+	const char *src_strings;
+	uint32_t src_strings_size;
 };
 
 static inline uint32_t dt_next_ofs(uint32_t curofs, uint32_t len)
@@ -297,122 +464,238 @@ static inline uint32_t dt_next_ofs(uint32_t curofs, uint32_t len)
 	return ALIGN(curofs + len, 4);
 }
 
-static int lstrcpy(char *dest, const char *src)
+static uint32_t *dt_string_slot(struct fdt *fdt, const char *str)
 {
-	int len = 0;
-	int maxlen = 1023;
-
-	while (*src) {
-		*dest++ = *src++;
-		len++;
-		if (!maxlen)
-			return -ENOSPC;
-		maxlen--;
+	uint32_t hash = 0, *slot;
+	const char *s;
+
+	for (s = str; *s; s++)
+		hash = hash * 31 + *s;
+
+	while (*(slot = &fdt->str_hash[hash & fdt->str_hash_mask])) {
+		if (!strcmp(fdt->strings + *slot - 1, str))
+			break;
+		hash++;
 	}
 
-	return len;
+	return slot;
 }
 
-static void *memalign_realloc(void *orig, size_t oldsize, size_t newsize)
+static void dt_string_hash_resize(struct fdt *fdt, uint32_t size)
 {
-	int align;
-	void *newbuf;
+	uint32_t *old = fdt->str_hash;
+	uint32_t i, oldsize = old ? fdt->str_hash_mask + 1 : 0;
 
-	/*
-	 * ARM Linux uses a single 1MiB section (with 1MiB alignment)
-	 * for mapping the devicetree, so we are not allowed to cross
-	 * 1MiB boundaries. This got fixed in the Kernel since v3.8-rc5
-	 */
-	align = 1 << fls(newsize - 1);
+	fdt->str_hash = xzalloc(size * sizeof(*fdt->str_hash));
+	fdt->str_hash_mask = size - 1;
 
-	if (!orig)
-		return memalign(align, newsize);
+	for (i = 0; i < oldsize; i++)
+		if (old[i])
+			*dt_string_slot(fdt, fdt->strings + old[i] - 1) = old[i];
 
-	newbuf = memalign(align, newsize);
-	if (!newbuf) {
-		free(orig);
-		return NULL;
+	free(old);
+}
+
+static void dt_string_hash_insert(struct fdt *fdt, uint32_t *slot, uint32_t ofs)
+{
+	*slot = ofs + 1;
+
+	if (++fdt->str_count * 2 > fdt->str_hash_mask + 1)
+		dt_string_hash_resize(fdt, (fdt->str_hash_mask + 1) * 2);
+}
+
+/* returns the offset of @str in the strings block, adding it if necessary */
+static uint32_t dt_add_string(struct fdt *fdt, const char *str)
+{
+	uint32_t *slot = dt_string_slot(fdt, str);
+	uint32_t ofs;
+	int len;
+
+	if (*slot)
+		return *slot - 1;
+
+	len = strlen(str) + 1;
+
+	if (fdt->str_nextofs + len > fdt->str_size) {
+		fdt->str_size = max(fdt->str_size * 2, fdt->str_nextofs + len);
+		fdt->strings = xrealloc(fdt->strings, fdt->str_size);
 	}
 
-	memcpy(newbuf, orig, oldsize);
-	free(orig);
-	memset(newbuf + oldsize, 0, newsize - oldsize);
+	ofs = fdt->str_nextofs;
+	memcpy(fdt->strings + ofs, str, len);
+	fdt->str_nextofs += len;
+
+	dt_string_hash_insert(fdt, slot, ofs);
 
-	return newbuf;
+	return ofs;
 }
 
-static int fdt_ensure_space(struct fdt *fdt, int dtsize)
+static uint32_t dt_property_nameoff(struct fdt *fdt, struct property *p)
 {
-	/*
-	 * We assume strings and names have a maximum length of 1024
-	 * whereas properties can be longer. We allocate new memory
-	 * if we have less than 1024 bytes (+ the property size left.
-	 */
-	if (fdt->str_size - fdt->str_nextofs < 1024) {
-		fdt->strings = realloc(fdt->strings, fdt->str_size * 2);
-		if (!fdt->strings)
-			return -ENOMEM;
-		fdt->str_size *= 2;
+	if ((p->flags & OF_PROPERTY_CONST_NAME) && fdt->src_strings &&
+	    p->name >= fdt->src_strings &&
+	    p->name < fdt->src_strings + fdt->src_strings_size)
+		return p->name - fdt->src_strings;
+
+	return dt_add_string(fdt, p->name);
+}
+
+/* start the strings block with the one of the source blob */
+static void dt_add_src_strings(struct fdt *fdt)
+{
+	uint32_t ofs, len, *slot;
+
+	memcpy(fdt->strings, fdt->src_strings, fdt->src_strings_size);
+	fdt->str_nextofs = fdt->src_strings_size;
+
+	for (ofs = 0; ofs < fdt->src_strings_size; ofs += len + 1) {
+		len = strnlen(fdt->strings + ofs, fdt->src_strings_size - ofs);
+		if (ofs + len == fdt->src_strings_size)
+			break;
+
+		slot = dt_string_slot(fdt, fdt->strings + ofs);
+		if (!*slot)
+			dt_string_hash_insert(fdt, slot, ofs);
 	}
+}
+
+static uint32_t dt_src_tag(struct fdt *fdt, uint32_t *ofs)
+{
+	uint32_t tag;
+
+	while (*ofs + FDT_TAGSIZE <= fdt->src_struct_size) {
+		tag = be32_to_cpup(fdt->src_struct + *ofs);
+		if (tag != FDT_NOP)
+			return tag;
 
-	if (fdt->dt_size - fdt->dt_nextofs < 1024 + dtsize) {
-		fdt->dt = memalign_realloc(fdt->dt, fdt->dt_size,
-				fdt->dt_size * 2);
-		if (!fdt->dt)
-			return -ENOMEM;
-		fdt->dt_size *= 2;
+		*ofs += FDT_TAGSIZE;
 	}
 
-	return 0;
+	return FDT_END;
 }
 
-static inline int dt_add_string(struct fdt *fdt, const char *str)
+/*
+ * Check whether the properties of @node are still exactly those it was
+ * unflattened from. Returns the offset after them in the source blob or 0.
+ */
+static uint32_t dt_src_props_unchanged(struct fdt *fdt, struct device_node *node)
 {
-	uint32_t ret;
-	int len;
+	const struct fdt_property *fp;
+	struct property *p;
+	const struct fdt_node_header *nh = fdt->src_struct + node->fdt_offset;
+	uint32_t ofs;
 
-	if (fdt_ensure_space(fdt, 0) < 0)
-		return -ENOMEM;
+	/* the node has been renamed, the root node cannot be */
+	if (node->parent && node->name != nh->name)
+		return 0;
 
-	len = lstrcpy(fdt->strings + fdt->str_nextofs, str);
-	if (len < 0)
-		return -ENOSPC;
+	ofs = dt_next_ofs(node->fdt_offset,
+			  sizeof(struct fdt_node_header) + strlen(node->name) + 1);
+
+	list_for_each_entry(p, &node->properties, list) {
+		if (dt_src_tag(fdt, &ofs) != FDT_PROP)
+			return 0;
 
-	ret = fdt->str_nextofs;
+		fp = fdt->src_struct + ofs;
 
-	fdt->str_nextofs += len + 1;
+		if (!(p->flags & OF_PROPERTY_CONST_NAME) ||
+		    p->value || p->value_const != fp->data)
+			return 0;
 
-	return ret;
+		ofs = dt_next_ofs(ofs, sizeof(*fp) + p->length);
+	}
+
+	/* a property has been deleted */
+	if (dt_src_tag(fdt, &ofs) == FDT_PROP)
+		return 0;
+
+	return ofs;
 }
 
-static int __of_flatten_dtb(struct fdt *fdt, struct device_node *node, int is_root)
+/*
+ * First pass: returns the size of the structure block for @node and adds
+ * the names of its properties to the strings block. Nodes whose subtree is
+ * unchanged are marked with OF_NODE_FDT_UNCHANGED and their size in the
+ * source blob is stored in ->fdt_size.
+ */
+static uint32_t __of_flatten_dtb_size(struct fdt *fdt, struct device_node *node,
+				      int is_root)
+{
+	struct property *p;
+	struct device_node *n;
+	uint32_t size, src_ofs = 0;
+
+	node->flags &= ~OF_NODE_FDT_UNCHANGED;
+
+	if (fdt->src_struct && (node->flags & OF_NODE_ARENA))
+		src_ofs = dt_src_props_unchanged(fdt, node);
+
+	size = dt_next_ofs(0, sizeof(struct fdt_node_header) +
+			   strlen(node->name) + 1);
+
+	list_for_each_entry(p, &node->properties, list) {
+		size = dt_next_ofs(size, sizeof(struct fdt_property) + p->length);
+		dt_property_nameoff(fdt, p);
+	}
+
+	list_for_each_entry(n, &node->children, parent_list) {
+		if (is_root && !strcmp(n->name, "memreserve")) {
+			src_ofs = 0;
+			continue;
+		}
+
+		size += __of_flatten_dtb_size(fdt, n, 0);
+
+		if (!src_ofs)
+			continue;
+
+		if ((n->flags & OF_NODE_FDT_UNCHANGED) &&
+		    dt_src_tag(fdt, &src_ofs) == FDT_BEGIN_NODE &&
+		    n->fdt_offset == src_ofs)
+			src_ofs += n->fdt_size;
+		else
+			src_ofs = 0;
+	}
+
+	size += FDT_TAGSIZE;
+
+	/* no child node has been deleted either */
+	if (src_ofs && dt_src_tag(fdt, &src_ofs) == FDT_END_NODE) {
+		node->flags |= OF_NODE_FDT_UNCHANGED;
+		node->fdt_size = src_ofs + FDT_TAGSIZE - node->fdt_offset;
+		return node->fdt_size;
+	}
+
+	return size;
+}
+
+/* Second pass: write the structure block for @node */
+static void __of_flatten_dtb(struct fdt *fdt, struct device_node *node, int is_root)
 {
 	struct property *p;
 	struct device_node *n;
-	int ret;
-	unsigned int len;
 	struct fdt_node_header *nh;
 
-	if (fdt_ensure_space(fdt, 0) < 0)
-		return -ENOMEM;
+	if (node->flags & OF_NODE_FDT_UNCHANGED) {
+		memcpy(fdt->dt + fdt->dt_nextofs,
+		       fdt->src_struct + node->fdt_offset, node->fdt_size);
+		fdt->dt_nextofs += node->fdt_size;
+		return;
+	}
 
 	nh = fdt->dt + fdt->dt_nextofs;
 	nh->tag = cpu_to_fdt32(FDT_BEGIN_NODE);
-	len = lstrcpy(nh->name, node->name);
-	fdt->dt_nextofs = dt_next_ofs(fdt->dt_nextofs, 4 + len + 1);
+	strcpy(nh->name, node->name);
+	fdt->dt_nextofs = dt_next_ofs(fdt->dt_nextofs,
+			sizeof(*nh) + strlen(node->name) + 1);
 
 	list_for_each_entry(p, &node->properties, list) {
-		struct fdt_property *fp;
-
-		if (fdt_ensure_space(fdt, p->length) < 0)
-			return -ENOMEM;
-
-		fp = fdt->dt + fdt->dt_nextofs;
+		struct fdt_property *fp = fdt->dt + fdt->dt_nextofs;
 
 		fp->tag = cpu_to_fdt32(FDT_PROP);
 		fp->len = cpu_to_fdt32(p->length);
-		fp->nameoff = cpu_to_fdt32(dt_add_string(fdt, p->name));
-		memcpy(fp->data, p->value, p->length);
+		fp->nameoff = cpu_to_fdt32(dt_property_nameoff(fdt, p));
+		memcpy(fp->data, of_property_get_value(p), p->length);
 		fdt->dt_nextofs = dt_next_ofs(fdt->dt_nextofs,
 				sizeof(struct fdt_property) + p->length);
 	}
@@ -421,20 +704,12 @@ static int __of_flatten_dtb(struct fdt *fdt, struct device_node *node, int is_ro
 		if (is_root && !strcmp(n->name, "memreserve"))
 			continue;
 
-		ret = __of_flatten_dtb(fdt, n, 0);
-		if (ret)
-			return ret;
+		__of_flatten_dtb(fdt, n, 0);
 	}
 
 	nh = fdt->dt + fdt->dt_nextofs;
 	nh->tag = cpu_to_fdt32(FDT_END_NODE);
-	fdt->dt_nextofs = dt_next_ofs(fdt->dt_nextofs,
-			sizeof(struct fdt_node_header));
-
-	if (fdt_ensure_space(fdt, 0) < 0)
-		return -ENOMEM;
-
-	return 0;
+	fdt->dt_nextofs += FDT_TAGSIZE;
 }
 
 /**
@@ -443,10 +718,9 @@ static int __of_flatten_dtb(struct fdt *fdt, struct device_node *node, int is_ro
  */
 void *of_flatten_dtb(struct device_node *node)
 {
-	int ret;
 	struct fdt_header header = {};
 	struct fdt fdt = {};
-	uint32_t ofs, off_mem_rsvmap;
+	uint32_t ofs, off_mem_rsvmap, size_struct, totalsize;
 	struct fdt_node_header *nh;
 	struct device_node *memreserve;
 	int len;
@@ -455,13 +729,24 @@ void *of_flatten_dtb(struct device_node *node)
 	header.version = cpu_to_fdt32(0x11);
 	header.last_comp_version = cpu_to_fdt32(0x10);
 
-	fdt.dt = xmemalign(SZ_64K, SZ_64K);
-	fdt.dt_size = SZ_64K;
+	if (!node->parent && (node->flags & OF_NODE_ARENA)) {
+		const struct fdt_header *src;
+
+		src = container_of(node, struct of_arena, root)->blob;
+		fdt.src_struct = (void *)src + fdt32_to_cpu(src->off_dt_struct);
+		fdt.src_struct_size = fdt32_to_cpu(src->size_dt_struct);
+		fdt.src_strings = (void *)src + fdt32_to_cpu(src->off_dt_strings);
+		fdt.src_strings_size = fdt32_to_cpu(src->size_dt_strings);
+	}
+
+	fdt.str_size = max_t(uint32_t, fdt.src_strings_size, SZ_4K);
+	fdt.strings = xmalloc(fdt.str_size);
+	dt_string_hash_resize(&fdt, 256);
 
-	fdt.strings = xzalloc(SZ_64K);
-	fdt.str_size = SZ_64K;
+	if (fdt.src_strings)
+		dt_add_src_strings(&fdt);
 
-	memset(fdt.dt, 0, SZ_64K);
+	size_struct = __of_flatten_dtb_size(&fdt, node, 1);
 
 	ofs = sizeof(struct fdt_header);
 
@@ -469,11 +754,28 @@ void *of_flatten_dtb(struct device_node *node)
 	header.off_mem_rsvmap = cpu_to_fdt32(off_mem_rsvmap);
 	ofs += sizeof(struct fdt_reserve_entry) * OF_MAX_RESERVE_MAP;
 
+	totalsize = ofs + size_struct + FDT_TAGSIZE + fdt.str_nextofs;
+
+	/*
+	 * ARM Linux uses a single 1MiB section (with 1MiB alignment)
+	 * for mapping the devicetree, so we are not allowed to cross
+	 * 1MiB boundaries. This got fixed in the Kernel since v3.8-rc5
+	 */
+	fdt.dt = memalign(1 << fls(totalsize - 1), totalsize);
+	if (!fdt.dt)
+		goto out_free;
+
+	memset(fdt.dt, 0, totalsize);
+
 	fdt.dt_nextofs = ofs;
 
-	ret = __of_flatten_dtb(&fdt, node, 1);
-	if (ret)
+	__of_flatten_dtb(&fdt, node, 1);
+
+	if (WARN_ON(fdt.dt_nextofs != ofs + size_struct)) {
+		free(fdt.dt);
+		fdt.dt = NULL;
 		goto out_free;
+	}
 
 	memreserve = of_find_node_by_name_address(node, "memreserve");
 	if (memreserve) {
@@ -485,7 +787,7 @@ void *of_flatten_dtb(struct device_node *node)
 
 	nh = fdt.dt + fdt.dt_nextofs;
 	nh->tag = cpu_to_fdt32(FDT_END);
-	fdt.dt_nextofs = dt_next_ofs(fdt.dt_nextofs, sizeof(struct fdt_node_header));
+	fdt.dt_nextofs += FDT_TAGSIZE;
 
 	header.off_dt_struct = cpu_to_fdt32(ofs);
 	header.size_dt_struct = cpu_to_fdt32(fdt.dt_nextofs - ofs);
@@ -493,28 +795,17 @@ void *of_flatten_dtb(struct device_node *node)
 	header.off_dt_strings = cpu_to_fdt32(fdt.dt_nextofs);
 	header.size_dt_strings = cpu_to_fdt32(fdt.str_nextofs);
 
-	if (fdt.dt_size - fdt.dt_nextofs < fdt.str_nextofs) {
-		fdt.dt = memalign_realloc(fdt.dt, fdt.dt_size,
-				fdt.dt_nextofs + fdt.str_nextofs);
-		if (!fdt.dt)
-			goto out_free;
-	}
-
 	memcpy(fdt.dt + fdt.dt_nextofs, fdt.strings, fdt.str_nextofs);
 
-	header.totalsize = cpu_to_fdt32(fdt.dt_nextofs + fdt.str_nextofs);
+	header.totalsize = cpu_to_fdt32(totalsize);
 
 	memcpy(fdt.dt, &header, sizeof(header));
 
-	free(fdt.strings);
-
-	return fdt.dt;
-
 out_free:
+	free(fdt.str_hash);
 	free(fdt.strings);
-	free(fdt.dt);
 
-	return NULL;
+	return fdt.dt;
 }
 
 /*
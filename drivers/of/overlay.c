@@ -65,8 +65,10 @@ static int of_overlay_apply(struct device_node *target,
 		if (of_prop_cmp(prop->name, "name") == 0)
 			continue;
 
-		if (of_prop_cmp(prop->name, "phandle") == 0)
+		if (of_prop_cmp(prop->name, "phandle") == 0) {
 			target->phandle = be32_to_cpup(prop->value);
+			of_phandle_cache_invalidate(target);
+		}
 
 		err = of_set_property(target, prop->name, prop->value,
 				      prop->length, true);
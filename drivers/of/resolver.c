@@ -208,6 +208,7 @@ struct device_node *of_resolve_phandles(struct device_node *root,
 	 * with the phandles in the base devicetree.
 	 */
 	adjust_overlay_phandles(result, delta);
+	of_phandle_cache_invalidate(result);
 
 	/*
 	 * __local_fixups__ contains all locations in the overlay that refer
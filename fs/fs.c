@@ -35,6 +35,7 @@
 #include <libfile.h>
 #include <parseopt.h>
 #include <linux/namei.h>
+#include <linux/hash.h>
 
 char *mkmodestr(unsigned long mode, char *str)
 {
@@ -800,6 +801,7 @@ static void dentry_kill(struct dentry *dentry)
 	if (!IS_ROOT(dentry))
 		dput(dentry->d_parent);
 
+	hlist_del_init(&dentry->d_hash);
 	list_del(&dentry->d_child);
 	free(dentry->name);
 	free(dentry);
@@ -1393,6 +1395,35 @@ struct dentry *dget(struct dentry *dentry)
 
 const struct qstr slash_name = QSTR_INIT("/", 1);
 
+/*
+ * All dentries with a parent are kept in a global hash table keyed by
+ * parent and name, so looking up a path component doesn't have to walk
+ * all siblings.
+ */
+#define D_HASH_BITS	10
+
+static struct hlist_head dentry_hashtable[1 << D_HASH_BITS];
+
+static u32 d_name_hash(const unsigned char *name, unsigned int len)
+{
+	u32 hash = 0;
+
+	while (len--) {
+		unsigned char c = *name++;
+
+		hash = (hash + (c << 4) + (c >> 4)) * 11;
+	}
+
+	return hash;
+}
+
+static struct hlist_head *d_hash_bucket(const struct dentry *parent, u32 hash)
+{
+	hash ^= hash_ptr(parent, 32);
+
+	return &dentry_hashtable[hash_32(hash, D_HASH_BITS)];
+}
+
 void d_set_d_op(struct dentry *dentry, const struct dentry_operations *op)
 {
 	dentry->d_op = op;
@@ -1431,7 +1462,7 @@ static struct dentry *__d_alloc(struct super_block *sb, const struct qstr *name)
 	memcpy(dentry->name, name->name, name->len);
 	dentry->name[name->len] = 0;
 
-	dentry->d_name.len = name->len;
+	dentry->d_name.hash_len = name->hash_len;
 	dentry->d_name.name = dentry->name;
 
 	dentry->d_count = 1;
@@ -1463,6 +1494,7 @@ static struct dentry *d_alloc(struct dentry *parent, const struct qstr *name)
 
 	dentry->d_parent = parent;
 	list_add(&dentry->d_child, &parent->d_subdirs);
+	hlist_add_head(&dentry->d_hash, d_hash_bucket(parent, name->hash));
 
 	return dentry;
 }
@@ -1530,7 +1562,11 @@ static struct dentry *d_lookup(const struct dentry *parent, const struct qstr *n
 {
 	struct dentry *dentry;
 
-	list_for_each_entry(dentry, &parent->d_subdirs, d_child) {
+	hlist_for_each_entry(dentry, d_hash_bucket(parent, name->hash), d_hash) {
+		if (dentry->d_name.hash != name->hash)
+			continue;
+		if (dentry->d_parent != parent)
+			continue;
 		if (!d_same_name(dentry, parent, name))
 			continue;
 
@@ -2128,6 +2164,7 @@ static int link_path_walk(const char *name, struct nameidata *nd)
 			nd->flags &= ~LOOKUP_JUMPED;
 
 		nd->last.len = len;
+		nd->last.hash = d_name_hash(name, len);
 		nd->last.name = name;
 		nd->last_type = type;
 
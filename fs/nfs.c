@@ -54,6 +54,7 @@
 #define NFSPROC3_READLINK	5
 #define NFSPROC3_READ		6
 #define NFSPROC3_READDIR	16
+#define NFSPROC3_FSINFO		19
 
 #define NFS3_FHSIZE      64
 #define NFS3_COOKIEVERFSIZE	8
@@ -121,6 +122,21 @@ struct rpc_reply {
 #define NFS_TIMEOUT	(100 * MSECOND)
 #define NFS_MAX_RESEND	100
 
+/*
+ * Without IP reassembly a READ reply carrying more than this does not
+ * fit into a single ethernet frame.
+ */
+#ifdef CONFIG_NET_IP_REASSEMBLY
+#define NFS_MAX_RSIZE		SZ_32K
+#define NFS_DEFAULT_RSIZE	SZ_8K
+#else
+#define NFS_MAX_RSIZE		1024
+#define NFS_DEFAULT_RSIZE	1024
+#endif
+#define NFS_MAX_WINDOW_SIZE	32
+
+static int g_nfs_window_size = 4;
+
 struct nfs_fh {
 	unsigned short size;
 	unsigned char data[NFS3_FHSIZE];
@@ -143,6 +159,7 @@ struct nfs_priv {
 	uint32_t rpc_id;
 	struct nfs_fh rootfh;
 	struct list_head packets;
+	uint32_t rsize;
 };
 
 struct file_priv {
@@ -150,6 +167,15 @@ struct file_priv {
 	void *buf;
 	struct nfs_priv *npriv;
 	struct nfs_fh fh;
+	unsigned int windowsize;
+};
+
+/* a READ request in flight */
+struct nfs_read_slot {
+	uint32_t rpc_id;
+	uint64_t offset;
+	uint32_t count;
+	struct packet *packet;
 };
 
 struct nfs_inode {
@@ -456,23 +482,29 @@ static void nfs_free_packet(struct packet *packet)
 	free(packet);
 }
 
+static uint32_t rpc_reply_id(struct packet *pkt)
+{
+	struct rpc_reply rpc;
+
+	if (pkt->len < sizeof(rpc))
+		return 0;
+
+	memcpy(&rpc, pkt->data, sizeof(rpc));
+
+	return ntoh32(rpc.id);
+}
+
 /*
- * rpc_req - synchronous RPC request
+ * rpc_send - send a RPC call without waiting for the reply
  */
-static struct packet *rpc_req(struct nfs_priv *npriv, int rpc_prog,
-			      int rpc_proc, uint32_t *data, int datalen)
+static int rpc_send(struct nfs_priv *npriv, int rpc_prog, int rpc_proc,
+		    uint32_t rpc_id, uint32_t *data, int datalen)
 {
 	struct rpc_call pkt;
 	unsigned short dport;
-	int ret;
 	unsigned char *payload = net_udp_get_payload(npriv->con);
-	int nfserr;
-	int tries = 0;
-	struct packet *packet;
-
-	npriv->rpc_id++;
 
-	pkt.id = hton32(npriv->rpc_id);
+	pkt.id = hton32(rpc_id);
 	pkt.type = hton32(MSG_CALL);
 	pkt.rpcvers = hton32(2);	/* use RPC version 2 */
 	pkt.prog = hton32(rpc_prog);
@@ -496,11 +528,27 @@ static struct packet *rpc_req(struct nfs_priv *npriv, int rpc_prog,
 
 	npriv->con->udp->uh_dport = hton16(dport);
 
+	return net_udp_send(npriv->con,
+			sizeof(pkt) + datalen * sizeof(uint32_t));
+}
+
+/*
+ * rpc_req - synchronous RPC request
+ */
+static struct packet *rpc_req(struct nfs_priv *npriv, int rpc_prog,
+			      int rpc_proc, uint32_t *data, int datalen)
+{
+	int ret;
+	int nfserr;
+	int tries = 0;
+	struct packet *packet;
+
+	npriv->rpc_id++;
+
 	nfs_timer_start = get_time_ns();
 
 again:
-	ret = net_udp_send(npriv->con,
-			sizeof(pkt) + datalen * sizeof(uint32_t));
+	ret = rpc_send(npriv, rpc_prog, rpc_proc, npriv->rpc_id, data, datalen);
 	if (ret) {
 		if (is_timeout(nfs_timer_start, NFS_TIMEOUT)) {
 			tries++;
@@ -767,6 +815,57 @@ static int nfs_mount_req(struct nfs_priv *npriv)
 	return 0;
 }
 
+/*
+ * nfs_fsinfo_req - Ask the server for its maximum READ size
+ */
+static int nfs_fsinfo_req(struct nfs_priv *npriv, uint32_t *rtmax)
+{
+	uint32_t data[1024];
+	uint32_t *p, status;
+	int len;
+	struct packet *nfs_packet;
+
+	/*
+	 * struct FSINFO3args {
+	 * 	nfs_fh3 fsroot;
+	 * };
+	 *
+	 * struct FSINFO3resok {
+	 * 	post_op_attr obj_attributes;
+	 * 	uint32 rtmax;
+	 * 	uint32 rtpref;
+	 * 	...
+	 * };
+	 */
+	p = &(data[0]);
+	p = rpc_add_credentials(p);
+
+	p = nfs_add_fh3(p, &npriv->rootfh);
+
+	len = p - &(data[0]);
+
+	nfs_packet = rpc_req(npriv, PROG_NFS, NFSPROC3_FSINFO, data, len);
+	if (IS_ERR(nfs_packet))
+		return PTR_ERR(nfs_packet);
+
+	p = (void *)nfs_packet->data + sizeof(struct rpc_reply);
+	status = ntoh32(net_read_uint32(p++));
+	if (status != NFS3_OK) {
+		int ret;
+		nfserrstr(status, &ret);
+		nfs_free_packet(nfs_packet);
+		return ret;
+	}
+
+	p = nfs_read_post_op_attr(p, NULL);
+
+	*rtmax = ntoh32(net_read_uint32(p));
+
+	nfs_free_packet(nfs_packet);
+
+	return 0;
+}
+
 /*
  * nfs_umountall_req - Unmount all our NFS Filesystems on the Server
  */
@@ -968,17 +1067,10 @@ static void *nfs_readdirattr_req(struct nfs_priv *npriv, struct nfs_dir *dir)
 	return buf;
 }
 
-/*
- * nfs_read_req - Read File on NFS Server
- */
-static int nfs_read_req(struct file_priv *priv, uint64_t offset,
-		uint32_t readlen)
+static int nfs_read_send(struct file_priv *priv, struct nfs_read_slot *slot)
 {
 	uint32_t data[1024];
-	uint32_t *p, status;
-	int len, ret;
-	struct packet *nfs_packet;
-	uint32_t rlen, eof;
+	uint32_t *p;
 
 	/*
 	 * struct READ3args {
@@ -986,7 +1078,32 @@ static int nfs_read_req(struct file_priv *priv, uint64_t offset,
 	 * 	offset3 offset;
 	 * 	count3 count;
 	 * };
-	 *
+	 */
+	p = &(data[0]);
+	p = rpc_add_credentials(p);
+
+	p = nfs_add_fh3(p, &priv->fh);
+	p = nfs_add_uint64(p, slot->offset);
+	p = nfs_add_uint32(p, slot->count);
+
+	return rpc_send(priv->npriv, PROG_NFS, NFSPROC3_READ, slot->rpc_id,
+			data, p - &(data[0]));
+}
+
+/*
+ * nfs_read_reply - Put the data of a READ reply into the fifo
+ *
+ * Returns the number of bytes read or a negative error code.
+ */
+static int nfs_read_reply(struct file_priv *priv, struct nfs_read_slot *slot,
+			  bool *eof)
+{
+	struct packet *nfs_packet = slot->packet;
+	uint32_t *p, status;
+	uint32_t rlen, maxlen;
+	int nfserr, ret;
+
+	/*
 	 * struct READ3resok {
 	 * 	post_op_attr file_attributes;
 	 * 	count3 count;
@@ -1005,18 +1122,9 @@ static int nfs_read_req(struct file_priv *priv, uint64_t offset,
 	 * 	READ3resfail resfail;
 	 * };
 	 */
-	p = &(data[0]);
-	p = rpc_add_credentials(p);
-
-	p = nfs_add_fh3(p, &priv->fh);
-	p = nfs_add_uint64(p, offset);
-	p = nfs_add_uint32(p, readlen);
-
-	len = p - &(data[0]);
-
-	nfs_packet = rpc_req(priv->npriv, PROG_NFS, NFSPROC3_READ, data, len);
-	if (IS_ERR(nfs_packet))
-		return PTR_ERR(nfs_packet);
+	ret = rpc_check_reply(nfs_packet, PROG_NFS, slot->rpc_id, &nfserr);
+	if (ret)
+		return ret;
 
 	p = (void *)nfs_packet->data + sizeof(struct rpc_reply);
 	status = ntoh32(net_read_uint32(p++));
@@ -1032,7 +1140,7 @@ static int nfs_read_req(struct file_priv *priv, uint64_t offset,
 	/* skip over count */
 	p += 1;
 
-	eof = ntoh32(net_read_uint32(p));
+	*eof = ntoh32(net_read_uint32(p));
 
 	/*
 	 * skip over eof and count embedded in the representation of data
@@ -1040,16 +1148,115 @@ static int nfs_read_req(struct file_priv *priv, uint64_t offset,
 	 */
 	p += 2;
 
-	if (readlen && !rlen && !eof) {
-		nfs_free_packet(nfs_packet);
+	if (slot->count && !rlen && !*eof)
 		return -EIO;
-	}
+
+	maxlen = nfs_packet->len - ((void *)p - (void *)nfs_packet->data);
+	rlen = min3(rlen, maxlen, slot->count);
 
 	kfifo_put(priv->fifo, (char *)p, rlen);
 
-	nfs_free_packet(nfs_packet);
+	return rlen;
+}
 
-	return 0;
+static struct nfs_read_slot *nfs_read_find_slot(struct nfs_read_slot *slots,
+						unsigned int nslots,
+						struct packet *packet)
+{
+	uint32_t rpc_id = rpc_reply_id(packet);
+	unsigned int i;
+
+	for (i = 0; i < nslots; i++)
+		if (slots[i].rpc_id == rpc_id)
+			return &slots[i];
+
+	return NULL;
+}
+
+/*
+ * nfs_read_req - Read File on NFS Server
+ *
+ * Sends up to windowsize READ requests for consecutive parts of the
+ * file starting at @offset, collects the replies in whatever order they
+ * arrive and puts their data into the fifo in file order.
+ */
+static int nfs_read_req(struct file_priv *priv, uint64_t offset, uint64_t size)
+{
+	struct nfs_priv *npriv = priv->npriv;
+	struct nfs_read_slot slots[NFS_MAX_WINDOW_SIZE];
+	struct packet *packet, *tmp;
+	unsigned int nslots, done = 0, i;
+	int tries = 0;
+	int ret = 0;
+	bool eof;
+
+	for (nslots = 0; nslots < priv->windowsize; nslots++) {
+		struct nfs_read_slot *slot = &slots[nslots];
+
+		slot->offset = offset + (uint64_t)nslots * npriv->rsize;
+		if (nslots && slot->offset >= size)
+			break;
+
+		slot->rpc_id = ++npriv->rpc_id;
+		slot->count = npriv->rsize;
+		slot->packet = NULL;
+
+		/* a failed send is retried along with lost replies */
+		nfs_read_send(priv, slot);
+	}
+
+	nfs_timer_start = get_time_ns();
+
+	while (done < nslots) {
+		net_poll();
+
+		list_for_each_entry_safe(packet, tmp, &npriv->packets, list) {
+			struct nfs_read_slot *slot;
+
+			slot = nfs_read_find_slot(slots, nslots, packet);
+			if (!slot || slot->packet) {
+				nfs_free_packet(packet);
+				continue;
+			}
+
+			list_del_init(&packet->list);
+			slot->packet = packet;
+			done++;
+			nfs_timer_start = get_time_ns();
+		}
+
+		if (is_timeout(nfs_timer_start, NFS_TIMEOUT)) {
+			tries++;
+			if (tries == NFS_MAX_RESEND) {
+				ret = -ETIMEDOUT;
+				goto out;
+			}
+
+			for (i = 0; i < nslots; i++)
+				if (!slots[i].packet)
+					nfs_read_send(priv, &slots[i]);
+
+			nfs_timer_start = get_time_ns();
+		}
+	}
+
+	for (i = 0; i < nslots; i++) {
+		ret = nfs_read_reply(priv, &slots[i], &eof);
+		if (ret < 0)
+			goto out;
+
+		/* the following replies are not contiguous to this one */
+		if (eof || ret < slots[i].count)
+			break;
+	}
+
+	ret = 0;
+out:
+	for (i = 0; i < nslots; i++)
+		if (slots[i].packet)
+			nfs_free_packet(slots[i].packet);
+
+	return ret;
 }
 
 static void nfs_handler(void *ctx, char *p, unsigned len)
@@ -1058,6 +1265,8 @@ static void nfs_handler(void *ctx, char *p, unsigned len)
 	struct nfs_priv *npriv = ctx;
 	struct packet *packet;
 
+	len = net_eth_to_udplen(p);
+
 	packet = xmalloc(sizeof(*packet) + len);
 	memcpy(packet->data, pkt, len);
 	packet->len = len;
@@ -1166,10 +1375,11 @@ static int nfs_open(struct device *dev, FILE *file, const char *filename)
 	priv = xzalloc(sizeof(*priv));
 	priv->fh = ninode->fh;
 	priv->npriv = npriv;
+	priv->windowsize = clamp(g_nfs_window_size, 1, NFS_MAX_WINDOW_SIZE);
 	file->priv = priv;
 	file->size = inode->i_size;
 
-	priv->fifo = kfifo_alloc(1024);
+	priv->fifo = kfifo_alloc(priv->windowsize * npriv->rsize);
 	if (!priv->fifo) {
 		free(priv);
 		return -ENOMEM;
@@ -1197,11 +1407,8 @@ static int nfs_read(struct device *dev, FILE *file, void *buf, size_t insize)
 {
 	struct file_priv *priv = file->priv;
 
-	if (insize > 1024)
-		insize = 1024;
-
 	if (insize && !kfifo_len(priv->fifo)) {
-		int ret = nfs_read_req(priv, file->pos, insize);
+		int ret = nfs_read_req(priv, file->pos, file->size);
 		if (ret)
 			return ret;
 	}
@@ -1433,6 +1640,8 @@ static int nfs_probe(struct device *dev)
 	char *tmp = xstrdup(fsdev->backingstore);
 	char *path;
 	struct inode *inode;
+	unsigned long long rsize;
+	uint32_t rtmax;
 	int ret;
 
 	dev->priv = npriv;
@@ -1500,6 +1709,18 @@ static int nfs_probe(struct device *dev)
 		goto err2;
 	}
 
+	ret = nfs_fsinfo_req(npriv, &rtmax);
+	if (ret)
+		rtmax = 0;
+
+	rsize = NFS_DEFAULT_RSIZE;
+	parseopt_llu_suffix(fsdev->options, "rsize", &rsize);
+	rsize = clamp_t(unsigned long long, rsize, 512, NFS_MAX_RSIZE);
+	if (rtmax)
+		rsize = min_t(unsigned long long, rsize, rtmax);
+	npriv->rsize = rsize;
+	debug("rsize: %u\n", npriv->rsize);
+
 	nfs_set_rootarg(npriv, fsdev);
 
 	free(tmp);
@@ -1556,6 +1777,7 @@ static int nfs_init(void)
 	rootnfsopts = xstrdup("v3,tcp");
 
 	globalvar_add_simple_string("linux.rootnfsopts", &rootnfsopts);
+	globalvar_add_simple_int("nfs.windowsize", &g_nfs_window_size, "%u");
 
 	return register_fs_driver(&nfs_driver);
 }
@@ -25,12 +25,21 @@
 #include <xfuncs.h>
 #include <linux/sizes.h>
 
-#define CHUNK_SIZE	(4096 * 2)
-
+/*
+ * File data is stored in contiguous extents. A file normally consists of
+ * a single extent which grows geometrically with realloc() as the file is
+ * written, so that appending is amortized O(1) and the file can be
+ * memmapped. Only when memory is too fragmented to grow the last extent
+ * further a new one is added.
+ *
+ * Once a file has been memmapped its extents are pinned: they are never
+ * moved, shrunk or freed again until the file is deleted, as the mapping
+ * may still be in use. Such a file grows by adding extents.
+ */
 struct ramfs_chunk {
 	char *data;
 	unsigned long ofs;
-	int size;
+	unsigned long size;
 	struct list_head list;
 };
 
@@ -48,6 +57,9 @@ struct ramfs_inode {
 	struct list_head data;
 
 	struct ramfs_chunk *current_chunk;
+
+	/* memmapped, the extents must not move anymore */
+	bool pinned;
 };
 
 static inline struct ramfs_inode *to_ramfs_inode(struct inode *inode)
@@ -196,7 +208,9 @@ static const struct inode_operations ramfs_dir_inode_operations =
 };
 
 static struct ramfs_chunk *ramfs_find_chunk(struct ramfs_inode *node,
-					    unsigned long pos, int *ofs, int *len)
+					    unsigned long pos,
+					    unsigned long *ofs,
+					    unsigned long *len)
 {
 	struct ramfs_chunk *data, *cur = node->current_chunk;
 
@@ -226,9 +240,9 @@ static int ramfs_read(struct device *_dev, FILE *f, void *buf, size_t insize)
 	struct inode *inode = f->f_inode;
 	struct ramfs_inode *node = to_ramfs_inode(inode);
 	struct ramfs_chunk *data;
-	int ofs, len, now;
+	unsigned long ofs, len, now;
 	unsigned long pos = f->pos;
-	int size = insize;
+	size_t size = insize;
 
 	debug("%s: %p %zu @ %lld\n", __func__, node, insize, f->pos);
 
@@ -237,9 +251,9 @@ static int ramfs_read(struct device *_dev, FILE *f, void *buf, size_t insize)
 		if (!data)
 			return -EINVAL;
 
-		debug("%s: pos: %lu ofs: %d len: %d\n", __func__, pos, ofs, len);
+		debug("%s: pos: %lu ofs: %lu len: %lu\n", __func__, pos, ofs, len);
 
-		now = min(size, len);
+		now = min_t(unsigned long, size, len);
 
 		memcpy(buf, data->data + ofs, now);
 
@@ -257,9 +271,9 @@ static int ramfs_write(struct device *_dev, FILE *f, const void *buf,
 	struct inode *inode = f->f_inode;
 	struct ramfs_inode *node = to_ramfs_inode(inode);
 	struct ramfs_chunk *data;
-	int ofs, len, now;
+	unsigned long ofs, len, now;
 	unsigned long pos = f->pos;
-	int size = insize;
+	size_t size = insize;
 
 	debug("%s: %p %zu @ %lld\n", __func__, node, insize, f->pos);
 
@@ -268,9 +282,9 @@ static int ramfs_write(struct device *_dev, FILE *f, const void *buf,
 		if (!data)
 			return -EINVAL;
 
-		debug("%s: pos: %lu ofs: %d len: %d\n", __func__, pos, ofs, len);
+		debug("%s: pos: %lu ofs: %lu len: %lu\n", __func__, pos, ofs, len);
 
-		now = min(size, len);
+		now = min_t(unsigned long, size, len);
 
 		memcpy(data->data + ofs, buf, now);
 
@@ -282,21 +296,63 @@ static int ramfs_write(struct device *_dev, FILE *f, const void *buf,
 	return insize;
 }
 
+/*
+ * The allocated space behind the end of the file is always zeroed, so
+ * growing the file again needs no clearing.
+ */
 static void ramfs_truncate_down(struct ramfs_inode *node, unsigned long size)
 {
 	struct ramfs_chunk *data, *tmp;
+	unsigned long start, end;
 
 	list_for_each_entry_safe(data, tmp, &node->data, list) {
-		if (data->ofs >= size) {
+		if (data->ofs >= size && !node->pinned) {
 			list_del(&data->list);
 			node->alloc_size -= data->size;
 			ramfs_put_chunk(data);
+		} else if (data->ofs + data->size > size) {
+			start = max(data->ofs, size);
+			end = min(data->ofs + data->size, node->size);
+			if (end > start)
+				memset(data->data + start - data->ofs, 0,
+				       end - start);
 		}
 	}
 
 	node->current_chunk = NULL;
 }
 
+static int ramfs_grow_chunk(struct ramfs_inode *node, unsigned long size)
+{
+	struct ramfs_chunk *data;
+	unsigned long newsize;
+	char *p;
+
+	if (list_empty(&node->data) || node->pinned)
+		return -ENOMEM;
+
+	data = list_last_entry(&node->data, struct ramfs_chunk, list);
+
+	/*
+	 * At least double, so that a file written piecewise is copied rarely.
+	 * When that fails the caller adds another extent. Growing to the
+	 * exact size instead would copy the whole file on every write.
+	 */
+	newsize = max(size - data->ofs, 2 * data->size);
+
+	p = realloc(data->data, newsize);
+	if (!p)
+		return -ENOMEM;
+
+	memset(p + data->size, 0, newsize - data->size);
+
+	node->alloc_size += newsize - data->size;
+	data->data = p;
+	data->size = newsize;
+
+	return 0;
+}
+
 static int ramfs_truncate_up(struct ramfs_inode *node, unsigned long size)
 {
 	struct ramfs_chunk *data, *tmp;
@@ -308,6 +364,9 @@ static int ramfs_truncate_up(struct ramfs_inode *node, unsigned long size)
 	if (node->alloc_size >= size)
 		return 0;
 
+	if (!ramfs_grow_chunk(node, size))
+		return 0;
+
 	/*
 	 * We first try to allocate all space we need in a single chunk.
 	 * This may fail because of fragmented memory, so in case we cannot
@@ -388,21 +447,89 @@ static int ramfs_truncate(struct device *dev, FILE *f, loff_t size)
 	return 0;
 }
 
+/* Give back what the geometric growth allocated in advance */
+static int ramfs_close(struct device *dev, FILE *f)
+{
+	struct ramfs_inode *node = to_ramfs_inode(f->f_inode);
+	struct ramfs_chunk *data;
+	unsigned long newsize;
+	char *p;
+
+	if ((f->flags & O_ACCMODE) == O_RDONLY || node->pinned ||
+	    list_empty(&node->data))
+		return 0;
+
+	data = list_last_entry(&node->data, struct ramfs_chunk, list);
+
+	newsize = max_t(unsigned long, node->size - data->ofs, MIN_SIZE);
+	if (newsize >= data->size || data->size - newsize < MIN_SIZE)
+		return 0;
+
+	p = realloc(data->data, newsize);
+	if (!p)
+		return 0;
+
+	node->alloc_size -= data->size - newsize;
+	data->data = p;
+	data->size = newsize;
+
+	return 0;
+}
+
+/* Move the data of a file with multiple extents into a single one */
+static int ramfs_coalesce(struct ramfs_inode *node)
+{
+	struct ramfs_chunk *data, *tmp, *new;
+
+	new = malloc(sizeof(*new));
+	if (!new)
+		return -ENOMEM;
+
+	new->data = malloc(node->alloc_size);
+	if (!new->data) {
+		free(new);
+		return -ENOMEM;
+	}
+
+	new->ofs = 0;
+	new->size = node->alloc_size;
+
+	list_for_each_entry_safe(data, tmp, &node->data, list) {
+		memcpy(new->data + data->ofs, data->data, data->size);
+		list_del(&data->list);
+		ramfs_put_chunk(data);
+	}
+
+	list_add(&new->list, &node->data);
+	node->current_chunk = NULL;
+
+	return 0;
+}
+
 static int ramfs_memmap(struct device *_dev, FILE *f, void **map, int flags)
 {
 	struct inode *inode = f->f_inode;
 	struct ramfs_inode *node = to_ramfs_inode(inode);
 	struct ramfs_chunk *data;
+	int ret;
 
 	if (list_empty(&node->data))
 		return -EINVAL;
 
-	if (!list_is_singular(&node->data))
-		return -EINVAL;
+	if (!list_is_singular(&node->data)) {
+		/* the extents of an earlier mapping must stay where they are */
+		if (node->pinned)
+			return -EBUSY;
+
+		ret = ramfs_coalesce(node);
+		if (ret)
+			return ret;
+	}
 
 	data = list_first_entry(&node->data, struct ramfs_chunk, list);
 
 	*map = data->data;
+	node->pinned = true;
 
 	return 0;
 }
@@ -422,6 +549,8 @@ static void ramfs_destroy_inode(struct inode *inode)
 {
 	struct ramfs_inode *node = to_ramfs_inode(inode);
 
+	/* the file is gone, mappings of it are invalid now */
+	node->pinned = false;
 	ramfs_truncate_down(node, 0);
 
 	free(node);
@@ -455,6 +584,7 @@ static struct fs_driver ramfs_driver = {
 	.write     = ramfs_write,
 	.memmap    = ramfs_memmap,
 	.truncate  = ramfs_truncate,
+	.close     = ramfs_close,
 	.flags     = FS_DRIVER_NO_DEV,
 	.drv = {
 		.probe  = ramfs_probe,
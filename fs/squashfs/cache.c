@@ -19,28 +19,30 @@
 
 /*
  * Blocks in Squashfs are compressed.  To avoid repeatedly decompressing
- * recently accessed data Squashfs uses two small metadata and fragment caches.
+ * recently accessed data Squashfs uses small metadata, fragment and data
+ * block caches.
  *
- * This file implements a generic cache implementation used for both caches,
+ * This file implements a generic cache implementation used for all caches,
  * plus functions layered ontop of the generic cache implementation to
- * access the metadata and fragment caches.
+ * access the metadata, fragment and data caches.
  *
  * To avoid out of memory and fragmentation issues with vmalloc the cache
  * uses sequences of kmalloced PAGE_CACHE_SIZE buffers.
  *
- * It should be noted that the cache is not used for file datablocks, these
- * are decompressed and cached in the page-cache in the normal way.  The
- * cache is only used to temporarily cache fragment and metadata blocks
- * which have been read as as a result of a metadata (i.e. inode or
- * directory) or fragment access.  Because metadata and fragments are packed
- * together into blocks (to gain greater compression) the read of a particular
- * piece of metadata or fragment will retrieve other metadata/fragments which
- * have been packed with it, these because of locality-of-reference may be read
- * in the near future. Temporarily caching them ensures they are available for
- * near future access without requiring an additional read and decompress.
+ * Because metadata and fragments are packed together into blocks (to gain
+ * greater compression) the read of a particular piece of metadata or fragment
+ * will retrieve other metadata/fragments which have been packed with it,
+ * these because of locality-of-reference may be read in the near future.
+ * Temporarily caching them ensures they are available for near future access
+ * without requiring an additional read and decompress.  The data cache holds
+ * file datablocks which were only partially read, so reading a file in
+ * chunks smaller than the block size decompresses each block only once.
  */
 
 #include <linux/fs.h>
+#include <linux/hash.h>
+#include <linux/list.h>
+#include <linux/log2.h>
 #include <linux/pagemap.h>
 
 #include "squashfs_fs.h"
@@ -51,59 +53,20 @@
 /*
  * Look-up block in cache, and increment usage count.  If not in cache, read
  * and decompress it from disk.
+ *
+ * Entries are found through a hash table on the block number and kept on a
+ * list in order of use, so the entry evicted on a miss is the least recently
+ * used one that isn't currently referenced.
  */
 struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
 	struct squashfs_cache *cache, u64 block, int length)
 {
-	int i, n;
+	struct hlist_head *head = &cache->hash[hash_64(block, cache->hash_bits)];
 	struct squashfs_cache_entry *entry;
 
-	while (1) {
-		for (i = cache->curr_blk, n = 0; n < cache->entries; n++) {
-			if (cache->entry[i].block == block) {
-				cache->curr_blk = i;
-				break;
-			}
-			i = (i + 1) % cache->entries;
-		}
-
-		if (n == cache->entries) {
-
-			/*
-			 * At least one unused cache entry.  A simple
-			 * round-robin strategy is used to choose the entry to
-			 * be evicted from the cache.
-			 */
-			i = cache->next_blk;
-			for (n = 0; n < cache->entries; n++) {
-				if (cache->entry[i].refcount == 0)
-					break;
-				i = (i + 1) % cache->entries;
-			}
-
-			cache->next_blk = (i + 1) % cache->entries;
-			entry = &cache->entry[i];
-
-			/*
-			 * Initialise chosen cache entry, and fill it in from
-			 * disk.
-			 */
-			cache->unused--;
-			entry->block = block;
-			entry->refcount = 1;
-			entry->pending = 1;
-			entry->error = 0;
-
-			entry->length = squashfs_read_data(sb, block, length,
-				&entry->next_index, entry->actor);
-
-			if (entry->length < 0)
-				entry->error = entry->length;
-
-			entry->pending = 0;
-
-			goto out;
-		}
+	hlist_for_each_entry(entry, head, hash) {
+		if (entry->block != block)
+			continue;
 
 		/*
 		 * Block already in cache.  Increment refcount so it doesn't
@@ -111,17 +74,54 @@ struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
 		 * previously unused there's one less cache entry available
 		 * for reuse.
 		 */
-		entry = &cache->entry[i];
 		if (entry->refcount == 0)
 			cache->unused--;
 		entry->refcount++;
+		list_move(&entry->lru, &cache->lru);
 
 		goto out;
 	}
 
+	/*
+	 * Callers hold at most one entry of a cache at a time, so there is
+	 * always an unused one to be evicted.
+	 */
+	list_for_each_entry_reverse(entry, &cache->lru, lru)
+		if (entry->refcount == 0)
+			break;
+
+	BUG_ON(&entry->lru == &cache->lru);
+
+	/*
+	 * Initialise chosen cache entry, and fill it in from disk.  It is
+	 * only hashed when the read succeeded, so a failed block is read
+	 * again on the next access.
+	 */
+	hlist_del_init(&entry->hash);
+	list_move(&entry->lru, &cache->lru);
+
+	cache->unused--;
+	entry->block = block;
+	entry->refcount = 1;
+	entry->pending = 1;
+	entry->error = 0;
+
+	entry->length = squashfs_read_data(sb, block, length,
+		&entry->next_index, entry->actor);
+
+	if (entry->length < 0) {
+		entry->error = entry->length;
+		entry->block = SQUASHFS_INVALID_BLK;
+	} else {
+		hlist_add_head(&entry->hash, head);
+	}
+
+	entry->pending = 0;
+
 out:
-	TRACE("Got %s %d, start block %lld, refcount %d, error %d\n",
-		cache->name, i, entry->block, entry->refcount, entry->error);
+	TRACE("Got %s %td, start block %lld, refcount %d, error %d\n",
+		cache->name, entry - cache->entry, block, entry->refcount,
+		entry->error);
 
 	if (entry->error)
 		ERROR("Unable to read %s cache entry [%llx]\n", cache->name,
@@ -162,6 +162,7 @@ void squashfs_cache_delete(struct squashfs_cache *cache)
 	}
 
 	kfree(cache->entry);
+	kfree(cache->hash);
 	kfree(cache);
 }
 
@@ -188,8 +189,15 @@ struct squashfs_cache *squashfs_cache_init(char *name, int entries,
 		goto cleanup;
 	}
 
-	cache->curr_blk = 0;
-	cache->next_blk = 0;
+	/* about two hash buckets per entry */
+	cache->hash_bits = ilog2(roundup_pow_of_two(entries)) + 1;
+	cache->hash = calloc(1 << cache->hash_bits, sizeof(*cache->hash));
+	if (cache->hash == NULL) {
+		ERROR("Failed to allocate %s cache\n", name);
+		goto cleanup;
+	}
+
+	INIT_LIST_HEAD(&cache->lru);
 	cache->unused = entries;
 	cache->entries = entries;
 	cache->block_size = block_size;
@@ -202,6 +210,8 @@ struct squashfs_cache *squashfs_cache_init(char *name, int entries,
 
 		entry->cache = cache;
 		entry->block = SQUASHFS_INVALID_BLK;
+		INIT_HLIST_NODE(&entry->hash);
+		list_add_tail(&entry->lru, &cache->lru);
 		entry->data = calloc(cache->pages, sizeof(void *));
 		if (entry->data == NULL) {
 			ERROR("Failed to allocate %s cache entry\n", name);
@@ -343,103 +343,71 @@ static int read_blocklist(struct inode *inode, int index, u64 *block)
 	return le32_to_cpu(size);
 }
 
-/* Copy data into page cache  */
-void squashfs_copy_cache(struct page *page, struct squashfs_cache_entry *buffer,
-	int bytes, int offset)
+/* Read from a datablock stored packed inside a fragment (tail-end packed block) */
+static int squashfs_read_fragment(struct inode *inode, int offset, void *buf,
+				  int bytes)
 {
-	int i;
-	struct squashfs_page *sq_page = squashfs_page(page);
-
-	/*
-	 * Loop copying datablock into pages.  As the datablock likely covers
-	 * many PAGE_CACHE_SIZE pages (default block size is 128 KiB) explicitly
-	 * grab the pages from the page cache, except for the page that we've
-	 * been called to fill.
-	 */
-	for (i = 0; i < 32 && bytes > 0; i++,
-			bytes -= PAGE_CACHE_SIZE, offset += PAGE_CACHE_SIZE) {
-		int avail = buffer ? min_t(int, bytes, PAGE_CACHE_SIZE) : 0;
-
-		TRACE("bytes %d, i %d, available_bytes %d\n", bytes, i, avail);
-
-		squashfs_copy_data(sq_page->buf[i], buffer, offset, avail);
-		memset(sq_page->buf[i] + avail, 0, PAGE_CACHE_SIZE - avail);
-		sq_page->idx++;
-	}
-}
-
-/* Read datablock stored packed inside a fragment (tail-end packed block) */
-static int squashfs_readpage_fragment(struct page *page)
-{
-	struct inode *inode = page->inode;
-	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
 	struct squashfs_cache_entry *buffer = squashfs_get_fragment(inode->i_sb,
 		squashfs_i(inode)->fragment_block,
 		squashfs_i(inode)->fragment_size);
 	int res = buffer->error;
 
-	TRACE("squashfs_readpage_fragment: frag size: %d\n",
+	TRACE("squashfs_read_fragment: frag size: %d\n",
 		squashfs_i(inode)->fragment_size);
 	if (res)
-		ERROR("Unable to read page, block %llx, size %x\n",
+		ERROR("Unable to read fragment, block %llx, size %x\n",
 			squashfs_i(inode)->fragment_block,
 			squashfs_i(inode)->fragment_size);
-	else
-		squashfs_copy_cache(page, buffer, i_size_read(inode) &
-			(msblk->block_size - 1),
-			squashfs_i(inode)->fragment_offset);
+	else if (squashfs_copy_data(buf, buffer,
+			squashfs_i(inode)->fragment_offset + offset,
+			bytes) != bytes)
+		res = -EIO;
 
 	squashfs_cache_put(buffer);
 	return res;
 }
 
-static int squashfs_readpage_sparse(struct page *page, int index, int file_end)
+/*
+ * Read up to len bytes of the file at pos into buf.  A single call never
+ * crosses a datablock boundary, so callers loop until they have all data.
+ * Returns the number of bytes read, 0 at the end of the file or a negative
+ * error code.
+ */
+int squashfs_read_file(struct inode *inode, loff_t pos, void *buf, size_t len)
 {
-	struct inode *inode = page->inode;
 	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
-	int bytes = index == file_end ?
-			(i_size_read(inode) & (msblk->block_size - 1)) :
-			 msblk->block_size;
-
-	squashfs_copy_cache(page, NULL, bytes, 0);
-
-	return 0;
-}
+	loff_t size = i_size_read(inode);
+	int index = pos >> msblk->block_log;
+	int file_end = size >> msblk->block_log;
+	int offset = pos & (msblk->block_size - 1);
+	int bytes, res;
 
-int squashfs_readpage(struct file *file, struct page *page)
-{
-	struct inode *inode = page->inode;
-	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
-	int index = page->index >> (msblk->block_log - PAGE_CACHE_SHIFT);
-	int file_end = i_size_read(inode) >> msblk->block_log;
-	int res;
+	TRACE("Entered squashfs_read_file, pos %llx, start block %llx\n",
+				pos, squashfs_i(inode)->start);
 
-	TRACE("Entered squashfs_readpage, page index %lx, start block %llx\n",
-				page->index, squashfs_i(inode)->start);
+	if (pos >= size)
+		return 0;
 
-	if (page->index >= ((i_size_read(inode) + PAGE_CACHE_SIZE - 1) >>
-					PAGE_CACHE_SHIFT))
-		goto out;
+	bytes = min_t(loff_t, size - pos, msblk->block_size - offset);
+	bytes = min_t(size_t, bytes, len);
 
 	if (index < file_end || squashfs_i(inode)->fragment_block ==
 					SQUASHFS_INVALID_BLK) {
 		u64 block = 0;
 		int bsize = read_blocklist(inode, index, &block);
 		if (bsize < 0)
-			goto out;
+			return bsize;
 
-		if (bsize == 0)
-			res = squashfs_readpage_sparse(page, index, file_end);
-		else
-			res = squashfs_readpage_block(page, block, bsize);
+		if (bsize == 0) {
+			/* sparse block */
+			memset(buf, 0, bytes);
+			res = 0;
+		} else {
+			res = squashfs_read_block(inode, block, bsize, offset,
+						  buf, bytes);
+		}
 	} else
-		res = squashfs_readpage_fragment(page);
-
-	if (!res)
-		return 0;
-
-out:
-	memset(page->addr, 0, PAGE_CACHE_SIZE);
+		res = squashfs_read_fragment(inode, offset, buf, bytes);
 
-	return 0;
+	return res ? res : bytes;
 }
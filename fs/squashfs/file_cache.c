@@ -10,25 +10,80 @@
 #include <linux/kernel.h>
 #include <linux/string.h>
 #include <linux/pagemap.h>
+#include <malloc.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
 #include "squashfs_fs_i.h"
 #include "squashfs.h"
+#include "page_actor.h"
 
-/* Read separately compressed datablock and memcopy into page cache */
-int squashfs_readpage_block(struct page *page, u64 block, int bsize)
+/*
+ * Decompress a full datablock straight into buf, which is block_size bytes
+ * large, without going through the data cache.
+ */
+static int squashfs_read_block_direct(struct super_block *sb, u64 block,
+				      int bsize, void *buf)
+{
+	struct squashfs_sb_info *msblk = sb->s_fs_info;
+	int pages = msblk->block_size >> PAGE_CACHE_SHIFT;
+	struct squashfs_page_actor *actor;
+	void **data;
+	int i, res;
+
+	data = calloc(pages, sizeof(void *));
+	if (data == NULL)
+		return -ENOMEM;
+
+	for (i = 0; i < pages; i++)
+		data[i] = buf + i * PAGE_CACHE_SIZE;
+
+	actor = squashfs_page_actor_init(data, pages, 0);
+	if (actor == NULL) {
+		res = -ENOMEM;
+		goto out;
+	}
+
+	res = squashfs_read_data(sb, block, bsize, NULL, actor);
+
+	/* only the last datablock of a file may be shorter */
+	if (res >= 0 && res != msblk->block_size) {
+		ERROR("Datablock %llx too short: %d\n", block, res);
+		res = -EIO;
+	}
+
+	kfree(actor);
+out:
+	kfree(data);
+
+	return res < 0 ? res : 0;
+}
+
+/*
+ * Read bytes from a separately compressed datablock at offset into buf.
+ * Full blocks are decompressed directly into buf, while partial reads go
+ * through the data cache so the rest of the block is still at hand for the
+ * next read.
+ */
+int squashfs_read_block(struct inode *inode, u64 block, int bsize,
+			int offset, void *buf, int bytes)
 {
-	struct inode *i = page->inode;
-	struct squashfs_cache_entry *buffer = squashfs_get_datablock(i->i_sb,
-		block, bsize);
-	int res = buffer->error;
+	struct super_block *sb = inode->i_sb;
+	struct squashfs_sb_info *msblk = sb->s_fs_info;
+	struct squashfs_cache_entry *buffer;
+	int res;
+
+	if (offset == 0 && bytes == msblk->block_size)
+		return squashfs_read_block_direct(sb, block, bsize, buf);
+
+	buffer = squashfs_get_datablock(sb, block, bsize);
+	res = buffer->error;
 
 	if (res)
-		ERROR("Unable to read page, block %llx, size %x\n", block,
+		ERROR("Unable to read datablock %llx, size %x\n", block,
 			bsize);
-	else
-		squashfs_copy_cache(page, buffer, buffer->length, 0);
+	else if (squashfs_copy_data(buf, buffer, offset, bytes) != bytes)
+		res = -EIO;
 
 	squashfs_cache_put(buffer);
 	return res;
@@ -133,66 +133,7 @@ static void squashfs_remove(struct device *dev)
 
 static int squashfs_open(struct device *dev, FILE *file, const char *filename)
 {
-	struct inode *inode = file->f_inode;
-	struct squashfs_page *page;
-	int i;
-
-	page = malloc(sizeof(struct squashfs_page));
-	page->buf = calloc(32, sizeof(*page->buf));
-	for (i = 0; i < 32; i++) {
-		page->buf[i] = malloc(PAGE_CACHE_SIZE);
-		if (page->buf[i] == NULL) {
-			dev_err(dev, "error allocation read buffer\n");
-			goto error;
-		}
-	}
-
-	page->data_block = 0;
-	page->idx = 0;
-	page->real_page.inode = inode;
-	file->size = inode->i_size;
-	file->priv = page;
-
-	return 0;
-
-error:
-	for (; i > 0; --i)
-		free(page->buf[i]);
-
-	free(page->buf);
-	free(page);
-
-	return -ENOMEM;
-}
-
-static int squashfs_close(struct device *dev, FILE *f)
-{
-	struct squashfs_page *page = f->priv;
-	int i;
-
-	for (i = 0; i < 32; i++)
-		free(page->buf[i]);
-
-	free(page->buf);
-	free(page);
-
-	return 0;
-}
-
-static int squashfs_read_buf(struct squashfs_page *page, int pos, void **buf)
-{
-	unsigned int data_block = pos / (32 * PAGE_CACHE_SIZE);
-	unsigned int data_block_pos = pos % (32 * PAGE_CACHE_SIZE);
-	unsigned int idx = data_block_pos / PAGE_CACHE_SIZE;
-
-	if (data_block != page->data_block || page->idx == 0) {
-		page->idx = 0;
-		page->real_page.index = data_block * 32;
-		squashfs_readpage(NULL, &page->real_page);
-		page->data_block = data_block;
-	}
-
-	*buf = page->buf[idx];
+	file->size = file->f_inode->i_size;
 
 	return 0;
 }
@@ -200,44 +141,26 @@ static int squashfs_read_buf(struct squashfs_page *page, int pos, void **buf)
 static int squashfs_read(struct device *_dev, FILE *f, void *buf,
 			 size_t insize)
 {
-	unsigned int size = insize;
-	unsigned int pos = f->pos;
-	unsigned int ofs;
-	unsigned int now;
-	void *pagebuf;
-	struct squashfs_page *page = f->priv;
-
-	/* Read till end of current buffer page */
-	ofs = pos % PAGE_CACHE_SIZE;
-	if (ofs) {
-		squashfs_read_buf(page, pos, &pagebuf);
-
-		now = min(size, PAGE_CACHE_SIZE - ofs);
-		memcpy(buf, pagebuf + ofs, now);
-
-		size -= now;
-		pos += now;
-		buf += now;
-	}
-
-	/* Do full buffer pages */
-	while (size >= PAGE_CACHE_SIZE) {
-		squashfs_read_buf(page, pos, &pagebuf);
-
-		memcpy(buf, pagebuf, PAGE_CACHE_SIZE);
-		size -= PAGE_CACHE_SIZE;
-		pos += PAGE_CACHE_SIZE;
-		buf += PAGE_CACHE_SIZE;
-	}
+	struct inode *inode = f->f_inode;
+	size_t done = 0;
+	int ret;
 
-	/* And the rest */
-	if (size) {
-		squashfs_read_buf(page, pos, &pagebuf);
-		memcpy(buf, pagebuf, size);
-		size  = 0;
+	/*
+	 * Every iteration handles one datablock, so large reads decompress
+	 * full blocks directly into buf.
+	 */
+	while (done < insize) {
+		ret = squashfs_read_file(inode, f->pos + done, buf + done,
+					 insize - done);
+		if (ret < 0)
+			return ret;
+		if (!ret)
+			break;
+
+		done += ret;
 	}
 
-	return insize;
+	return done;
 }
 
 struct squashfs_dir {
@@ -253,7 +176,6 @@ struct squashfs_dir {
 
 static struct fs_driver squashfs_driver = {
 	.open		= squashfs_open,
-	.close		= squashfs_close,
 	.read		= squashfs_read,
 	.type		= filetype_squashfs,
 	.drv = {
@@ -25,27 +25,6 @@
 #define DEBUG
 #define pgoff_t		unsigned long
 
-/*
- * We "simulate" the Linux page struct much simpler here
- */
-struct page {
-	pgoff_t index;
-	void *addr;
-	struct inode *inode;
-};
-
-
-struct squashfs_page {
-	struct page real_page;
-	char **buf;
-	int idx;
-	int data_block;
-};
-
-static inline struct squashfs_page *squashfs_page(struct page *page)
-{
-	return container_of(page, struct squashfs_page, real_page);
-}
 #define TRACE(s, args...)	pr_debug("SQUASHFS: "s, ## args)
 
 #define ERROR(s, args...)	pr_err("SQUASHFS error: "s, ## args)
@@ -93,12 +72,10 @@ extern int squashfs_frag_lookup(struct super_block *, unsigned int, u64 *);
 extern __le64 *squashfs_read_fragment_index_table(struct super_block *,
 				u64, u64, unsigned int);
 /* file.c */
-void squashfs_copy_cache(struct page *, struct squashfs_cache_entry *, int,
-				int);
-extern int squashfs_readpage(struct file *file, struct page *page);
+extern int squashfs_read_file(struct inode *, loff_t, void *, size_t);
 
 /* file_xxx.c */
-extern int squashfs_readpage_block(struct page *, u64, int);
+extern int squashfs_read_block(struct inode *, u64, int, int, void *, int);
 
 /* id.c */
 extern int squashfs_get_id(struct super_block *, unsigned int, unsigned int *);
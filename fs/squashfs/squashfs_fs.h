@@ -20,6 +20,7 @@
  */
 
 #define SQUASHFS_CACHED_FRAGMENTS	3
+#define SQUASHFS_CACHED_DATA_BLKS	4
 #define SQUASHFS_MAJOR			4
 #define SQUASHFS_MINOR			0
 #define SQUASHFS_START			0
@@ -23,13 +23,12 @@
 #include <linux/wait.h>
 #include <linux/mutex.h>
 #include <linux/barebox-wrapper.h>
+#include <linux/list.h>
 #include "squashfs_fs.h"
 
 struct squashfs_cache {
 	char			*name;
 	int			entries;
-	int			curr_blk;
-	int			next_blk;
 	int			num_waiters;
 	int			unused;
 	int			block_size;
@@ -37,6 +36,9 @@ struct squashfs_cache {
 	spinlock_t		lock;
 	wait_queue_head_t	wait_queue;
 	struct squashfs_cache_entry *entry;
+	struct hlist_head	*hash;
+	unsigned int		hash_bits;
+	struct list_head	lru;
 };
 
 struct squashfs_cache_entry {
@@ -49,6 +51,8 @@ struct squashfs_cache_entry {
 	int			num_waiters;
 	wait_queue_head_t	wait_queue;
 	struct squashfs_cache	*cache;
+	struct hlist_node	hash;
+	struct list_head	lru;
 	void			**data;
 	struct squashfs_page_actor	*actor;
 };
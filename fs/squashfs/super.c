@@ -31,6 +31,7 @@
 #include <linux/pagemap.h>
 #include <linux/magic.h>
 #include <linux/bitops.h>
+#include <parseopt.h>
 
 #include "page_actor.h"
 #include "squashfs_fs.h"
@@ -39,6 +40,9 @@
 #include "squashfs.h"
 #include "decompressor.h"
 
+/* upper limit for the configurable caches */
+#define SQUASHFS_CACHE_MAX_ENTRIES	1024
+
 static const struct squashfs_decompressor *supported_squashfs_filesystem(short
 	major, short minor, short id)
 {
@@ -88,6 +92,22 @@ void squashfs_put_super(struct super_block *sb)
 	}
 }
 
+/*
+ * Number of block_size entries for a cache, sized in bytes by the mount
+ * option opt.  The metadata cache is not configurable, the meta index code
+ * relies on it holding SQUASHFS_CACHED_BLKS blocks.
+ */
+static int squashfs_cache_entries(struct fs_device *fsdev, const char *opt,
+				  unsigned int block_size, int entries)
+{
+	unsigned long long size = (unsigned long long)entries * block_size;
+
+	parseopt_llu_suffix(fsdev->options, opt, &size);
+
+	return clamp_t(unsigned long long, size / block_size, 1,
+		       SQUASHFS_CACHE_MAX_ENTRIES);
+}
+
 static int squashfs_fill_super(struct super_block *sb, void *data, int silent)
 {
 	struct squashfs_sb_info *msblk;
@@ -220,7 +240,9 @@ static int squashfs_fill_super(struct super_block *sb, void *data, int silent)
 
 	/* Allocate read_page block */
 	msblk->read_page = squashfs_cache_init("data",
-		squashfs_max_decompressors(), msblk->block_size);
+		squashfs_cache_entries(fsdev, "datacache", msblk->block_size,
+				       SQUASHFS_CACHED_DATA_BLKS),
+		msblk->block_size);
 	if (msblk->read_page == NULL) {
 		ERROR("Failed to allocate read_page block\n");
 		goto failed_mount;
@@ -257,7 +279,9 @@ static int squashfs_fill_super(struct super_block *sb, void *data, int silent)
 	if (fragments == 0)
 		goto check_directory_table;
 	msblk->fragment_cache = squashfs_cache_init("fragment",
-		SQUASHFS_CACHED_FRAGMENTS, msblk->block_size);
+		squashfs_cache_entries(fsdev, "fragcache", msblk->block_size,
+				       SQUASHFS_CACHED_FRAGMENTS),
+		msblk->block_size);
 	if (msblk->fragment_cache == NULL) {
 		err = -ENOMEM;
 		goto failed_mount;
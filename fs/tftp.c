@@ -73,6 +73,9 @@
 
 #define TFTP_BLOCK_SIZE		512	/* default TFTP block size */
 #define TFTP_MTU_SIZE		1432	/* MTU based block size */
+/* largest block size fitting into a reassembled UDP datagram */
+#define TFTP_MAX_BLOCK_SIZE	(IS_ENABLED(CONFIG_NET_IP_REASSEMBLY) ? \
+				 65464 : TFTP_MTU_SIZE)
 #define TFTP_MAX_WINDOW_SIZE	CONFIG_FS_TFTP_MAX_WINDOW_SIZE
 
 /* allocate this number of blocks more than needed in the fifo */
@@ -93,6 +96,7 @@
 #endif
 
 static int g_tftp_window_size = DIV_ROUND_UP(TFTP_MAX_WINDOW_SIZE, 2);
+static int g_tftp_block_size = TFTP_MTU_SIZE;
 
 struct tftp_block {
 	uint16_t id;
@@ -121,6 +125,7 @@ struct file_priv {
 	struct kfifo *fifo;
 	void *buf;
 	int blocksize;
+	int req_blocksize;
 	unsigned int windowsize;
 	bool is_getattr;
 	struct tftp_cache cache;
@@ -218,6 +223,17 @@ static int tftp_send(struct file_priv *priv)
 			window_size = min_t(unsigned int, g_tftp_window_size,
 					    TFTP_MAX_WINDOW_SIZE);
 
+		if (priv->is_getattr)
+			/* use only a minimal blksize for getattr operations */
+			priv->req_blocksize = TFTP_BLOCK_SIZE;
+		else if (priv->push)
+			/* we do not fragment outgoing datagrams */
+			priv->req_blocksize = TFTP_MTU_SIZE;
+		else
+			priv->req_blocksize = clamp(g_tftp_block_size,
+						    TFTP_BLOCK_SIZE,
+						    TFTP_MAX_BLOCK_SIZE);
+
 		xp = pkt;
 		s = (uint16_t *)pkt;
 		if (priv->state == STATE_RRQ)
@@ -237,9 +253,7 @@ static int tftp_send(struct file_priv *priv)
 				'\0',	/* "timeout" */
 				TIMEOUT, '\0',
 				'\0',	/* "blksize" */
-				/* use only a minimal blksize for getattr
-				   operations, */
-				priv->is_getattr ? TFTP_BLOCK_SIZE : TFTP_MTU_SIZE);
+				priv->req_blocksize);
 		pkt++;
 
 		if (!priv->push)
@@ -350,7 +364,7 @@ static int tftp_parse_oack(struct file_priv *priv, unsigned char *pkt, int len)
 		s = val + strlen(val) + 1;
 	}
 
-	if (priv->blocksize > TFTP_MTU_SIZE ||
+	if (priv->blocksize > priv->req_blocksize ||
 	    priv->windowsize > TFTP_MAX_WINDOW_SIZE ||
 	    priv->windowsize == 0) {
 		pr_warn("tftp: invalid oack response\n");
@@ -1071,6 +1085,8 @@ static struct fs_driver tftp_driver = {
 static int tftp_init(void)
 {
 	globalvar_add_simple_int("tftp.windowsize", &g_tftp_window_size, "%u");
+	if (IS_ENABLED(CONFIG_NET_IP_REASSEMBLY))
+		globalvar_add_simple_int("tftp.blocksize", &g_tftp_block_size, "%u");
 
 	return register_fs_driver(&tftp_driver);
 }
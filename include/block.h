@@ -16,6 +16,7 @@ struct block_device_ops {
 };
 
 struct chunk;
+struct param_d;
 
 struct block_device {
 	struct device *dev;
@@ -31,6 +32,26 @@ struct block_device {
 
 	struct list_head buffered_blocks;
 	struct list_head idle_blocks;
+	struct hlist_head *chunk_hash;
+	unsigned int chunk_hash_size;
+	u32 cache_chunks;
+	struct chunk *chunks;
+	void **chunk_mem;
+	unsigned int chunk_groups;
+
+	u32 readahead;
+	loff_t readahead_next;
+	bool readahead_active;
+
+	u64 cache_hits;
+	u64 cache_misses;
+	u64 cache_writebacks;
+
+	struct param_d *param_cache_chunks;
+	struct param_d *param_readahead;
+	struct param_d *param_cache_hits;
+	struct param_d *param_cache_misses;
+	struct param_d *param_cache_writebacks;
 
 	struct cdev cdev;
 };
@@ -44,6 +65,7 @@ int blockdevice_unregister(struct block_device *blk);
 
 int block_read(struct block_device *blk, void *buf, sector_t block, blkcnt_t num_blocks);
 int block_write(struct block_device *blk, void *buf, sector_t block, blkcnt_t num_blocks);
+int block_invalidate(struct block_device *blk);
 
 static inline int block_flush(struct block_device *blk)
 {
@@ -0,0 +1,41 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+#ifndef __BOOT_PROFILE_H
+#define __BOOT_PROFILE_H
+
+#include <linux/types.h>
+
+enum boot_profile_type {
+	BOOT_PROFILE_INITCALL,
+	BOOT_PROFILE_PROBE,
+	BOOT_PROFILE_SCRIPT,
+	BOOT_PROFILE_COMMAND,
+	BOOT_PROFILE_NUM_TYPES,
+};
+
+#define BOOT_PROFILE_SORTED	(1 << 0)	/* most expensive first */
+
+#ifdef CONFIG_BOOT_PROFILE
+u64 boot_profile_begin(void);
+void boot_profile_end(enum boot_profile_type type, const void *fn,
+		      u64 start, int result, const char *fmt, ...)
+	__attribute__ ((format(__printf__, 5, 6)));
+void boot_profile_stop(void);
+char *boot_profile_format(unsigned int flags, unsigned int max);
+#else
+static inline u64 boot_profile_begin(void)
+{
+	return 0;
+}
+
+static inline __attribute__ ((format(__printf__, 5, 6)))
+void boot_profile_end(enum boot_profile_type type, const void *fn,
+		      u64 start, int result, const char *fmt, ...)
+{
+}
+
+static inline void boot_profile_stop(void)
+{
+}
+#endif
+
+#endif /* __BOOT_PROFILE_H */
@@ -10,4 +10,18 @@ int sha256_init(struct digest *desc);
 int sha256_update(struct digest *desc, const void *data, unsigned long len);
 int sha256_final(struct digest *desc, u8 *out);
 
+/*
+ * Optional architecture specific transform of @blocks 64 byte blocks.
+ * Returns false if the generic code has to be used instead.
+ */
+#if defined(__PBL__) && IS_ENABLED(CONFIG_PBL_SHA256_ARM64_CE)
+bool sha256_arch_blocks(u32 *state, const u8 *src, unsigned int blocks);
+#else
+static inline bool sha256_arch_blocks(u32 *state, const u8 *src,
+				      unsigned int blocks)
+{
+	return false;
+}
+#endif
+
 #endif /* __PBL-SHA_H_ */
@@ -99,6 +99,15 @@ struct device {
 	 * if a driver probe is deferred, this stores the last error
 	 */
 	char *deferred_probe_reason;
+
+	/*
+	 * if a driver probe is deferred, the device nodes of the not yet
+	 * probed suppliers the device is waiting for
+	 */
+	struct device_node **deferred_suppliers;
+	int num_deferred_suppliers;
+	/* number of successful probes when the probe was last deferred */
+	unsigned int deferred_stamp;
 };
 
 /** @brief Describes a driver present in the system */
@@ -64,4 +64,15 @@ int sparse_image_read(struct sparse_image_ctx *si, void *buf,
 void sparse_image_close(struct sparse_image_ctx *si);
 loff_t sparse_image_size(struct sparse_image_ctx *si);
 
+struct sparse_image_stream;
+
+struct sparse_image_stream *sparse_image_stream_new(size_t bufsize,
+		int (*write)(void *priv, const void *buf, size_t len, loff_t pos),
+		void *priv);
+int sparse_image_stream_feed(struct sparse_image_stream *ss, const void *buf,
+			     size_t len);
+int sparse_image_stream_finish(struct sparse_image_stream *ss);
+loff_t sparse_image_stream_size(struct sparse_image_stream *ss);
+void sparse_image_stream_free(struct sparse_image_stream *ss);
+
 #endif /* _IMAGE_SPARSE_H */
@@ -75,6 +75,8 @@ struct eth_device {
 	struct slice slice;
 
 	struct list_head send_queue;
+	struct list_head tx_pool;
+	unsigned int tx_pool_num;
 
 	bool ifup;
 #define ETH_MODE_DHCP 0
@@ -113,6 +115,9 @@ int eth_carrier_poll_once(struct eth_device *edev);
 int eth_open(struct eth_device *edev);
 void eth_close(struct eth_device *edev);
 int eth_send(struct eth_device *edev, void *packet, int length);	   /* Send a packet		*/
+void *eth_tx_buf_get(struct eth_device *edev);
+void eth_tx_buf_put(struct eth_device *edev, void *buf);
+int eth_send_tx_buf(struct eth_device *edev, void *buf, int length);
 int eth_rx(void);			/* Check for received packets	*/
 void eth_open_all(void);
 struct eth_device *of_find_eth_device_by_node(struct device_node *np);
@@ -305,6 +310,19 @@ static inline int net_eth_to_udplen(char *pkt)
 }
 
 int net_checksum_ok(unsigned char *, int);	/* Return true if cksum OK	*/
+
+#ifdef CONFIG_NET_IP_REASSEMBLY
+unsigned char *net_ip_reassemble(unsigned char *pkt, int *len);
+void net_ip_reassemble_done(unsigned char *pkt);
+#else
+static inline unsigned char *net_ip_reassemble(unsigned char *pkt, int *len)
+{
+	return NULL;
+}
+static inline void net_ip_reassemble_done(unsigned char *pkt)
+{
+}
+#endif
 uint16_t net_checksum(unsigned char *, int);	/* Calculate the checksum	*/
 
 /*
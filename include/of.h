@@ -24,8 +24,12 @@ struct property {
 	void *value;
 	const void *value_const;
 	struct list_head list;
+	unsigned int flags;
 };
 
+#define OF_PROPERTY_ARENA	(1 << 0)	/* allocated from the tree's arena */
+#define OF_PROPERTY_CONST_NAME	(1 << 1)	/* name is not owned */
+
 struct device_node {
 	char *name;
 	char *full_name;
@@ -37,8 +41,16 @@ struct device_node {
 	struct list_head list;
 	phandle phandle;
 	struct device *dev;
+	struct of_phandle_cache *phandle_cache;	/* root nodes only */
+	unsigned int flags;
+	/* position in the blob for trees unflattened in place */
+	uint32_t fdt_offset;
+	uint32_t fdt_size;
 };
 
+#define OF_NODE_ARENA		(1 << 0)	/* node and names in the tree's arena */
+#define OF_NODE_FDT_UNCHANGED	(1 << 1)	/* used while flattening */
+
 struct of_device_id {
 	char *compatible;
 	const void *data;
@@ -118,6 +130,8 @@ int of_probe(void);
 int of_parse_dtb(struct fdt_header *fdt);
 struct device_node *of_unflatten_dtb(const void *fdt, int size);
 struct device_node *of_unflatten_dtb_const(const void *infdt, int size);
+struct device_node *of_unflatten_dtb_owned(void *infdt, int size);
+void of_arena_free(struct device_node *root);
 
 int of_fixup_reserved_memory(struct device_node *node, void *data);
 
@@ -181,6 +195,7 @@ extern struct device_node *of_find_matching_node_and_match(
 extern struct device_node *of_find_node_with_property(
 	struct device_node *from, const char *prop_name);
 
+extern void __of_link_node(struct device_node *node, struct device_node *parent);
 extern struct device_node *of_new_node(struct device_node *parent,
 				const char *name);
 extern struct device_node *of_create_node(struct device_node *root,
@@ -1210,6 +1225,7 @@ int of_device_disable_path(const char *path);
 int of_device_disable_by_alias(const char *alias);
 
 phandle of_get_tree_max_phandle(struct device_node *root);
+void of_phandle_cache_invalidate(struct device_node *node);
 phandle of_node_create_phandle(struct device_node *node);
 int of_set_property_to_child_phandle(struct device_node *node, char *prop_name);
 
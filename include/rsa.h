@@ -22,6 +22,8 @@
  * and R^2, where R is 2^(# key bits).
  */
 
+struct rsa_mont;
+
 struct rsa_public_key {
 	uint len;		/* len of modulus[] in number of uint32_t */
 	uint32_t n0inv;		/* -1 / modulus[0] mod 2^32 */
@@ -30,6 +32,7 @@ struct rsa_public_key {
 	uint64_t exponent;	/* public exponent */
 	char *key_name_hint;
 	struct list_head list;
+	struct rsa_mont *mont;	/* precomputed for the native word size */
 };
 
 /**
@@ -21,6 +21,12 @@ int uncompress_buf_to_fd(const void *input, size_t input_len,
 ssize_t uncompress_buf_to_buf(const void *input, size_t input_len,
 			      void **buf, void(*error_fn)(char *x));
 
+struct digest;
+
+ssize_t uncompress_buf_to_buf_digest(const void *input, size_t input_len,
+				     void **buf, struct digest *digest,
+				     void(*error_fn)(char *x));
+
 void uncompress_err_stdout(char *);
 
 #endif /* __UNCOMPRESS_H */
@@ -0,0 +1,264 @@
+// SPDX-License-Identifier: GPL-2.0
+
+/*
+ * Wrapper for decompressing zstd-compressed images
+ *
+ * Based on the Linux kernel implementation by Nick Terrell.
+ *
+ * Data is decompressed in a single call when input and output are both
+ * available as one buffer, which needs only a ZSTD_DCtx and no sliding
+ * window. Otherwise a ZSTD_DStream is used, sized for the window of the
+ * frame being decompressed.
+ *
+ * When built for the PBL only the single call mode is available. The PBL
+ * early malloc area is too small for the ZSTD_DCtx, which is dominated by
+ * its 128KiB literals buffer, so the workspace is placed directly behind
+ * the decompressed image instead. This is the space of the BSS of barebox
+ * proper, which the PBL reserves with the image (MAX_BSS_SIZE) and which
+ * is only cleared after decompression.
+ */
+
+#ifdef STATIC
+#define UNZSTD_PREBOOT
+#include "xxhash.c"
+#include "zstd/entropy_common.c"
+#include "zstd/fse_decompress.c"
+#include "zstd/huf_decompress.c"
+#include "zstd/zstd_common.c"
+#include "zstd/decompress.c"
+#else
+#include <linux/decompress/unzstd.h>
+#include <malloc.h>
+#endif
+
+#include <linux/decompress/mm.h>
+#include <linux/kernel.h>
+#include <linux/zstd.h>
+#include <asm/unaligned.h>
+
+/* 128KB is the limit for a single zstd block */
+#define ZSTD_IOBUF_SIZE		(1 << 17)
+
+#define ZSTD_WINDOWSIZE_MAX	(1 << ZSTD_WINDOWLOG_MAX)
+
+static int handle_zstd_error(size_t ret, void (*error)(char *x))
+{
+	if (!ZSTD_isError(ret))
+		return 0;
+
+	switch (ZSTD_getErrorCode(ret)) {
+	case ZSTD_error_memory_allocation:
+		error("ZSTD decompressor ran out of memory");
+		break;
+	case ZSTD_error_prefix_unknown:
+		error("Input is not in the ZSTD format (wrong magic bytes)");
+		break;
+	case ZSTD_error_dstSize_tooSmall:
+	case ZSTD_error_corruption_detected:
+	case ZSTD_error_checksum_wrong:
+		error("ZSTD-compressed data is corrupt");
+		break;
+	default:
+		error("ZSTD-compressed data is probably corrupt");
+		break;
+	}
+
+	return -1;
+}
+
+static int decompress_single(const u8 *in_buf, size_t in_len, u8 *out_buf,
+			     size_t out_len, int *in_pos, void *wksp,
+			     size_t wksp_size, void (*error)(char *x))
+{
+	ZSTD_DCtx *dctx;
+	size_t ret;
+
+	dctx = ZSTD_initDCtx(wksp, wksp_size);
+	if (!dctx) {
+		error("Out of memory while allocating ZSTD_DCtx");
+		return -1;
+	}
+
+	/* ignore trailing data like the size appended by the build */
+	ret = ZSTD_findFrameCompressedSize(in_buf, in_len);
+	if (handle_zstd_error(ret, error))
+		return -1;
+
+	in_len = ret;
+
+	ret = ZSTD_decompressDCtx(dctx, out_buf, out_len, in_buf, in_len);
+	if (handle_zstd_error(ret, error))
+		return -1;
+
+	if (in_pos)
+		*in_pos = in_len;
+
+	return 0;
+}
+
+#ifdef UNZSTD_PREBOOT
+
+STATIC int decompress_unzstd(unsigned char *in_buf, int in_len,
+			     int (*fill)(void *, unsigned int),
+			     int (*flush)(void *, unsigned int),
+			     unsigned char *out_buf, int *in_pos,
+			     void (*error)(char *x))
+{
+	/* the uncompressed size is appended to the image by the build */
+	size_t out_len = get_unaligned_le32(in_buf + in_len - 4);
+	void *wksp = PTR_ALIGN(out_buf + out_len, 8);
+
+	return decompress_single(in_buf, in_len - 4, out_buf, out_len, in_pos,
+				 wksp, ZSTD_DCtxWorkspaceBound(), error);
+}
+
+#else
+
+static int decompress_stream(unsigned char *in_buf, int in_len,
+			     int (*fill)(void *, unsigned int),
+			     int (*flush)(void *, unsigned int),
+			     unsigned char *out_buf, int *in_pos,
+			     void (*error)(char *x))
+{
+	ZSTD_inBuffer in;
+	ZSTD_outBuffer out;
+	ZSTD_frameParams params;
+	ZSTD_DStream *dstream;
+	void *in_allocated = NULL, *out_allocated = NULL, *wksp = NULL;
+	size_t wksp_size, ret;
+	int err = -1;
+
+	if (!in_buf) {
+		in_allocated = large_malloc(ZSTD_IOBUF_SIZE);
+		if (!in_allocated) {
+			error("Out of memory while allocating input buffer");
+			goto out;
+		}
+		in_buf = in_allocated;
+	}
+
+	/* the frame header is needed to size the window */
+	if (fill)
+		in_len = fill(in_buf, ZSTD_IOBUF_SIZE);
+	if (in_len < 0) {
+		error("ZSTD-compressed data is truncated");
+		goto out;
+	}
+
+	in.src = in_buf;
+	in.pos = 0;
+	in.size = in_len;
+
+	if (flush) {
+		out_allocated = large_malloc(ZSTD_IOBUF_SIZE);
+		if (!out_allocated) {
+			error("Out of memory while allocating output buffer");
+			goto out;
+		}
+		out_buf = out_allocated;
+		out.size = ZSTD_IOBUF_SIZE;
+	} else {
+		/* as large as possible without overflowing the end address */
+		out.size = ULONG_MAX - (unsigned long)out_buf;
+	}
+
+	out.dst = out_buf;
+	out.pos = 0;
+
+	ret = ZSTD_getFrameParams(&params, in.src, in.size);
+	if (handle_zstd_error(ret, error))
+		goto out;
+	if (ret) {
+		error("ZSTD-compressed data has an incomplete frame header");
+		goto out;
+	}
+	if (params.windowSize > ZSTD_WINDOWSIZE_MAX) {
+		error("ZSTD-compressed data has too large a window size");
+		goto out;
+	}
+
+	wksp_size = ZSTD_DStreamWorkspaceBound(params.windowSize);
+	wksp = large_malloc(wksp_size);
+	dstream = ZSTD_initDStream(params.windowSize, wksp, wksp_size);
+	if (!dstream) {
+		error("Out of memory while allocating ZSTD_DStream");
+		goto out;
+	}
+
+	if (in_pos)
+		*in_pos = 0;
+
+	do {
+		if (in.pos == in.size) {
+			if (in_pos)
+				*in_pos += in.pos;
+
+			in_len = fill ? fill(in_buf, ZSTD_IOBUF_SIZE) : -1;
+			if (in_len < 0) {
+				error("ZSTD-compressed data is truncated");
+				goto out;
+			}
+
+			in.pos = 0;
+			in.size = in_len;
+		}
+
+		/* returns 0 when the frame is complete */
+		ret = ZSTD_decompressStream(dstream, &out, &in);
+		if (handle_zstd_error(ret, error))
+			goto out;
+
+		if (flush && out.pos) {
+			if (flush(out.dst, out.pos) != out.pos) {
+				error("Failed to flush()");
+				goto out;
+			}
+			out.pos = 0;
+		}
+	} while (ret);
+
+	if (in_pos)
+		*in_pos += in.pos;
+
+	err = 0;
+out:
+	large_free(in_allocated);
+	large_free(out_allocated);
+	large_free(wksp);
+
+	return err;
+}
+
+STATIC int decompress_unzstd(unsigned char *in_buf, int in_len,
+			     int (*fill)(void *, unsigned int),
+			     int (*flush)(void *, unsigned int),
+			     unsigned char *out_buf, int *in_pos,
+			     void (*error)(char *x))
+{
+	size_t wksp_size;
+	void *wksp;
+	int ret;
+
+	if (fill || flush)
+		return decompress_stream(in_buf, in_len, fill, flush, out_buf,
+					 in_pos, error);
+
+	wksp_size = ZSTD_DCtxWorkspaceBound();
+	wksp = large_malloc(wksp_size);
+	if (!wksp) {
+		error("Out of memory while allocating ZSTD_DCtx");
+		return -1;
+	}
+
+	ret = decompress_single(in_buf, in_len, out_buf,
+				ULONG_MAX - (unsigned long)out_buf, in_pos,
+				wksp, wksp_size, error);
+
+	large_free(wksp);
+
+	return ret;
+}
+
+#endif
+
+#define decompress decompress_unzstd
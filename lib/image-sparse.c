@@ -244,3 +244,349 @@ void sparse_image_close(struct sparse_image_ctx *si)
 	close(si->fd);
 	free(si);
 }
+
+enum sparse_stream_state {
+	SPARSE_STREAM_FILE_HDR,
+	SPARSE_STREAM_CHUNK_HDR,
+	SPARSE_STREAM_RAW,
+	SPARSE_STREAM_FILL,
+	SPARSE_STREAM_DONE,
+};
+
+struct sparse_image_stream {
+	enum sparse_stream_state state;
+	struct sparse_header sparse;
+	struct chunk_header chunk;
+	unsigned int processed_chunks;
+	size_t have;		/* bytes of the current header collected */
+	size_t skip;		/* bytes to discard before continuing */
+	loff_t pos;		/* output position */
+	uint64_t remaining;	/* output bytes left in the current chunk */
+	uint32_t fill_val;
+
+	void *buf;
+	size_t bufsize;
+	size_t buflen;
+
+	int (*write)(void *priv, const void *buf, size_t len, loff_t pos);
+	void *priv;
+};
+
+/**
+ * sparse_image_stream_new - create a parser for a sparse image in pieces
+ * @bufsize: size of the output buffer, the maximum length of a write
+ * @write: called for the data of raw and fill chunks at their output position
+ * @priv: passed to @write
+ *
+ * Unlike sparse_image_open() this doesn't need the whole image in a file.
+ * The image is passed to sparse_image_stream_feed() in pieces of arbitrary
+ * size as it arrives. Data is passed on to @write in pieces of up to
+ * @bufsize bytes that never span a chunk boundary, just like
+ * sparse_image_read() returns it.
+ */
+struct sparse_image_stream *sparse_image_stream_new(size_t bufsize,
+		int (*write)(void *priv, const void *buf, size_t len, loff_t pos),
+		void *priv)
+{
+	struct sparse_image_stream *ss;
+
+	ss = xzalloc(sizeof(*ss));
+	ss->buf = malloc(bufsize);
+	if (!ss->buf) {
+		free(ss);
+		return NULL;
+	}
+
+	ss->bufsize = bufsize;
+	ss->write = write;
+	ss->priv = priv;
+
+	return ss;
+}
+
+/**
+ * sparse_image_stream_size - size of the unsparsed image
+ * @ss: the sparse stream
+ *
+ * Return: the size, or 0 while the file header has not been received yet.
+ */
+loff_t sparse_image_stream_size(struct sparse_image_stream *ss)
+{
+	if (ss->state == SPARSE_STREAM_FILE_HDR)
+		return 0;
+
+	return (loff_t)le32_to_cpu(ss->sparse.blk_sz) *
+		le32_to_cpu(ss->sparse.total_blks);
+}
+
+static int sparse_stream_flush(struct sparse_image_stream *ss)
+{
+	int ret;
+
+	if (!ss->buflen)
+		return 0;
+
+	ret = ss->write(ss->priv, ss->buf, ss->buflen, ss->pos);
+	if (ret)
+		return ret;
+
+	ss->pos += ss->buflen;
+	ss->buflen = 0;
+
+	return 0;
+}
+
+/* collect a header that may be split between pieces */
+static bool sparse_stream_collect(struct sparse_image_stream *ss, void *hdr,
+				  size_t size, const void **buf, size_t *len)
+{
+	size_t now = min(size - ss->have, *len);
+
+	memcpy(hdr + ss->have, *buf, now);
+	ss->have += now;
+	*buf += now;
+	*len -= now;
+
+	if (ss->have < size)
+		return false;
+
+	ss->have = 0;
+
+	return true;
+}
+
+static void sparse_stream_next_chunk(struct sparse_image_stream *ss)
+{
+	if (ss->processed_chunks == le32_to_cpu(ss->sparse.total_chunks))
+		ss->state = SPARSE_STREAM_DONE;
+	else
+		ss->state = SPARSE_STREAM_CHUNK_HDR;
+}
+
+static int sparse_stream_file_hdr(struct sparse_image_stream *ss)
+{
+	struct sparse_header *s = &ss->sparse;
+
+	if (!is_sparse_image(s))
+		return -EINVAL;
+
+	if (le16_to_cpu(s->file_hdr_sz) < sizeof(struct sparse_header) ||
+	    le16_to_cpu(s->chunk_hdr_sz) < sizeof(struct chunk_header) ||
+	    !le32_to_cpu(s->blk_sz) || le32_to_cpu(s->blk_sz) & 3)
+		return -EINVAL;
+
+	/* skip the remaining bytes of a longer header than we expected */
+	ss->skip = le16_to_cpu(s->file_hdr_sz) - sizeof(struct sparse_header);
+
+	sparse_stream_next_chunk(ss);
+
+	return 0;
+}
+
+static int sparse_stream_chunk_hdr(struct sparse_image_stream *ss)
+{
+	struct chunk_header *c = &ss->chunk;
+	uint64_t chunk_data_sz;
+	uint32_t payload;
+
+	pr_debug("=== Chunk Header ===\n");
+	pr_debug("chunk_type: 0x%x\n", le16_to_cpu(c->chunk_type));
+	pr_debug("chunk_data_sz: 0x%x\n", le32_to_cpu(c->chunk_sz));
+	pr_debug("total_size: 0x%x\n", le32_to_cpu(c->total_sz));
+
+	if (le32_to_cpu(c->total_sz) < le16_to_cpu(ss->sparse.chunk_hdr_sz))
+		return -EINVAL;
+
+	chunk_data_sz = (uint64_t)le32_to_cpu(ss->sparse.blk_sz) *
+			le32_to_cpu(c->chunk_sz);
+	payload = le32_to_cpu(c->total_sz) -
+		  le16_to_cpu(ss->sparse.chunk_hdr_sz);
+
+	ss->skip = le16_to_cpu(ss->sparse.chunk_hdr_sz) -
+		   sizeof(struct chunk_header);
+	ss->processed_chunks++;
+
+	switch (le16_to_cpu(c->chunk_type)) {
+	case CHUNK_TYPE_RAW:
+		if (payload != chunk_data_sz)
+			return -EINVAL;
+
+		ss->remaining = chunk_data_sz;
+		if (ss->remaining)
+			ss->state = SPARSE_STREAM_RAW;
+		else
+			sparse_stream_next_chunk(ss);
+
+		break;
+
+	case CHUNK_TYPE_FILL:
+		if (payload != sizeof(uint32_t))
+			return -EINVAL;
+
+		ss->remaining = chunk_data_sz;
+		ss->state = SPARSE_STREAM_FILL;
+
+		break;
+
+	case CHUNK_TYPE_DONT_CARE:
+		ss->pos += chunk_data_sz;
+		ss->skip += payload;
+		sparse_stream_next_chunk(ss);
+
+		break;
+
+	case CHUNK_TYPE_CRC32:
+		if (payload != sizeof(uint32_t))
+			return -EINVAL;
+
+		ss->skip += payload;
+		sparse_stream_next_chunk(ss);
+
+		break;
+
+	default:
+		pr_err("Unknown chunk type 0x%04x", le16_to_cpu(c->chunk_type));
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int sparse_stream_fill(struct sparse_image_stream *ss)
+{
+	uint32_t *buf32 = ss->buf;
+	int ret, i;
+
+	while (ss->remaining) {
+		ss->buflen = min_t(uint64_t, ss->remaining, ss->bufsize);
+		if (ss->buflen & 3)
+			return -EINVAL;
+
+		for (i = 0; i < ss->buflen / sizeof(uint32_t); i++)
+			buf32[i] = ss->fill_val;
+
+		ss->remaining -= ss->buflen;
+
+		ret = sparse_stream_flush(ss);
+		if (ret)
+			return ret;
+	}
+
+	sparse_stream_next_chunk(ss);
+
+	return 0;
+}
+
+/**
+ * sparse_image_stream_feed - pass the next piece of a sparse image
+ * @ss: the sparse stream
+ * @buf: the data
+ * @len: the length of @buf
+ *
+ * Return: 0 for success or a negative error code. Errors from the write
+ * callback are passed on.
+ */
+int sparse_image_stream_feed(struct sparse_image_stream *ss, const void *buf,
+			     size_t len)
+{
+	size_t now;
+	int ret;
+
+	while (len) {
+		if (ss->skip) {
+			now = min(ss->skip, len);
+			ss->skip -= now;
+			buf += now;
+			len -= now;
+			continue;
+		}
+
+		switch (ss->state) {
+		case SPARSE_STREAM_FILE_HDR:
+			if (!sparse_stream_collect(ss, &ss->sparse,
+						   sizeof(ss->sparse), &buf, &len))
+				break;
+
+			ret = sparse_stream_file_hdr(ss);
+			if (ret)
+				return ret;
+
+			break;
+
+		case SPARSE_STREAM_CHUNK_HDR:
+			if (!sparse_stream_collect(ss, &ss->chunk,
+						   sizeof(ss->chunk), &buf, &len))
+				break;
+
+			ret = sparse_stream_chunk_hdr(ss);
+			if (ret)
+				return ret;
+
+			break;
+
+		case SPARSE_STREAM_RAW:
+			now = min_t(uint64_t, ss->remaining,
+				    ss->bufsize - ss->buflen);
+			now = min(now, len);
+
+			memcpy(ss->buf + ss->buflen, buf, now);
+			ss->buflen += now;
+			ss->remaining -= now;
+			buf += now;
+			len -= now;
+
+			if (ss->buflen == ss->bufsize || !ss->remaining) {
+				ret = sparse_stream_flush(ss);
+				if (ret)
+					return ret;
+			}
+
+			if (!ss->remaining)
+				sparse_stream_next_chunk(ss);
+
+			break;
+
+		case SPARSE_STREAM_FILL:
+			if (!sparse_stream_collect(ss, &ss->fill_val,
+						   sizeof(ss->fill_val), &buf, &len))
+				break;
+
+			ret = sparse_stream_fill(ss);
+			if (ret)
+				return ret;
+
+			break;
+
+		case SPARSE_STREAM_DONE:
+			/* ignore trailing data */
+			return 0;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * sparse_image_stream_finish - check that the image was complete
+ * @ss: the sparse stream
+ *
+ * Return: 0 when all chunks were received, -EINVAL otherwise
+ */
+int sparse_image_stream_finish(struct sparse_image_stream *ss)
+{
+	if (ss->state != SPARSE_STREAM_DONE || ss->skip) {
+		pr_err("sparse image is truncated\n");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+void sparse_image_stream_free(struct sparse_image_stream *ss)
+{
+	if (!ss)
+		return;
+
+	free(ss->buf);
+	free(ss);
+}
@@ -12,14 +12,55 @@
  *
  */
 #include <common.h>
+#include <dma.h>
 #include <fs.h>
 #include <fcntl.h>
+#include <globalvar.h>
+#include <init.h>
+#include <magicvar.h>
 #include <malloc.h>
 #include <libfile.h>
 #include <progress.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include <linux/sizes.h>
 #include <linux/stat.h>
 
+static int copy_bufsize = SZ_4M;
+
+/*
+ * copy_buf_alloc - allocate a buffer for copying a file
+ *
+ * Every read and write call costs a full round trip through the filesystem
+ * and driver, so copy in chunks of up to global.copy.bufsize, but not more
+ * than the file needs and not less than RW_BUF_SIZE. Falls back to smaller
+ * buffers when memory is tight. The buffer is DMA aligned so block devices
+ * can transfer into it directly.
+ */
+static void *copy_buf_alloc(loff_t size, size_t *bufsize)
+{
+	size_t bs = RW_BUF_SIZE;
+	void *buf;
+
+	if (copy_bufsize > (int)RW_BUF_SIZE)
+		bs = copy_bufsize;
+
+	/* empty files still need a buffer to find their end */
+	if (size >= 0 && size != FILESIZE_MAX)
+		bs = clamp_t(loff_t, ALIGN(size, RW_BUF_SIZE), RW_BUF_SIZE, bs);
+
+	while (1) {
+		buf = memalign(DMA_ALIGNMENT, bs);
+		if (buf || bs <= RW_BUF_SIZE)
+			break;
+		bs = max_t(size_t, bs / 2, RW_BUF_SIZE);
+	}
+
+	*bufsize = bs;
+
+	return buf;
+}
+
 /*
  * pwrite_full - write to filedescriptor at offset
  *
@@ -127,14 +168,20 @@ EXPORT_SYMBOL(read_full);
 
 int copy_fd(int in, int out)
 {
-	int bs = 4096, ret;
-	void *buf = malloc(bs);
+	struct stat s;
+	size_t bs;
+	void *buf;
+	int ret;
+
+	if (fstat(in, &s))
+		s.st_size = FILESIZE_MAX;
 
+	buf = copy_buf_alloc(s.st_size, &bs);
 	if (!buf)
 		return -ENOMEM;
 
 	while (1) {
-		ret = read(in, buf, bs);
+		ret = read_full(in, buf, bs);
 		if (ret <= 0)
 			break;
 
@@ -381,10 +428,9 @@ int copy_file(const char *src, const char *dst, int verbose)
 	int ret = 1, err1 = 0;
 	int mode;
 	loff_t total = 0;
+	size_t bufsize;
 	struct stat srcstat, dststat;
 
-	rw_buf = xmalloc(RW_BUF_SIZE);
-
 	srcfd = open(src, O_RDONLY);
 	if (srcfd < 0) {
 		printf("could not open %s: %m\n", src);
@@ -416,6 +462,12 @@ int copy_file(const char *src, const char *dst, int verbose)
 	if (ret)
 		goto out;
 
+	rw_buf = copy_buf_alloc(srcstat.st_size, &bufsize);
+	if (!rw_buf) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
 	if (srcstat.st_size != FILESIZE_MAX) {
 		discard_range(dstfd, srcstat.st_size, 0);
 		if (s || S_ISREG(dststat.st_mode)) {
@@ -429,7 +481,7 @@ int copy_file(const char *src, const char *dst, int verbose)
 		init_progression_bar(srcstat.st_size);
 
 	while (1) {
-		r = read(srcfd, rw_buf, RW_BUF_SIZE);
+		r = read_full(srcfd, rw_buf, bufsize);
 		if (r < 0) {
 			perror("read");
 			ret = r;
@@ -469,6 +521,17 @@ int copy_file(const char *src, const char *dst, int verbose)
 }
 EXPORT_SYMBOL(copy_file);
 
+static int copy_globalvar_init(void)
+{
+	globalvar_add_simple_int("copy.bufsize", &copy_bufsize, "%u");
+
+	return 0;
+}
+late_initcall(copy_globalvar_init);
+
+BAREBOX_MAGICVAR(global.copy.bufsize,
+		 "Maximum buffer size used for copying files");
+
 int copy_recursive(const char *src, const char *dst)
 {
 	struct stat s;
@@ -15,16 +15,19 @@
  */
 #include <common.h>
 #include <uncompress.h>
+#include <digest.h>
 #include <bunzip2.h>
 #include <gunzip.h>
 #include <lzo.h>
 #include <linux/xz.h>
 #include <linux/decompress/unlz4.h>
+#include <linux/decompress/unzstd.h>
 #include <errno.h>
 #include <filetype.h>
 #include <malloc.h>
 #include <fs.h>
 #include <libfile.h>
+#include <linux/sizes.h>
 
 static void *uncompress_buf;
 static unsigned int uncompress_size;
@@ -121,6 +124,11 @@ int uncompress(unsigned char *inbuf, int len,
 	case filetype_xz_compressed:
 		compfn = decompress_unxz;
 		break;
+#endif
+#ifdef CONFIG_ZSTD_DECOMPRESS
+	case filetype_zstd_compressed:
+		compfn = decompress_unzstd;
+		break;
 #endif
 	default:
 		err = basprintf("cannot handle filetype %s",
@@ -182,33 +190,108 @@ int uncompress_buf_to_fd(const void *input, size_t input_len,
 			  NULL, NULL, error_fn);
 }
 
-ssize_t uncompress_buf_to_buf(const void *input, size_t input_len,
-			      void **buf, void(*error_fn)(char *x))
+static const void *uncompress_inbuf;
+static size_t uncompress_inbuf_len, uncompress_inbuf_pos;
+static struct digest *uncompress_digest;
+static void *uncompress_outbuf;
+static size_t uncompress_outbuf_len, uncompress_outbuf_size;
+
+/*
+ * Hand out as much as the decompressor asks for: some of them (e.g. lz4)
+ * rely on getting everything they requested.
+ */
+static int fill_buf_digest(void *buf, unsigned int len)
+{
+	size_t now = min_t(size_t, len,
+			   uncompress_inbuf_len - uncompress_inbuf_pos);
+	const void *in = uncompress_inbuf + uncompress_inbuf_pos;
+
+	/*
+	 * Hash the chunk right before the decompressor consumes it, so the
+	 * input is only walked once while it is hot in the cache.
+	 */
+	if (uncompress_digest)
+		digest_update(uncompress_digest, in, now);
+
+	memcpy(buf, in, now);
+	uncompress_inbuf_pos += now;
+
+	return now;
+}
+
+/* initial size of the output buffer, it is doubled whenever it runs full */
+#define UNCOMPRESS_OUTBUF_MIN	SZ_256K
+
+static int flush_buf(void *buf, unsigned int len)
+{
+	if (uncompress_outbuf_len + len > uncompress_outbuf_size) {
+		size_t size = max3(uncompress_outbuf_size * 2,
+				   uncompress_outbuf_len + len,
+				   (size_t)UNCOMPRESS_OUTBUF_MIN);
+		void *p = realloc(uncompress_outbuf, size);
+
+		if (!p)
+			return -ENOMEM;
+
+		uncompress_outbuf = p;
+		uncompress_outbuf_size = size;
+	}
+
+	memcpy(uncompress_outbuf + uncompress_outbuf_len, buf, len);
+	uncompress_outbuf_len += len;
+
+	return len;
+}
+
+/**
+ * uncompress_buf_to_buf_digest - uncompress a buffer and hash its input
+ * @input:	compressed data
+ * @input_len:	length of @input
+ * @buf:	on success, the allocated buffer with the uncompressed data
+ * @digest:	initialized digest to feed @input into, may be NULL
+ * @error_fn:	error reporting function
+ *
+ * Decompresses @input and at the same time feeds all of it into @digest,
+ * so that verifying and decompressing data takes a single pass over it.
+ * The whole of @input is hashed even when decompression fails or stops
+ * early, so the caller can tell corrupted from malformed data.
+ *
+ * Return: the length of the uncompressed data or a negative error code
+ */
+ssize_t uncompress_buf_to_buf_digest(const void *input, size_t input_len,
+				     void **buf, struct digest *digest,
+				     void(*error_fn)(char *x))
 {
-	char *dstpath;
-	size_t size;
-	int outfd, ret;
-
-	dstpath = make_temp("data-uncompressed");
-	if (!dstpath)
-		return -ENOMEM;
-
-	outfd = open(dstpath, O_CREAT | O_WRONLY);
-	if (outfd < 0) {
-		ret = -ENODEV;
-		goto free_temp;
+	int ret;
+
+	uncompress_inbuf = input;
+	uncompress_inbuf_len = input_len;
+	uncompress_inbuf_pos = 0;
+	uncompress_digest = digest;
+	uncompress_outbuf_len = 0;
+	uncompress_outbuf_size = 0;
+	uncompress_outbuf = NULL;
+
+	ret = uncompress(NULL, 0, fill_buf_digest, flush_buf, NULL, NULL,
+			 error_fn);
+
+	if (digest)
+		digest_update(digest, input + uncompress_inbuf_pos,
+			      input_len - uncompress_inbuf_pos);
+
+	if (ret) {
+		free(uncompress_outbuf);
+		return ret;
 	}
 
-	ret = uncompress_buf_to_fd(input, input_len, outfd, uncompress_err_stdout);
-	if (ret)
-		goto close_outfd;
+	*buf = uncompress_outbuf;
 
-	*buf = read_file(dstpath, &size);
-close_outfd:
-	close(outfd);
-	unlink(dstpath);
-free_temp:
-	free(dstpath);
+	return uncompress_outbuf_len;
+}
 
-	return ret ?: size;
+ssize_t uncompress_buf_to_buf(const void *input, size_t input_len,
+			      void **buf, void(*error_fn)(char *x))
+{
+	return uncompress_buf_to_buf_digest(input, input_len, buf, NULL,
+					    error_fn);
 }
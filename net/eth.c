@@ -217,34 +217,125 @@ static int eth_carrier_check(struct eth_device *edev, bool may_wait)
 	return edev->phydev->link ? 0 : -ENETDOWN;
 }
 
+/*
+ * TX buffers carry their queue entry in front of the packet data, so a
+ * buffer handed out by eth_tx_buf_get() can be queued without copying.
+ */
 struct eth_q {
-	struct eth_device *edev;
 	int length;
 	struct list_head list;
-	void *data;
 };
 
-static int eth_queue(struct eth_device *edev, void *packet, int length)
+#define ETH_Q_HDR_SIZE		ALIGN(sizeof(struct eth_q), DMA_ALIGNMENT)
+#define ETH_TX_POOL_SIZE	16
+
+static inline void *eth_q_data(struct eth_q *q)
+{
+	return (void *)q + ETH_Q_HDR_SIZE;
+}
+
+static inline struct eth_q *eth_q_from_data(void *data)
+{
+	return data - ETH_Q_HDR_SIZE;
+}
+
+/**
+ * eth_tx_buf_get - get a DMA capable buffer for a packet to send
+ * @edev: the device the packet will be sent on
+ *
+ * Buffers are taken from a per device pool and allocated only when the
+ * pool is empty. The buffer is PKTSIZE bytes large.
+ *
+ * Return: the buffer or NULL when out of memory
+ */
+void *eth_tx_buf_get(struct eth_device *edev)
 {
 	struct eth_q *q;
 
-	q = xzalloc(sizeof(*q));
-	if (!q)
-		return -ENOMEM;
+	if (!list_empty(&edev->tx_pool)) {
+		q = list_first_entry(&edev->tx_pool, struct eth_q, list);
+		list_del(&q->list);
+		edev->tx_pool_num--;
+	} else {
+		q = dma_alloc(ETH_Q_HDR_SIZE + PKTSIZE);
+		if (!q)
+			return NULL;
+	}
 
-	q->data = dma_alloc(length);
-	if (!q->data) {
-		free(q);
-		return -ENOMEM;
+	return eth_q_data(q);
+}
+
+/**
+ * eth_tx_buf_put - return a buffer obtained with eth_tx_buf_get()
+ * @edev: the device to return the buffer to
+ * @buf: the buffer
+ */
+void eth_tx_buf_put(struct eth_device *edev, void *buf)
+{
+	struct eth_q *q;
+
+	if (!buf)
+		return;
+
+	q = eth_q_from_data(buf);
+
+	if (edev->tx_pool_num < ETH_TX_POOL_SIZE) {
+		list_add(&q->list, &edev->tx_pool);
+		edev->tx_pool_num++;
+		return;
 	}
 
-	q->length = length;
-	q->edev = edev;
+	dma_free(q);
+}
 
-	memcpy(q->data, packet, length);
-	list_add_tail(&q->list, &edev->send_queue);
+/**
+ * eth_send_tx_buf - send a buffer obtained with eth_tx_buf_get()
+ * @edev: the device to send the packet on
+ * @buf: the packet
+ * @length: length of the packet
+ *
+ * The buffer is owned by the network layer afterwards. When the device
+ * is busy, the buffer itself is queued, so the packet is not copied.
+ *
+ * Return: 0 for success or a negative error code
+ */
+int eth_send_tx_buf(struct eth_device *edev, void *buf, int length)
+{
+	struct eth_q *q = eth_q_from_data(buf);
+	int ret;
 
-	return 0;
+	if (!edev->active) {
+		eth_tx_buf_put(edev, buf);
+		return -ENETDOWN;
+	}
+
+	if (slice_acquired(eth_device_slice(edev))) {
+		q->length = length;
+		list_add_tail(&q->list, &edev->send_queue);
+		return 0;
+	}
+
+	ret = eth_send(edev, buf, length);
+
+	eth_tx_buf_put(edev, buf);
+
+	return ret;
+}
+
+static int eth_queue(struct eth_device *edev, void *packet, int length)
+{
+	void *buf;
+
+	if (length > PKTSIZE)
+		return -EINVAL;
+
+	buf = eth_tx_buf_get(edev);
+	if (!buf)
+		return -ENOMEM;
+
+	memcpy(buf, packet, length);
+
+	return eth_send_tx_buf(edev, buf, length);
 }
 
 int eth_send(struct eth_device *edev, void *packet, int length)
@@ -292,10 +383,9 @@ static void eth_do_work(struct eth_device *edev)
 
 	list_for_each_entry_safe(q, tmp, &edev->send_queue, list) {
 		led_trigger_network(LED_TRIGGER_NET_TX);
-		eth_send_raw(edev, q->data, q->length);
+		eth_send_raw(edev, eth_q_data(q), q->length);
 		list_del(&q->list);
-		free(q->data);
-		free(q);
+		eth_tx_buf_put(edev, eth_q_data(q));
 	}
 
 	slice_release(eth_device_slice(edev));
@@ -421,6 +511,7 @@ int eth_register(struct eth_device *edev)
 	}
 
 	INIT_LIST_HEAD(&edev->send_queue);
+	INIT_LIST_HEAD(&edev->tx_pool);
 
 	ret = register_device(&edev->dev);
 	if (ret)
@@ -503,12 +594,13 @@ void eth_unregister(struct eth_device *edev)
 		edev->halt(edev);
 
 	list_for_each_entry_safe(q, tmp, &edev->send_queue, list) {
-		if (q->edev != edev)
-			continue;
+		list_del(&q->list);
+		dma_free(q);
+	}
 
+	list_for_each_entry_safe(q, tmp, &edev->tx_pool, list) {
 		list_del(&q->list);
-		free(q->data);
-		free(q);
+		dma_free(q);
 	}
 
 	if (IS_ENABLED(CONFIG_OFDEVICE))
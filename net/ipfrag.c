@@ -0,0 +1,187 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * ipfrag.c - reassembly of fragmented IPv4 datagrams
+ *
+ * Datagrams larger than the MTU are split into fragments by the sender.
+ * This collects the fragments of a bounded number of datagrams and hands
+ * the complete datagram to the protocol handlers as if it had arrived in
+ * a single ethernet frame.
+ */
+
+#define pr_fmt(fmt) "ipfrag: " fmt
+
+#include <common.h>
+#include <clock.h>
+#include <net.h>
+#include <malloc.h>
+#include <linux/bitmap.h>
+
+#define IPFRAG_SLOTS		8
+#define IPFRAG_TIMEOUT		(2 * SECOND)
+#define IPFRAG_MAX_PAYLOAD	(0xffff - sizeof(struct iphdr))
+
+#define IP_MF			0x2000
+#define IP_OFFSET		0x1fff
+
+/* fragment offsets are in units of 8 bytes */
+#define IPFRAG_UNITS		DIV_ROUND_UP(IPFRAG_MAX_PAYLOAD, 8)
+
+struct ipfrag {
+	uint32_t saddr;
+	uint16_t id;
+	uint8_t protocol;
+	bool in_use;
+	bool have_header;
+	int total;		/* payload length, -1 until the last fragment arrived */
+	int received;		/* number of 8 byte units received */
+	uint64_t start;
+	unsigned char *buf;	/* ethernet header + IP header + payload */
+	DECLARE_BITMAP(units, IPFRAG_UNITS);
+};
+
+static struct ipfrag ipfrags[IPFRAG_SLOTS];
+
+static void ipfrag_release(struct ipfrag *frag)
+{
+	free(frag->buf);
+	frag->buf = NULL;
+	frag->in_use = false;
+}
+
+static struct ipfrag *ipfrag_find(struct iphdr *ip)
+{
+	struct ipfrag *frag, *oldest = NULL;
+	int i;
+
+	for (i = 0; i < IPFRAG_SLOTS; i++) {
+		frag = &ipfrags[i];
+
+		if (frag->in_use && is_timeout(frag->start, IPFRAG_TIMEOUT)) {
+			pr_debug("dropping incomplete datagram 0x%04x\n",
+				 ntohs(frag->id));
+			ipfrag_release(frag);
+		}
+
+		if (frag->in_use && frag->id == ip->id &&
+		    frag->protocol == ip->protocol &&
+		    frag->saddr == net_read_ip(&ip->saddr))
+			return frag;
+	}
+
+	for (i = 0; i < IPFRAG_SLOTS; i++) {
+		frag = &ipfrags[i];
+
+		if (!frag->in_use)
+			goto found;
+
+		if (!oldest || frag->start < oldest->start)
+			oldest = frag;
+	}
+
+	/* all slots busy, sacrifice the oldest datagram */
+	frag = oldest;
+	ipfrag_release(frag);
+
+found:
+	frag->buf = malloc(ETHER_HDR_SIZE + sizeof(struct iphdr) +
+			   IPFRAG_MAX_PAYLOAD);
+	if (!frag->buf)
+		return NULL;
+
+	frag->saddr = net_read_ip(&ip->saddr);
+	frag->id = ip->id;
+	frag->protocol = ip->protocol;
+	frag->in_use = true;
+	frag->have_header = false;
+	frag->total = -1;
+	frag->received = 0;
+	frag->start = get_time_ns();
+	bitmap_zero(frag->units, IPFRAG_UNITS);
+
+	return frag;
+}
+
+/**
+ * net_ip_reassemble - feed a fragment into the reassembly buffers
+ * @pkt: ethernet frame containing an IP fragment
+ * @len: pointer to the length of the frame
+ *
+ * Return: NULL when the datagram is not complete yet, otherwise the
+ * complete datagram as ethernet frame with @len updated accordingly.
+ * The buffer stays valid until net_ip_reassemble_done() is called.
+ */
+unsigned char *net_ip_reassemble(unsigned char *pkt, int *len)
+{
+	struct iphdr *ip = (struct iphdr *)(pkt + ETHER_HDR_SIZE);
+	struct ipfrag *frag;
+	unsigned char *hdr;
+	int frag_off = ntohs(ip->frag_off);
+	int offset = (frag_off & IP_OFFSET) * 8;
+	int datalen = ntohs(ip->tot_len) - sizeof(struct iphdr);
+	int first, last, i;
+
+	/* IP options are not supported by the rest of the stack either */
+	if (ip->hl_v != 0x45)
+		return NULL;
+
+	if (datalen <= 0 || offset + datalen > IPFRAG_MAX_PAYLOAD)
+		return NULL;
+
+	/* all fragments but the last must be a multiple of 8 bytes */
+	if ((frag_off & IP_MF) && (datalen & 7))
+		return NULL;
+
+	frag = ipfrag_find(ip);
+	if (!frag)
+		return NULL;
+
+	if (!(frag_off & IP_MF)) {
+		if (frag->total >= 0 && frag->total != offset + datalen)
+			goto drop;
+		frag->total = offset + datalen;
+	}
+
+	hdr = frag->buf;
+	memcpy(hdr + ETHER_HDR_SIZE + sizeof(struct iphdr) + offset,
+	       ip + 1, datalen);
+
+	if (!offset) {
+		memcpy(hdr, pkt, ETHER_HDR_SIZE + sizeof(struct iphdr));
+		frag->have_header = true;
+	}
+
+	first = offset / 8;
+	last = DIV_ROUND_UP(offset + datalen, 8);
+	for (i = first; i < last; i++)
+		if (!__test_and_set_bit(i, frag->units))
+			frag->received++;
+
+	if (!frag->have_header || frag->total < 0 ||
+	    frag->received != DIV_ROUND_UP(frag->total, 8))
+		return NULL;
+
+	ip = (struct iphdr *)(hdr + ETHER_HDR_SIZE);
+	ip->tot_len = htons(sizeof(struct iphdr) + frag->total);
+	ip->frag_off = 0;
+	ip->check = 0;
+	ip->check = ~net_checksum((unsigned char *)ip, sizeof(struct iphdr));
+
+	*len = ETHER_HDR_SIZE + sizeof(struct iphdr) + frag->total;
+
+	return hdr;
+drop:
+	ipfrag_release(frag);
+	return NULL;
+}
+
+void net_ip_reassemble_done(unsigned char *pkt)
+{
+	int i;
+
+	for (i = 0; i < IPFRAG_SLOTS; i++) {
+		if (ipfrags[i].in_use && ipfrags[i].buf == pkt) {
+			ipfrag_release(&ipfrags[i]);
+			return;
+		}
+	}
+}
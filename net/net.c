@@ -365,10 +365,20 @@ IPaddr_t net_get_gateway(void)
 
 static LIST_HEAD(connection_list);
 
+static void net_con_set_packet(struct net_connection *con, unsigned char *packet)
+{
+	con->packet = packet;
+	con->et = (struct ethernet *)con->packet;
+	con->ip = (struct iphdr *)(con->packet + ETHER_HDR_SIZE);
+	con->udp = (struct udphdr *)(con->packet + ETHER_HDR_SIZE + sizeof(struct iphdr));
+	con->icmp = (struct icmphdr *)(con->packet + ETHER_HDR_SIZE + sizeof(struct iphdr));
+}
+
 static struct net_connection *net_new(struct eth_device *edev, IPaddr_t dest,
 				      rx_handler_f *handler, void *ctx)
 {
 	struct net_connection *con;
+	unsigned char *packet;
 	int ret;
 
 	if (!edev) {
@@ -392,15 +402,17 @@ static struct net_connection *net_new(struct eth_device *edev, IPaddr_t dest,
 		return ERR_PTR(-ENETDOWN);
 
 	con = xzalloc(sizeof(*con));
-	con->packet = net_alloc_packet();
 	con->priv = ctx;
 	con->edev = edev;
-	memset(con->packet, 0, PKTSIZE);
 
-	con->et = (struct ethernet *)con->packet;
-	con->ip = (struct iphdr *)(con->packet + ETHER_HDR_SIZE);
-	con->udp = (struct udphdr *)(con->packet + ETHER_HDR_SIZE + sizeof(struct iphdr));
-	con->icmp = (struct icmphdr *)(con->packet + ETHER_HDR_SIZE + sizeof(struct iphdr));
+	packet = eth_tx_buf_get(edev);
+	if (!packet) {
+		free(con);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	memset(packet, 0, PKTSIZE);
+	net_con_set_packet(con, packet);
 	con->handler = handler;
 
 	if (dest == IP_BROADCAST) {
@@ -425,7 +437,7 @@ static struct net_connection *net_new(struct eth_device *edev, IPaddr_t dest,
 
 	return con;
 out:
-	free(con->packet);
+	eth_tx_buf_put(edev, con->packet);
 	free(con);
 	return ERR_PTR(ret);
 }
@@ -470,18 +482,41 @@ struct net_connection *net_icmp_new(IPaddr_t dest, rx_handler_f *handler,
 void net_unregister(struct net_connection *con)
 {
 	list_del(&con->list);
-	free(con->packet);
+	eth_tx_buf_put(con->edev, con->packet);
 	free(con);
 }
 
 static int net_ip_send(struct net_connection *con, int len)
 {
+	struct eth_device *edev = con->edev;
+	unsigned char *packet, *newpacket;
+
 	con->ip->tot_len = htons(sizeof(struct iphdr) + len);
 	con->ip->id = htons(net_ip_id++);
 	con->ip->check = 0;
 	con->ip->check = ~net_checksum((unsigned char *)con->ip, sizeof(struct iphdr));
 
-	return eth_send(con->edev, con->packet, ETHER_HDR_SIZE + sizeof(struct iphdr) + len);
+	len += ETHER_HDR_SIZE + sizeof(struct iphdr);
+
+	if (!slice_acquired(eth_device_slice(edev)))
+		return eth_send(edev, con->packet, len);
+
+	/*
+	 * The device is busy, e.g. because we are called from a receive
+	 * handler, so the packet has to be queued. Queue the buffer itself
+	 * and continue with a copy of it, so that protocols which only update
+	 * parts of their payload between sends keep working.
+	 */
+	newpacket = eth_tx_buf_get(edev);
+	if (!newpacket)
+		return eth_send(edev, con->packet, len);
+
+	memcpy(newpacket, con->packet, PKTSIZE);
+
+	packet = con->packet;
+	net_con_set_packet(con, newpacket);
+
+	return eth_send_tx_buf(edev, packet, len);
 }
 
 int net_udp_send(struct net_connection *con, int len)
@@ -613,6 +648,10 @@ static int ping_reply(struct eth_device *edev, unsigned char *pkt, int len)
 	unsigned char *packet;
 	int ret;
 
+	/* reassembled echo requests do not fit into a single reply */
+	if (ETHER_HDR_SIZE + len > PKTSIZE)
+		return 0;
+
 	memcpy(et->et_dest, et->et_src, 6);
 	memcpy(et->et_src, edev->ethaddr, 6);
 	et->et_protlen = htons(PROT_IP);
@@ -662,10 +701,25 @@ static int net_handle_icmp(struct eth_device *edev, unsigned char *pkt, int len)
 	return 0;
 }
 
+static int net_handle_ip_proto(struct eth_device *edev, unsigned char *pkt, int len)
+{
+	struct iphdr *ip = (struct iphdr *)(pkt + ETHER_HDR_SIZE);
+
+	switch (ip->protocol) {
+	case IPPROTO_ICMP:
+		return net_handle_icmp(edev, pkt, len);
+	case IPPROTO_UDP:
+		return net_handle_udp(pkt, len);
+	}
+
+	return 0;
+}
+
 static int net_handle_ip(struct eth_device *edev, unsigned char *pkt, int len)
 {
 	struct iphdr *ip = (struct iphdr *)(pkt + ETHER_HDR_SIZE);
 	IPaddr_t tmp;
+	int ret;
 
 	pr_debug("%s\n", __func__);
 
@@ -678,7 +732,8 @@ static int net_handle_ip(struct eth_device *edev, unsigned char *pkt, int len)
 	if ((ip->hl_v & 0xf0) != 0x40)
 		goto bad;
 
-	if (ip->frag_off & htons(0x1fff)) /* Can't deal w/ fragments */
+	if (!IS_ENABLED(CONFIG_NET_IP_REASSEMBLY) &&
+	    ip->frag_off & htons(0x1fff)) /* Can't deal w/ fragments */
 		goto bad;
 	if (!net_checksum_ok((unsigned char *)ip, sizeof(struct iphdr)))
 		goto bad;
@@ -687,14 +742,19 @@ static int net_handle_ip(struct eth_device *edev, unsigned char *pkt, int len)
 	if (edev->ipaddr && tmp != edev->ipaddr && tmp != IP_BROADCAST)
 		return 0;
 
-	switch (ip->protocol) {
-	case IPPROTO_ICMP:
-		return net_handle_icmp(edev, pkt, len);
-	case IPPROTO_UDP:
-		return net_handle_udp(pkt, len);
+	if (IS_ENABLED(CONFIG_NET_IP_REASSEMBLY) &&
+	    ip->frag_off & htons(0x3fff)) {
+		pkt = net_ip_reassemble(pkt, &len);
+		if (!pkt)
+			return 0;
+
+		ret = net_handle_ip_proto(edev, pkt, len);
+		net_ip_reassemble_done(pkt);
+
+		return ret;
 	}
 
-	return 0;
+	return net_handle_ip_proto(edev, pkt, len);
 bad:
 	net_bad_packet(pkt, len);
 	return 0;
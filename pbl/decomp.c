@@ -31,6 +31,10 @@
 #include "../../../lib/decompress_unxz.c"
 #endif
 
+#ifdef CONFIG_IMAGE_COMPRESSION_ZSTD
+#include "../../../lib/decompress_unzstd.c"
+#endif
+
 #ifdef CONFIG_IMAGE_COMPRESSION_NONE
 STATIC int decompress(u8 *input, int in_len,
 				int (*fill) (void *, unsigned int),
@@ -94,6 +98,10 @@ void pbl_barebox_uncompress(void *dest, void *compressed_start, unsigned int len
 	uint32_t pbl_hash_len;
 	void *pbl_hash_start, *pbl_hash_end;
 
+	/*
+	 * The decompressors are not hardened against malicious input, so the
+	 * image must be verified before any of it is decompressed.
+	 */
 	if (IS_ENABLED(CONFIG_PBL_VERIFY_PIGGY)) {
 		pbl_hash_start = sha_sum;
 		pbl_hash_end = sha_sum_end;
@@ -0,0 +1,25 @@
+import pytest
+from .helper import *
+
+
+def test_virtio_blk_throughput(barebox, barebox_config):
+    skip_disabled(barebox_config, "CONFIG_VIRTIO_BLK", "CONFIG_CMD_BLKBENCH",
+                  "CONFIG_CMD_DEVLOOKUP")
+
+    _, _, returncode = barebox.run('test -e /dev/virtioblk0')
+    if returncode != 0:
+        pytest.skip("no virtio block device attached")
+
+    before = int(barebox.run_check('devlookup /dev/virtioblk0 read_bytes')[0])
+
+    out = barebox.run_check('blkbench -s 16M /dev/virtioblk0')
+    assert 'KiB/s' in out[-1]
+    print(out[-1])
+
+    after = int(barebox.run_check('devlookup /dev/virtioblk0 read_bytes')[0])
+    assert after - before >= 16 * 1024 * 1024
+
+    requests = int(barebox.run_check('devlookup /dev/virtioblk0 requests')[0])
+    read_ns = int(barebox.run_check('devlookup /dev/virtioblk0 read_ns')[0])
+    print("virtio-blk: {} requests, {} bytes read in {} ns".format(
+        requests, after, read_ns))
@@ -5,6 +5,7 @@
 #include <common.h>
 #include <bselftest.h>
 #include <clock.h>
+#include <crc.h>
 #include <digest.h>
 
 BSELFTEST_GLOBALS();
@@ -43,6 +44,19 @@ static inline const char *digest_suffix(const char *str, const char *suffix)
 	return buf;
 }
 
+/* some accelerated variants are only registered if the CPU supports them */
+static bool digest_registered(const char *algo)
+{
+	struct digest *d = digest_alloc(algo);
+
+	if (!d)
+		return false;
+
+	digest_free(d);
+
+	return true;
+}
+
 static void __test_digest(bool option,
 			  const char *algo, struct digest_test_case *t,
 			  const char *func, int line)
@@ -131,6 +145,8 @@ static void test_digests_sha12(const char *suffix)
 
 	cond = !strcmp(suffix, "generic") ? IS_ENABLED(CONFIG_DIGEST_SHA1_GENERIC) :
 	       !strcmp(suffix, "asm") ? IS_ENABLED(CONFIG_DIGEST_SHA1_ARM) :
+	       !strcmp(suffix, "ce")  ? IS_ENABLED(CONFIG_DIGEST_SHA1_ARM64_CE) :
+	       !strcmp(suffix, "ni")  ? false :
 	       IS_ENABLED(CONFIG_HAVE_DIGEST_SHA1);
 
 	test_digest(cond, digest_suffix("sha1", suffix),
@@ -142,6 +158,8 @@ static void test_digests_sha12(const char *suffix)
 	cond = !strcmp(suffix, "generic") ? IS_ENABLED(CONFIG_DIGEST_SHA224_GENERIC) :
 	       !strcmp(suffix, "asm") ? IS_ENABLED(CONFIG_DIGEST_SHA256_ARM) :
 	       !strcmp(suffix, "ce")  ? IS_ENABLED(CONFIG_DIGEST_SHA256_ARM64_CE) :
+	       !strcmp(suffix, "ni")  ? IS_ENABLED(CONFIG_DIGEST_SHA256_X86_SHA_NI) &&
+					digest_registered("sha224-ni") :
 	       IS_ENABLED(CONFIG_HAVE_DIGEST_SHA224);
 
 	test_digest(cond, digest_suffix("sha224", suffix),
@@ -153,6 +171,8 @@ static void test_digests_sha12(const char *suffix)
 	cond = !strcmp(suffix, "generic") ? IS_ENABLED(CONFIG_DIGEST_SHA256_GENERIC) :
 	       !strcmp(suffix, "asm") ? IS_ENABLED(CONFIG_DIGEST_SHA256_ARM) :
 	       !strcmp(suffix, "ce")  ? IS_ENABLED(CONFIG_DIGEST_SHA256_ARM64_CE) :
+	       !strcmp(suffix, "ni")  ? IS_ENABLED(CONFIG_DIGEST_SHA256_X86_SHA_NI) &&
+					digest_registered("sha256-ni") :
 	       IS_ENABLED(CONFIG_HAVE_DIGEST_SHA256);
 
 	test_digest(cond, digest_suffix("sha256", suffix),
@@ -167,6 +187,10 @@ static void test_digests_sha35(const char *suffix)
 	bool cond;
 
 	cond = !strcmp(suffix, "generic") ? IS_ENABLED(CONFIG_DIGEST_SHA384_GENERIC) :
+	       !strcmp(suffix, "ce")   ? IS_ENABLED(CONFIG_DIGEST_SHA512_ARM64_CE) &&
+					 digest_registered("sha384-ce") :
+	       !strcmp(suffix, "avx2") ? IS_ENABLED(CONFIG_DIGEST_SHA512_X86_AVX2) &&
+					 digest_registered("sha384-avx2") :
 	       IS_ENABLED(CONFIG_HAVE_DIGEST_SHA384);
 
 	test_digest(cond, digest_suffix("sha384", suffix),
@@ -179,6 +203,10 @@ static void test_digests_sha35(const char *suffix)
 
 
 	cond = !strcmp(suffix, "generic") ? IS_ENABLED(CONFIG_DIGEST_SHA512_GENERIC) :
+	       !strcmp(suffix, "ce")   ? IS_ENABLED(CONFIG_DIGEST_SHA512_ARM64_CE) &&
+					 digest_registered("sha512-ce") :
+	       !strcmp(suffix, "avx2") ? IS_ENABLED(CONFIG_DIGEST_SHA512_X86_AVX2) &&
+					 digest_registered("sha512-avx2") :
 	       IS_ENABLED(CONFIG_HAVE_DIGEST_SHA512);
 
 	test_digest(cond, digest_suffix("sha512", suffix),
@@ -190,6 +218,49 @@ static void test_digests_sha35(const char *suffix)
 				   "60a5a68aa0017e3446433349b42592b74713d7787628a58e400b7f588b9bd69b"));
 }
 
+static void test_crc32(void)
+{
+	static const unsigned int lens[] = {
+		0, 1, 2, 3, 4, 7, 8, 9, 15, 16, 17, 63, 64, 65, 1000, 4081
+	};
+	unsigned int ofs, i;
+	u32 arch, generic;
+
+	if (!IS_ENABLED(CONFIG_CRC32))
+		return;
+
+	total_tests++;
+	if (crc32(0, "123456789", 9) != 0xcbf43926) {
+		printf("%s: crc32 of check string wrong\n", __func__);
+		failed_tests++;
+	}
+
+	total_tests++;
+	if (crc32(0, inc4097, sizeof(inc4097)) != 0xd1169ca1) {
+		printf("%s: crc32 of inc4097 wrong\n", __func__);
+		failed_tests++;
+	}
+
+	if (!IS_ENABLED(CONFIG_CRC32_ARCH))
+		return;
+
+	/* every alignment of the start, with lengths around the block sizes */
+	for (ofs = 0; ofs < 16; ofs++) {
+		total_tests++;
+
+		for (i = 0; i < ARRAY_SIZE(lens); i++) {
+			arch = crc32_le_arch(~0, inc4097 + ofs, lens[i]);
+			generic = crc32_le_generic(~0, inc4097 + ofs, lens[i]);
+			if (arch != generic) {
+				printf("%s: crc32 of %u bytes at offset %u: got 0x%08x, but 0x%08x expected\n",
+				       __func__, lens[i], ofs, arch, generic);
+				failed_tests++;
+				break;
+			}
+		}
+	}
+}
+
 static void test_digests(void)
 {
 	int i;
@@ -205,9 +276,20 @@ static void test_digests(void)
 
 	test_digests_sha35("generic");
 
+	if (IS_ENABLED(CONFIG_CPU_64)) {
+		test_digests_sha12("ce");
+		test_digests_sha35("ce");
+	}
+
+	if (IS_ENABLED(CONFIG_X86_64)) {
+		test_digests_sha12("ni");
+		test_digests_sha35("avx2");
+	}
+
 	test_digest_md5("");
 	test_digests_sha12("");
 	test_digests_sha35("");
 
+	test_crc32();
 }
 bselftest(core, test_digests);
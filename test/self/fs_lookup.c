@@ -0,0 +1,120 @@
+// SPDX-License-Identifier: GPL-2.0-only
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <common.h>
+#include <clock.h>
+#include <fcntl.h>
+#include <fs.h>
+#include <libfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <bselftest.h>
+#include <linux/math64.h>
+
+BSELFTEST_GLOBALS();
+
+#define LOOKUP_FILES	2000
+#define LOOKUP_ROUNDS	5
+
+static bool __init expect_stat(const char *path, bool exists)
+{
+	struct stat st;
+	int ret;
+
+	total_tests++;
+
+	ret = stat(path, &st);
+	if ((ret == 0) == exists)
+		return true;
+
+	failed_tests++;
+	printf("stat(%s): expected %s, got %pe\n", path,
+	       exists ? "success" : "failure", ERR_PTR(ret));
+
+	return false;
+}
+
+/*
+ * Create a directory with many entries and resolve paths to all of them
+ * repeatedly. This mostly exercises the dentry cache, as every lookup
+ * after the first one is satisfied from there.
+ */
+static void __init test_fs_lookup(void)
+{
+	char path[128];
+	const char *dname;
+	uint64_t start, ns;
+	unsigned int lookups = 0;
+	int i, round, fd, ret;
+
+	dname = make_temp("lookup-test");
+
+	ret = mkdir(dname, 0777);
+	if (ret) {
+		total_tests++;
+		failed_tests++;
+		printf("mkdir(%s): %pe\n", dname, ERR_PTR(ret));
+		return;
+	}
+
+	for (i = 0; i < LOOKUP_FILES; i++) {
+		snprintf(path, sizeof(path), "%s/entry-%04d", dname, i);
+
+		fd = open(path, O_WRONLY | O_CREAT);
+		if (fd < 0) {
+			total_tests++;
+			failed_tests++;
+			printf("creating %s: %pe\n", path, ERR_PTR(fd));
+			goto out;
+		}
+		close(fd);
+	}
+
+	start = get_time_ns();
+
+	for (round = 0; round < LOOKUP_ROUNDS; round++) {
+		for (i = 0; i < LOOKUP_FILES; i++) {
+			snprintf(path, sizeof(path), "%s/entry-%04d", dname, i);
+			if (!expect_stat(path, true))
+				goto out;
+			lookups++;
+		}
+	}
+
+	ns = get_time_ns() - start;
+
+	pr_info("%u lookups in %llu us, %llu ns per lookup\n", lookups,
+		div_u64(ns, 1000), div_u64(ns, lookups));
+
+	/* names that hash alike must still be told apart */
+	snprintf(path, sizeof(path), "%s/entry-%04d", dname, LOOKUP_FILES);
+	expect_stat(path, false);
+	snprintf(path, sizeof(path), "%s/entry-000", dname);
+	expect_stat(path, false);
+	snprintf(path, sizeof(path), "%s/entry-00000", dname);
+	expect_stat(path, false);
+
+	/* removed entries must not be found in the cache anymore */
+	snprintf(path, sizeof(path), "%s/entry-%04d", dname, 42);
+	ret = unlink(path);
+	total_tests++;
+	if (ret) {
+		failed_tests++;
+		printf("unlink(%s): %pe\n", path, ERR_PTR(ret));
+	}
+	expect_stat(path, false);
+
+	/* the same name below another directory is a different entry */
+	snprintf(path, sizeof(path), "%s/entry-0001/entry-0001", dname);
+	expect_stat(path, false);
+
+out:
+	ret = unlink_recursive(dname, NULL);
+	total_tests++;
+	if (ret) {
+		failed_tests++;
+		printf("unlink_recursive(%s): %pe\n", dname, ERR_PTR(ret));
+	}
+}
+bselftest(core, test_fs_lookup);
@@ -0,0 +1,252 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Feeds a small sparse image with all chunk types to the streaming sparse
+ * image parser in pieces of different sizes and compares the result with
+ * the unsparsed image.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <common.h>
+#include <bselftest.h>
+#include <image-sparse.h>
+#include <linux/kernel.h>
+#include <linux/sizes.h>
+
+BSELFTEST_GLOBALS();
+
+#define SPARSE_TEST_BLKSZ	16
+#define SPARSE_TEST_BLOCKS	7
+#define SPARSE_TEST_SIZE	(SPARSE_TEST_BLOCKS * SPARSE_TEST_BLKSZ)
+/* smaller than the chunks, so that they are written in several pieces */
+#define SPARSE_TEST_BUFSIZE	24
+#define SPARSE_TEST_UNWRITTEN	0xaa
+#define SPARSE_TEST_FILL	0x12345678
+
+struct sparse_test_chunk {
+	u16 type;
+	u32 blocks;
+};
+
+/* a file header 4 bytes longer than struct sparse_header, then these */
+static const struct sparse_test_chunk sparse_test_chunks[] = {
+	{ CHUNK_TYPE_RAW, 2 },
+	{ CHUNK_TYPE_FILL, 3 },
+	{ CHUNK_TYPE_DONT_CARE, 1 },
+	{ CHUNK_TYPE_RAW, 1 },
+	{ CHUNK_TYPE_CRC32, 0 },
+};
+
+struct sparse_test_output {
+	u8 data[SPARSE_TEST_SIZE];
+	int ret;	/* returned by every write */
+};
+
+static void *sparse_test_put(void *p, const void *data, size_t len)
+{
+	memcpy(p, data, len);
+
+	return p + len;
+}
+
+/*
+ * Build the sparse image into @image, and the unsparsed image it describes
+ * into @expected. Returns the size of the sparse image.
+ */
+static size_t sparse_test_image(void *image, u8 *expected)
+{
+	struct sparse_header sparse = {
+		.magic = cpu_to_le32(SPARSE_HEADER_MAGIC),
+		.major_version = cpu_to_le16(1),
+		.file_hdr_sz = cpu_to_le16(sizeof(sparse) + 4),
+		.chunk_hdr_sz = cpu_to_le16(sizeof(struct chunk_header)),
+		.blk_sz = cpu_to_le32(SPARSE_TEST_BLKSZ),
+		.total_blks = cpu_to_le32(SPARSE_TEST_BLOCKS),
+		.total_chunks = cpu_to_le32(ARRAY_SIZE(sparse_test_chunks)),
+	};
+	__le32 fill = cpu_to_le32(SPARSE_TEST_FILL), crc = 0, pad = 0;
+	void *p = image;
+	int i, j;
+
+	p = sparse_test_put(p, &sparse, sizeof(sparse));
+	p = sparse_test_put(p, &pad, sizeof(pad));
+
+	memset(expected, SPARSE_TEST_UNWRITTEN, SPARSE_TEST_SIZE);
+
+	for (i = 0; i < ARRAY_SIZE(sparse_test_chunks); i++) {
+		const struct sparse_test_chunk *c = &sparse_test_chunks[i];
+		size_t len = c->blocks * SPARSE_TEST_BLKSZ;
+		struct chunk_header chunk = {
+			.chunk_type = cpu_to_le16(c->type),
+			.chunk_sz = cpu_to_le32(c->blocks),
+			.total_sz = cpu_to_le32(sizeof(chunk)),
+		};
+
+		switch (c->type) {
+		case CHUNK_TYPE_RAW:
+			for (j = 0; j < len; j++)
+				expected[j] = i * 0x40 + j;
+
+			chunk.total_sz = cpu_to_le32(sizeof(chunk) + len);
+			p = sparse_test_put(p, &chunk, sizeof(chunk));
+			p = sparse_test_put(p, expected, len);
+			break;
+		case CHUNK_TYPE_FILL:
+			for (j = 0; j < len; j += sizeof(fill))
+				memcpy(expected + j, &fill, sizeof(fill));
+
+			chunk.total_sz = cpu_to_le32(sizeof(chunk) + sizeof(fill));
+			p = sparse_test_put(p, &chunk, sizeof(chunk));
+			p = sparse_test_put(p, &fill, sizeof(fill));
+			break;
+		case CHUNK_TYPE_DONT_CARE:
+			p = sparse_test_put(p, &chunk, sizeof(chunk));
+			break;
+		case CHUNK_TYPE_CRC32:
+			chunk.total_sz = cpu_to_le32(sizeof(chunk) + sizeof(crc));
+			p = sparse_test_put(p, &chunk, sizeof(chunk));
+			p = sparse_test_put(p, &crc, sizeof(crc));
+			break;
+		}
+
+		expected += len;
+	}
+
+	return p - image;
+}
+
+/* the output range of the chunk containing @pos */
+static bool sparse_test_chunk_range(loff_t pos, loff_t *start, loff_t *end)
+{
+	int i;
+
+	*start = 0;
+
+	for (i = 0; i < ARRAY_SIZE(sparse_test_chunks); i++) {
+		*end = *start + sparse_test_chunks[i].blocks * SPARSE_TEST_BLKSZ;
+		if (pos >= *start && pos < *end)
+			return true;
+		*start = *end;
+	}
+
+	return false;
+}
+
+static int sparse_test_write(void *priv, const void *buf, size_t len,
+			     loff_t pos)
+{
+	struct sparse_test_output *out = priv;
+	loff_t start, end;
+
+	if (out->ret)
+		return out->ret;
+
+	if (!len || len > SPARSE_TEST_BUFSIZE ||
+	    !sparse_test_chunk_range(pos, &start, &end) || pos + len > end) {
+		pr_err("bad write of %zu bytes at %lld\n", len, pos);
+		failed_tests++;
+		return -EINVAL;
+	}
+
+	memcpy(out->data + pos, buf, len);
+
+	return 0;
+}
+
+/* feed @image in pieces of @piece bytes, return the result of the parser */
+static int sparse_test_feed(const void *image, size_t len, size_t piece,
+			    struct sparse_test_output *out, loff_t *size)
+{
+	struct sparse_image_stream *ss;
+	size_t now;
+	int ret = 0;
+
+	memset(out->data, SPARSE_TEST_UNWRITTEN, sizeof(out->data));
+
+	ss = sparse_image_stream_new(SPARSE_TEST_BUFSIZE, sparse_test_write,
+				     out);
+	if (!ss)
+		return -ENOMEM;
+
+	while (len) {
+		now = min(len, piece);
+
+		ret = sparse_image_stream_feed(ss, image, now);
+		if (ret)
+			goto out;
+
+		image += now;
+		len -= now;
+	}
+
+	ret = sparse_image_stream_finish(ss);
+
+	*size = sparse_image_stream_size(ss);
+out:
+	sparse_image_stream_free(ss);
+
+	return ret;
+}
+
+static void test_sparse_stream(void)
+{
+	static const size_t pieces[] = { 1, 2, 3, 5, 12, 13, 64, SIZE_MAX };
+	struct sparse_test_output *out;
+	u8 *image, *expected;
+	size_t len;
+	loff_t size;
+	int i, ret;
+
+	image = xzalloc(SZ_1K);
+	expected = xzalloc(SPARSE_TEST_SIZE);
+	out = xzalloc(sizeof(*out));
+
+	len = sparse_test_image(image, expected);
+
+	for (i = 0; i < ARRAY_SIZE(pieces); i++) {
+		total_tests++;
+
+		ret = sparse_test_feed(image, len, pieces[i], out, &size);
+		if (ret) {
+			pr_err("pieces of %zu bytes: %pe\n", pieces[i],
+			       ERR_PTR(ret));
+			failed_tests++;
+		} else if (size != SPARSE_TEST_SIZE ||
+			   memcmp(out->data, expected, SPARSE_TEST_SIZE)) {
+			pr_err("pieces of %zu bytes: wrong output\n", pieces[i]);
+			failed_tests++;
+		}
+	}
+
+	/* a truncated image is only noticed when finishing */
+	total_tests++;
+	ret = sparse_test_feed(image, len - 1, 7, out, &size);
+	if (ret != -EINVAL) {
+		pr_err("truncated image not detected: %pe\n", ERR_PTR(ret));
+		failed_tests++;
+	}
+
+	/* errors of the write callback are passed on */
+	total_tests++;
+	out->ret = -EIO;
+	ret = sparse_test_feed(image, len, 7, out, &size);
+	if (ret != -EIO) {
+		pr_err("write error not passed on: %pe\n", ERR_PTR(ret));
+		failed_tests++;
+	}
+	out->ret = 0;
+
+	/* anything else than a sparse image is rejected */
+	total_tests++;
+	image[0] ^= 1;
+	ret = sparse_test_feed(image, len, 7, out, &size);
+	if (ret != -EINVAL) {
+		pr_err("bad magic not rejected: %pe\n", ERR_PTR(ret));
+		failed_tests++;
+	}
+
+	free(out);
+	free(expected);
+	free(image);
+}
+bselftest(core, test_sparse_stream);
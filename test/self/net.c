@@ -0,0 +1,161 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Sends UDP packets from the receive path of a dummy network device, where
+ * they have to be queued, and checks what the device finally transmits.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <common.h>
+#include <bselftest.h>
+#include <net.h>
+#include <linux/kernel.h>
+
+BSELFTEST_GLOBALS();
+
+#define NET_TEST_PORT		4711
+#define NET_TEST_LEN		32
+#define NET_TEST_PACKETS	2
+
+struct net_test {
+	struct eth_device edev;
+	struct net_connection *con;
+	u8 sent[NET_TEST_PACKETS][NET_TEST_LEN];
+	int nsent;
+	int ret;
+};
+
+static int net_test_open(struct eth_device *edev)
+{
+	return 0;
+}
+
+static void net_test_halt(struct eth_device *edev)
+{
+}
+
+static int net_test_get_ethaddr(struct eth_device *edev, u8 adr[6])
+{
+	return -ENODEV;
+}
+
+static int net_test_set_ethaddr(struct eth_device *edev,
+				const unsigned char *adr)
+{
+	return 0;
+}
+
+static int net_test_send(struct eth_device *edev, void *packet, int length)
+{
+	struct net_test *nt = container_of(edev, struct net_test, edev);
+	int hdr = ETHER_HDR_SIZE + sizeof(struct iphdr) + sizeof(struct udphdr);
+
+	if (nt->nsent < NET_TEST_PACKETS && length == hdr + NET_TEST_LEN)
+		memcpy(nt->sent[nt->nsent], packet + hdr, NET_TEST_LEN);
+
+	nt->nsent++;
+
+	return 0;
+}
+
+/*
+ * Called with the device slice held, like the receive handlers of the
+ * protocols that reply from there. The payload is filled only once.
+ */
+static int net_test_recv(struct eth_device *edev)
+{
+	struct net_test *nt = container_of(edev, struct net_test, edev);
+	u8 *payload;
+	int i, ret;
+
+	if (!nt->con || nt->nsent)
+		return 0;
+
+	payload = net_udp_get_payload(nt->con);
+
+	for (i = 0; i < NET_TEST_LEN; i++)
+		payload[i] = i + 1;
+
+	for (i = 0; i < NET_TEST_PACKETS; i++) {
+		ret = net_udp_send(nt->con, NET_TEST_LEN);
+		if (ret)
+			nt->ret = ret;
+	}
+
+	return 0;
+}
+
+static void net_test_handler(void *ctx, char *packet, unsigned len)
+{
+}
+
+static void test_net_queue(void)
+{
+	struct net_test *nt;
+	u8 expected[NET_TEST_LEN];
+	int i, ret;
+
+	total_tests++;
+
+	nt = xzalloc(sizeof(*nt));
+	nt->edev.open = net_test_open;
+	nt->edev.send = net_test_send;
+	nt->edev.recv = net_test_recv;
+	nt->edev.halt = net_test_halt;
+	nt->edev.get_ethaddr = net_test_get_ethaddr;
+	nt->edev.set_ethaddr = net_test_set_ethaddr;
+
+	ret = eth_register(&nt->edev);
+	if (ret) {
+		pr_err("registering network device failed: %pe\n",
+		       ERR_PTR(ret));
+		failed_tests++;
+		goto out;
+	}
+
+	ret = eth_open(&nt->edev);
+	if (ret) {
+		pr_err("opening network device failed: %pe\n", ERR_PTR(ret));
+		failed_tests++;
+		goto unregister;
+	}
+
+	nt->con = net_udp_eth_new(&nt->edev, IP_BROADCAST, NET_TEST_PORT,
+				  net_test_handler, NULL);
+	if (IS_ERR(nt->con)) {
+		pr_err("creating connection failed: %pe\n", nt->con);
+		nt->con = NULL;
+		failed_tests++;
+		goto close;
+	}
+
+	eth_rx();
+
+	for (i = 0; i < NET_TEST_LEN; i++)
+		expected[i] = i + 1;
+
+	if (nt->ret || nt->nsent != NET_TEST_PACKETS) {
+		pr_err("sent %d of %d packets: %pe\n", nt->nsent,
+		       NET_TEST_PACKETS, ERR_PTR(nt->ret));
+		failed_tests++;
+		goto unregister_con;
+	}
+
+	for (i = 0; i < NET_TEST_PACKETS; i++) {
+		total_tests++;
+		if (memcmp(nt->sent[i], expected, NET_TEST_LEN)) {
+			pr_err("payload of queued packet %d differs\n", i);
+			failed_tests++;
+		}
+	}
+
+unregister_con:
+	net_unregister(nt->con);
+close:
+	eth_close(&nt->edev);
+unregister:
+	eth_unregister(&nt->edev);
+out:
+	free(nt);
+}
+bselftest(core, test_net_queue);
@@ -110,6 +110,67 @@ static void test_of_property_strings(struct device_node *root)
 	assert_equal(np3, np4);
 }
 
+static void expect_phandle(struct device_node *root, phandle p,
+			   struct device_node *expected)
+{
+	struct device_node *np;
+
+	total_tests++;
+
+	np = of_find_node_by_phandle_from(p, root);
+	if (np == expected)
+		return;
+
+	pr_warn("phandle 0x%x resolved to %s, expected %s\n", p,
+		np ? np->full_name : "none",
+		expected ? expected->full_name : "none");
+	failed_tests++;
+}
+
+static void test_of_phandles(void)
+{
+	struct device_node *root = of_new_node(NULL, NULL);
+	struct device_node *nodes[200], *copy, *np;
+	phandle p;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(nodes); i++) {
+		char name[16];
+
+		snprintf(name, sizeof(name), "node%d", i);
+		nodes[i] = of_new_node(root, name);
+
+		/* the first lookup builds the cache, the rest must update it */
+		p = of_node_create_phandle(nodes[i]);
+		expect_phandle(root, p, nodes[i]);
+	}
+
+	for (i = 0; i < ARRAY_SIZE(nodes); i++)
+		expect_phandle(root, nodes[i]->phandle, nodes[i]);
+
+	total_tests++;
+	if (of_get_tree_max_phandle(root) != ARRAY_SIZE(nodes)) {
+		pr_warn("unexpected max phandle 0x%x\n",
+			of_get_tree_max_phandle(root));
+		failed_tests++;
+	}
+
+	expect_phandle(root, ARRAY_SIZE(nodes) + 1, NULL);
+
+	p = nodes[10]->phandle;
+	of_delete_node(nodes[10]);
+	expect_phandle(root, p, NULL);
+	expect_phandle(root, nodes[11]->phandle, nodes[11]);
+
+	copy = of_dup(root);
+	np = of_find_node_by_name_address(copy, "node42");
+	expect_phandle(copy, nodes[42]->phandle, np);
+	expect_phandle(root, nodes[42]->phandle, nodes[42]);
+
+	of_delete_node(copy);
+	of_delete_node(root);
+}
+
 static void __init test_of_manipulation(void)
 {
 	extern char __dtb_of_manipulation_start[], __dtb_of_manipulation_end[];
@@ -126,5 +187,7 @@ static void __init test_of_manipulation(void)
 
 	of_delete_node(root);
 	of_delete_node(expected);
+
+	test_of_phandles();
 }
 bselftest(core, test_of_manipulation);
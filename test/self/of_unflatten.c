@@ -0,0 +1,273 @@
+// SPDX-License-Identifier: GPL-2.0-only
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <common.h>
+#include <clock.h>
+#include <malloc.h>
+#include <of.h>
+#include <bselftest.h>
+#include <linux/math64.h>
+
+BSELFTEST_GLOBALS();
+
+#define UNFLATTEN_ROUNDS	10
+
+struct unflatten_times {
+	u64 unflatten, fixup, flatten;
+};
+
+/*
+ * Do what bootm does with a device tree: unflatten it, apply the fixups
+ * and flatten it again.
+ */
+static void __init unflatten_round(const struct fdt_header *fdt, bool inplace,
+				   struct device_node *expected,
+				   struct unflatten_times *t)
+{
+	struct device_node *root;
+	u64 start;
+	void *out;
+	int size = be32_to_cpu(fdt->totalsize);
+
+	start = get_time_ns();
+	if (inplace)
+		root = of_unflatten_dtb_const(fdt, size);
+	else
+		root = of_unflatten_dtb(fdt, size);
+	t->unflatten += get_time_ns() - start;
+
+	total_tests++;
+	if (IS_ERR(root)) {
+		failed_tests++;
+		pr_err("unflatten failed: %pe\n", root);
+		return;
+	}
+
+	if (expected) {
+		total_tests++;
+		if (of_diff(expected, root, -1)) {
+			failed_tests++;
+			pr_err("trees unflattened in place and copied differ\n");
+		}
+	}
+
+	start = get_time_ns();
+	of_fix_tree(root);
+	t->fixup += get_time_ns() - start;
+
+	start = get_time_ns();
+	out = of_flatten_dtb(root);
+	t->flatten += get_time_ns() - start;
+
+	total_tests++;
+	if (!out) {
+		failed_tests++;
+		pr_err("flatten failed\n");
+	}
+
+	free(out);
+	of_delete_node(root);
+}
+
+static void __init report(const char *mode, struct unflatten_times *t)
+{
+	pr_info("%-8s unflatten %6llu us, fixup %6llu us, flatten %6llu us\n",
+		mode, div_u64(t->unflatten, UNFLATTEN_ROUNDS * USECOND),
+		div_u64(t->fixup, UNFLATTEN_ROUNDS * USECOND),
+		div_u64(t->flatten, UNFLATTEN_ROUNDS * USECOND));
+}
+
+/*
+ * Writing to a tree unflattened in place must leave the blob untouched.
+ */
+static void __init test_inplace_writes(const struct fdt_header *fdt)
+{
+	int size = be32_to_cpu(fdt->totalsize);
+	struct device_node *root, *np;
+	struct property *pp;
+	void *orig;
+
+	orig = xmemdup(fdt, size);
+
+	root = of_unflatten_dtb_const(fdt, size);
+	if (IS_ERR(root))
+		goto out;
+
+	for_each_child_of_node(root, np) {
+		list_for_each_entry(pp, &np->properties, list) {
+			if (pp->length < sizeof(u32))
+				continue;
+			of_property_write_u32(np, pp->name, 0xdeadbeef);
+			break;
+		}
+	}
+
+	np = of_get_child_by_name(root, "chosen");
+	if (np) {
+		of_rename_property(np, "bootargs", "bootargs-renamed");
+		of_delete_node(np);
+	}
+
+	of_delete_node(root);
+
+	total_tests++;
+	if (memcmp(orig, fdt, size)) {
+		failed_tests++;
+		pr_err("writing to an in place tree modified the blob\n");
+	}
+out:
+	free(orig);
+}
+
+/*
+ * Modify a few scattered nodes, so that the tree consists of changed nodes
+ * and unchanged subtrees. Returns the number of nodes visited so far.
+ */
+static int __init modify_node(struct device_node *np, int count)
+{
+	struct device_node *child;
+	struct property *pp;
+
+	count++;
+
+	if (count % 3 == 1)
+		of_property_write_u32(np, "barebox,unflatten-test", count);
+
+	if (count % 5 == 2) {
+		pp = list_first_entry_or_null(&np->properties, struct property,
+					      list);
+		if (pp && pp->length >= sizeof(u32))
+			of_property_write_u32(np, pp->name, 0xdeadbeef);
+	}
+
+	for_each_child_of_node(np, child)
+		count = modify_node(child, count);
+
+	return count;
+}
+
+static void __init modify_tree(struct device_node *root)
+{
+	struct device_node *np;
+
+	modify_node(root, 0);
+
+	if (!list_empty(&root->children)) {
+		np = list_last_entry(&root->children, struct device_node,
+				     parent_list);
+		of_delete_node(np);
+	}
+
+	np = of_new_node(root, "barebox-unflatten-test");
+	if (np)
+		of_property_write_string(np, "status", "okay");
+}
+
+/*
+ * Flattening a modified tree unflattened in place copies its unchanged
+ * subtrees from the source blob. The result must be the same as flattening
+ * the same modifications of a copied tree, which is done node by node.
+ */
+static void __init test_modified_flatten(const struct fdt_header *fdt)
+{
+	int size = be32_to_cpu(fdt->totalsize);
+	struct device_node *inplace, *copy, *back = NULL, *back_copy = NULL;
+	struct fdt_header *out = NULL, *out_copy = NULL;
+
+	total_tests++;
+
+	inplace = of_unflatten_dtb_const(fdt, size);
+	copy = of_unflatten_dtb(fdt, size);
+	if (IS_ERR(inplace) || IS_ERR(copy)) {
+		failed_tests++;
+		pr_err("unflatten failed\n");
+		goto out;
+	}
+
+	modify_tree(inplace);
+	modify_tree(copy);
+
+	out = of_flatten_dtb(inplace);
+	out_copy = of_flatten_dtb(copy);
+	if (!out || !out_copy) {
+		failed_tests++;
+		pr_err("flatten failed\n");
+		goto out;
+	}
+
+	/* only the strings blocks may differ */
+	if (out->size_dt_struct != out_copy->size_dt_struct) {
+		failed_tests++;
+		pr_err("modified trees flatten to different sizes\n");
+		goto out;
+	}
+
+	back = of_unflatten_dtb(out, be32_to_cpu(out->totalsize));
+	back_copy = of_unflatten_dtb(out_copy,
+				     be32_to_cpu(out_copy->totalsize));
+	if (IS_ERR(back) || IS_ERR(back_copy)) {
+		failed_tests++;
+		pr_err("unflatten of modified tree failed\n");
+		goto out;
+	}
+
+	if (of_diff(copy, back, -1) || of_diff(back_copy, back, -1)) {
+		failed_tests++;
+		pr_err("modified tree unflattened in place flattens wrong\n");
+	}
+out:
+	if (!IS_ERR_OR_NULL(back))
+		of_delete_node(back);
+	if (!IS_ERR_OR_NULL(back_copy))
+		of_delete_node(back_copy);
+	free(out);
+	free(out_copy);
+	if (!IS_ERR(inplace))
+		of_delete_node(inplace);
+	if (!IS_ERR(copy))
+		of_delete_node(copy);
+}
+
+static void __init test_of_unflatten(void)
+{
+	struct unflatten_times copy = {}, inplace = {};
+	struct device_node *live = of_get_root_node(), *expected;
+	struct fdt_header *fdt;
+	int i;
+
+	if (!live) {
+		pr_info("no live device tree, skipping\n");
+		return;
+	}
+
+	fdt = of_flatten_dtb(live);
+	if (!fdt) {
+		total_tests++;
+		failed_tests++;
+		return;
+	}
+
+	pr_info("%u bytes device tree, %d rounds\n",
+		be32_to_cpu(fdt->totalsize), UNFLATTEN_ROUNDS);
+
+	expected = of_unflatten_dtb(fdt, be32_to_cpu(fdt->totalsize));
+	if (IS_ERR(expected))
+		expected = NULL;
+
+	for (i = 0; i < UNFLATTEN_ROUNDS; i++)
+		unflatten_round(fdt, false, NULL, &copy);
+
+	for (i = 0; i < UNFLATTEN_ROUNDS; i++)
+		unflatten_round(fdt, true, i ? NULL : expected, &inplace);
+
+	report("copy", &copy);
+	report("in place", &inplace);
+
+	test_inplace_writes(fdt);
+	test_modified_flatten(fdt);
+
+	of_delete_node(expected);
+	free(fdt);
+}
+bselftest(core, test_of_unflatten);
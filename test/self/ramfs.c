@@ -201,4 +201,120 @@ static void test_ramfs(void)
 	dir = opendir(dname);
 	expect_fail(dir ? 0 : -EISDIR, "opening removed directory");
 }
-bselftest(core, test_ramfs);
+
+#define RAMFS_TEST_PIECE	1000
+#define RAMFS_TEST_SIZE		(SZ_256K + 123)
+#define RAMFS_TEST_APPEND	SZ_64K
+
+/* does @buf contain the test pattern from @pos on? */
+static bool ramfs_test_pattern_ok(const u8 *buf, size_t pos, size_t len)
+{
+	for (; len; buf++, pos++, len--)
+		if (*buf != (u8)(pos * 7 + (pos >> 10)))
+			return false;
+
+	return true;
+}
+
+/*
+ * Grow a file piecewise, memmap it and check that the mapping stays valid
+ * while the file is appended to, truncated and closed.
+ */
+static void test_ramfs_extents(void)
+{
+	const char *fname;
+	u8 *buf, *map = NULL;
+	size_t size, now;
+	int i, fd, ret;
+
+	fname = make_temp("ramfs-extents");
+
+	buf = malloc(RAMFS_TEST_SIZE + RAMFS_TEST_APPEND);
+	if (WARN_ON(!buf))
+		return;
+
+	for (i = 0; i < RAMFS_TEST_SIZE + RAMFS_TEST_APPEND; i++)
+		buf[i] = i * 7 + (i >> 10);
+
+	fd = open(fname, O_WRONLY | O_CREAT | O_TRUNC);
+	if (!expect_success(fd, "creating file"))
+		goto out;
+
+	for (i = 0; i < RAMFS_TEST_SIZE; i += now) {
+		now = min(RAMFS_TEST_SIZE - i, RAMFS_TEST_PIECE);
+
+		ret = write_full(fd, buf + i, now);
+		if (!expect_success(ret, "writing piece at %d", i))
+			break;
+	}
+
+	close(fd);
+
+	fd = open(fname, O_RDONLY);
+	if (!expect_success(fd, "opening file"))
+		goto out;
+
+	map = memmap(fd, PROT_READ);
+	close(fd);
+
+	if (!expect_success(map != MAP_FAILED ? 0 : -errno, "memmap()"))
+		goto out;
+
+	expect_success(ramfs_test_pattern_ok(map, 0, RAMFS_TEST_SIZE) ?
+		       0 : -EINVAL, "memmapped content");
+
+	/* a mapped file grows by adding extents, the mapping stays valid */
+	fd = open(fname, O_WRONLY);
+	if (!expect_success(fd, "opening file for appending"))
+		goto out;
+
+	ret = lseek(fd, RAMFS_TEST_SIZE, SEEK_SET);
+	if (expect_success(ret == RAMFS_TEST_SIZE ? 0 : -EINVAL, "lseek()")) {
+		ret = write_full(fd, buf + RAMFS_TEST_SIZE, RAMFS_TEST_APPEND);
+		expect_success(ret, "appending");
+	}
+
+	close(fd);
+
+	expect_success(ramfs_test_pattern_ok(map, 0, RAMFS_TEST_SIZE) ?
+		       0 : -EINVAL, "memmapped content after appending");
+
+	free(buf);
+	buf = read_file(fname, &size);
+	if (!expect_success(buf ? 0 : -errno, "read_file()"))
+		goto out;
+
+	expect_success(size == RAMFS_TEST_SIZE + RAMFS_TEST_APPEND &&
+		       ramfs_test_pattern_ok(buf, 0, size) ? 0 : -EINVAL,
+		       "content read back over several extents");
+
+	/* the data behind the end of a truncated file reads back as zeroes */
+	fd = open(fname, O_WRONLY);
+	if (!expect_success(fd, "opening file for truncation"))
+		goto out;
+
+	ret = ftruncate(fd, RAMFS_TEST_SIZE / 2);
+	expect_success(ret, "truncating down");
+	ret = ftruncate(fd, RAMFS_TEST_SIZE);
+	expect_success(ret, "truncating up");
+
+	close(fd);
+
+	expect_success(ramfs_test_pattern_ok(map, 0, RAMFS_TEST_SIZE / 2) &&
+		       !memchr_inv(map + RAMFS_TEST_SIZE / 2, 0,
+				   RAMFS_TEST_SIZE - RAMFS_TEST_SIZE / 2) ?
+		       0 : -EINVAL, "memmapped content after truncation");
+
+out:
+	free(buf);
+
+	ret = unlink(fname);
+	expect_success(ret, "unlinking file");
+}
+
+static void test_ramfs_all(void)
+{
+	test_ramfs();
+	test_ramfs_extents();
+}
+bselftest(core, test_ramfs_all);
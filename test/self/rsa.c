@@ -0,0 +1,417 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Verifies RSA signatures made with 2048, 2080 and 4096 bit keys and
+ * reports the time a verification takes. The 2080 bit key does not fill
+ * its last 64 bit limb. The signatures are over "barebox" with
+ * SHA-256 and the public exponent 65537, generated with:
+ *
+ *   openssl genrsa -out key.pem 4096
+ *   echo -n barebox | openssl dgst -sha256 -sign key.pem
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <common.h>
+#include <bselftest.h>
+#include <clock.h>
+#include <of.h>
+#include <rsa.h>
+#include <linux/math64.h>
+
+BSELFTEST_GLOBALS();
+
+#define RSA_VERIFY_ROUNDS	10
+
+static const u8 rsa2048_modulus[] = {
+	0xe9, 0xe4, 0xfc, 0xd7, 0x02, 0x4f, 0x73, 0xa9, 0xfb, 0x96, 0x8d, 0xf5,
+	0x10, 0x1a, 0x9b, 0x7a, 0x0d, 0xd0, 0xdc, 0x46, 0xe8, 0x03, 0x3b, 0x87,
+	0xb4, 0x5c, 0x7f, 0x60, 0x92, 0x5b, 0xb3, 0xa8, 0x62, 0x77, 0x5f, 0x44,
+	0xcc, 0x45, 0x4b, 0x12, 0x9f, 0x72, 0x1e, 0x2d, 0x4a, 0xc1, 0x80, 0x2f,
+	0x58, 0x2a, 0x8e, 0xf8, 0x24, 0xfd, 0xf6, 0x22, 0x97, 0xac, 0xe9, 0x5c,
+	0x30, 0x60, 0x3b, 0xbc, 0xb8, 0x53, 0xb0, 0xbf, 0x2e, 0xfa, 0x87, 0x23,
+	0x28, 0x13, 0x32, 0xac, 0xed, 0xbd, 0x08, 0xa4, 0x53, 0xdb, 0xb2, 0x17,
+	0x84, 0x3c, 0x23, 0x96, 0x66, 0x22, 0x31, 0x5f, 0xb2, 0xc5, 0x16, 0xdf,
+	0x3a, 0x0d, 0x9b, 0xe5, 0xdc, 0x6d, 0x89, 0x4d, 0xa9, 0xeb, 0xb1, 0x4d,
+	0x34, 0xa7, 0xfa, 0x1c, 0x3f, 0x09, 0x06, 0xdb, 0x2c, 0x2f, 0x86, 0x10,
+	0x8f, 0xa3, 0x17, 0x21, 0x9e, 0xd3, 0x9c, 0x58, 0x3c, 0x1e, 0x1b, 0xfc,
+	0x05, 0x56, 0x0c, 0x2c, 0xd5, 0x7d, 0xf9, 0xa2, 0x10, 0x77, 0x3d, 0xb8,
+	0xda, 0x63, 0xab, 0x2d, 0xcd, 0xb8, 0xf3, 0xac, 0x15, 0x91, 0xbf, 0x97,
+	0xa4, 0xb6, 0xb8, 0xa3, 0x11, 0xa7, 0x2b, 0xf1, 0x9a, 0x0a, 0x67, 0x2c,
+	0x11, 0x5f, 0x77, 0x4e, 0x9f, 0x5e, 0x8e, 0x88, 0xa0, 0x6c, 0x37, 0xc1,
+	0xf8, 0xd9, 0x79, 0xda, 0x29, 0x97, 0x5b, 0xc6, 0xc8, 0x7a, 0xad, 0x74,
+	0x96, 0x06, 0x20, 0x62, 0x33, 0xf1, 0xdd, 0xb7, 0x2e, 0x82, 0xf0, 0x96,
+	0xf8, 0xb1, 0x47, 0xe8, 0x6b, 0x11, 0x1f, 0xbd, 0x84, 0x15, 0x51, 0xc4,
+	0x4e, 0x26, 0x22, 0x01, 0x26, 0x22, 0xcf, 0xc5, 0x04, 0xd5, 0x3d, 0x19,
+	0x6f, 0x6f, 0xdc, 0x5c, 0xce, 0x42, 0x93, 0x3c, 0x36, 0x19, 0xd2, 0xdf,
+	0xdd, 0x26, 0x43, 0x22, 0xbd, 0x01, 0xdf, 0x22, 0x78, 0x2e, 0x34, 0xbc,
+	0x32, 0x8d, 0xce, 0xe3,
+};
+
+static const u8 rsa2048_rr[] = {
+	0x8a, 0x3e, 0x45, 0x62, 0xe1, 0x3f, 0x16, 0x35, 0xd6, 0xc3, 0x03, 0x4a,
+	0x6a, 0x92, 0x0e, 0x8e, 0xa2, 0xc8, 0x07, 0xb4, 0x5c, 0x3b, 0x94, 0x2a,
+	0xe6, 0x4f, 0x2b, 0xda, 0xe0, 0xa1, 0x2a, 0x2c, 0x8b, 0xe5, 0x8d, 0x48,
+	0xc5, 0x59, 0xe5, 0x2f, 0x8b, 0x68, 0x9f, 0x21, 0x8f, 0x4b, 0x6b, 0x2e,
+	0x90, 0x61, 0xf1, 0x97, 0x59, 0x88, 0xe8, 0xec, 0x5a, 0x30, 0x33, 0xc3,
+	0xdd, 0xe5, 0xc0, 0x3a, 0x67, 0xc7, 0x33, 0x89, 0x7e, 0xf6, 0x58, 0x9b,
+	0x8a, 0x48, 0xec, 0xff, 0x89, 0xc1, 0x34, 0x03, 0x01, 0x27, 0xfe, 0x7a,
+	0x7d, 0x81, 0x2d, 0xbb, 0x12, 0x91, 0x9f, 0xb5, 0xad, 0x70, 0xa1, 0x7c,
+	0xb2, 0xd8, 0xf6, 0x12, 0xa2, 0x34, 0xae, 0x35, 0xc8, 0x24, 0x7f, 0x09,
+	0x87, 0xca, 0x4a, 0x5d, 0x85, 0x32, 0xd5, 0x20, 0x93, 0x75, 0x87, 0x63,
+	0x2c, 0xe7, 0x3b, 0xcb, 0x58, 0x25, 0xe1, 0x8e, 0x8b, 0x48, 0x85, 0xac,
+	0x0b, 0x1b, 0x22, 0xb1, 0x71, 0x3f, 0x60, 0x98, 0x1d, 0x43, 0x01, 0x6e,
+	0xc7, 0xed, 0x9e, 0x16, 0x9d, 0xef, 0xfc, 0xc9, 0x64, 0xdc, 0xd1, 0x70,
+	0xfe, 0x55, 0xde, 0x7e, 0x86, 0xe7, 0x91, 0xee, 0x3d, 0x3c, 0xfb, 0x83,
+	0x89, 0x88, 0x58, 0x51, 0x0f, 0xdc, 0xb3, 0xf7, 0x18, 0xc8, 0xc2, 0x9f,
+	0xf0, 0x83, 0x39, 0xda, 0x66, 0x40, 0x9f, 0xd9, 0x94, 0x61, 0x47, 0x7f,
+	0x70, 0xa7, 0x45, 0xdf, 0x6a, 0x5f, 0xe6, 0x84, 0x11, 0x30, 0x72, 0x4f,
+	0x96, 0x7c, 0xc7, 0x41, 0xfc, 0xf0, 0x9c, 0x68, 0x57, 0xf1, 0xac, 0xa0,
+	0x84, 0x69, 0x20, 0xc8, 0x19, 0x37, 0x54, 0x88, 0x23, 0x26, 0xed, 0xe2,
+	0xb1, 0x79, 0x9f, 0x5d, 0xbf, 0xe1, 0xf9, 0x55, 0x3c, 0x32, 0x1c, 0x2e,
+	0x02, 0x0c, 0x7b, 0xc4, 0x1f, 0x0b, 0x07, 0x7a, 0x1b, 0x44, 0x86, 0x70,
+	0x56, 0xfe, 0x0e, 0x84,
+};
+
+static const u8 rsa2048_sig[] = {
+	0x42, 0x8d, 0xb4, 0x8d, 0xbc, 0x83, 0xf6, 0xe0, 0xd8, 0x5f, 0x6a, 0xcc,
+	0xc4, 0x89, 0x53, 0x07, 0x84, 0x4c, 0x29, 0x86, 0x5f, 0xfe, 0xc2, 0x37,
+	0x52, 0x01, 0x75, 0x58, 0x97, 0xd3, 0x38, 0x64, 0xe0, 0xba, 0x90, 0x6e,
+	0xf2, 0x62, 0x9e, 0x2d, 0x0f, 0x13, 0x1a, 0xce, 0xe5, 0xc1, 0x17, 0xac,
+	0xea, 0x32, 0x99, 0xa1, 0xf4, 0x5e, 0xe4, 0x97, 0x24, 0x05, 0x48, 0xa9,
+	0x5a, 0xbe, 0x9b, 0x44, 0x5a, 0xbb, 0x81, 0x50, 0x37, 0x23, 0xf6, 0x83,
+	0xbc, 0x92, 0x32, 0x02, 0x85, 0xe4, 0xca, 0x63, 0x7d, 0x8b, 0x9c, 0x47,
+	0x36, 0x45, 0x15, 0x0c, 0xc3, 0x6d, 0x18, 0x2a, 0x92, 0x61, 0x84, 0xd7,
+	0x9e, 0x28, 0x5b, 0x1b, 0x1c, 0xc6, 0x97, 0x16, 0x6f, 0x18, 0xa6, 0x09,
+	0xa3, 0x1c, 0xea, 0x2a, 0xd0, 0x9b, 0xbf, 0x5a, 0x8f, 0x50, 0xb2, 0x1d,
+	0x8c, 0x26, 0x80, 0xc1, 0x22, 0x1b, 0x1e, 0x65, 0xe6, 0x60, 0x34, 0x4b,
+	0x19, 0x31, 0xa1, 0xac, 0xc7, 0xfc, 0xb6, 0x3e, 0x64, 0x25, 0xec, 0x16,
+	0x6c, 0x09, 0xfb, 0x5d, 0x61, 0xb0, 0x1f, 0xdc, 0x36, 0xdb, 0x61, 0x1d,
+	0x92, 0x6c, 0xad, 0x15, 0x6c, 0xf0, 0xd8, 0xa9, 0xd8, 0x54, 0x4d, 0x53,
+	0x55, 0xb2, 0x8e, 0xfc, 0xd1, 0x13, 0x72, 0x58, 0xda, 0x03, 0xaf, 0x55,
+	0x18, 0x9b, 0x70, 0x84, 0x61, 0xdc, 0x85, 0xf5, 0x1f, 0x44, 0x2e, 0x41,
+	0xce, 0xd0, 0x07, 0x8b, 0x26, 0x48, 0x61, 0x20, 0x36, 0x2c, 0xf3, 0x15,
+	0x4b, 0x73, 0x9f, 0xd4, 0x64, 0xab, 0x6c, 0x74, 0xfd, 0xd8, 0xf6, 0x7d,
+	0xd1, 0xbf, 0x0b, 0xc1, 0xf2, 0x06, 0xa8, 0xd3, 0x87, 0x82, 0x1f, 0x50,
+	0xe7, 0x81, 0x5c, 0x70, 0x88, 0xfe, 0xf3, 0x68, 0x29, 0xff, 0x27, 0xf0,
+	0x28, 0x76, 0x63, 0x49, 0x21, 0xa6, 0xf2, 0xc7, 0xee, 0x2c, 0xc3, 0xb2,
+	0xe4, 0x8b, 0x5f, 0x38,
+};
+
+static const u8 rsa2080_modulus[] = {
+	0x90, 0xb4, 0x5d, 0xd0, 0xc4, 0x0f, 0x91, 0x1d, 0xb1, 0xda, 0x94, 0xa0,
+	0x39, 0xb7, 0x44, 0x91, 0xf2, 0x2b, 0x67, 0x19, 0x27, 0x0a, 0xf2, 0xb7,
+	0x10, 0xac, 0x85, 0xe5, 0x56, 0x6e, 0xe6, 0xa6, 0xa3, 0xc8, 0xde, 0x1a,
+	0x52, 0x83, 0x82, 0xed, 0xe5, 0xc2, 0xb8, 0x1d, 0xac, 0x11, 0x16, 0x00,
+	0x80, 0xc9, 0xbc, 0x7f, 0xf6, 0x7f, 0xbc, 0x07, 0x9c, 0x0f, 0xb7, 0x82,
+	0x81, 0x02, 0x52, 0xaa, 0x14, 0x88, 0x56, 0x88, 0xf7, 0xfc, 0xc4, 0xfb,
+	0x0a, 0xbb, 0x7f, 0xb9, 0x4d, 0xbd, 0x94, 0xdd, 0x5a, 0x25, 0xe0, 0xba,
+	0xb3, 0x74, 0xe0, 0x11, 0x8f, 0x38, 0xa3, 0x39, 0x86, 0x39, 0x3d, 0x56,
+	0xd3, 0xa7, 0x2e, 0xb7, 0xfb, 0x18, 0xaa, 0x74, 0x43, 0x64, 0xda, 0x36,
+	0x4a, 0x63, 0xc6, 0x7c, 0xac, 0x3d, 0x1f, 0x50, 0x92, 0xe2, 0x3a, 0x49,
+	0xc6, 0x99, 0xfb, 0xbc, 0x10, 0x38, 0x18, 0x93, 0x9a, 0x41, 0x24, 0x8c,
+	0x3d, 0xd9, 0xf5, 0xcf, 0x96, 0xb6, 0x40, 0xd8, 0x31, 0x01, 0xbb, 0x92,
+	0x6b, 0x8a, 0xb3, 0x8f, 0xe0, 0xc7, 0xd8, 0xac, 0xde, 0x38, 0xb5, 0x7c,
+	0x36, 0x97, 0xfc, 0xaa, 0xc5, 0x30, 0xc5, 0x25, 0x07, 0xe1, 0xfd, 0xdd,
+	0xae, 0x3e, 0x13, 0xef, 0xa1, 0x38, 0xf1, 0x78, 0xaa, 0xa6, 0x62, 0x5a,
+	0x6f, 0x8d, 0x6d, 0x48, 0x1a, 0xa1, 0xb9, 0x61, 0xc3, 0x22, 0x61, 0x5f,
+	0x56, 0xb1, 0x8e, 0xd1, 0x79, 0x1a, 0xbe, 0x8d, 0xa8, 0x6e, 0x62, 0xda,
+	0xbf, 0x31, 0x60, 0xb1, 0xe7, 0x2d, 0x9e, 0x1f, 0x10, 0xa1, 0x28, 0x90,
+	0xfc, 0xa1, 0xcd, 0x98, 0x45, 0xe6, 0x8e, 0xa6, 0x2e, 0xed, 0xc3, 0x87,
+	0xe7, 0x13, 0x30, 0x35, 0x40, 0x57, 0x59, 0x0e, 0x2f, 0x53, 0x0d, 0x73,
+	0x86, 0xa7, 0xa8, 0x01, 0xf8, 0xf3, 0xf2, 0x21, 0x58, 0xc4, 0x4e, 0xb8,
+	0x22, 0xfe, 0xc4, 0x38, 0x79, 0xed, 0x37, 0x8b,
+};
+
+static const u8 rsa2080_rr[] = {
+	0x3b, 0x5a, 0xa1, 0x1a, 0xde, 0x34, 0xe7, 0xff, 0x1f, 0x31, 0x20, 0xef,
+	0x3d, 0xa2, 0xc5, 0xf2, 0x1b, 0xb6, 0x63, 0x72, 0xe1, 0x11, 0x6d, 0x93,
+	0xbf, 0xde, 0x90, 0xd2, 0x72, 0x6c, 0x58, 0x0e, 0x8d, 0x0c, 0x7f, 0x63,
+	0x78, 0xc6, 0x4e, 0x3f, 0xfe, 0x15, 0x1a, 0x55, 0x88, 0x38, 0xfc, 0x6d,
+	0x15, 0x72, 0xdb, 0xd9, 0x69, 0x73, 0x68, 0xfe, 0x91, 0xa5, 0x13, 0x71,
+	0x39, 0xfc, 0x42, 0xe2, 0x52, 0x80, 0xc6, 0x77, 0x22, 0x29, 0x89, 0x2d,
+	0xdc, 0xd0, 0xc6, 0xc8, 0x94, 0xe8, 0x3b, 0x03, 0x2c, 0xbc, 0x0c, 0x1d,
+	0xe0, 0xe2, 0x08, 0xe5, 0x1c, 0xd3, 0x3c, 0xab, 0x83, 0xe3, 0x0c, 0x6f,
+	0xa6, 0x45, 0x66, 0xa9, 0xfc, 0x7a, 0x24, 0xa7, 0xf3, 0x52, 0xac, 0x0e,
+	0x00, 0x4c, 0x31, 0xc9, 0x09, 0x43, 0x54, 0x16, 0x0a, 0x37, 0x75, 0xb8,
+	0x1c, 0xb3, 0xe0, 0xc7, 0x68, 0x60, 0xa4, 0xe5, 0x5b, 0xe5, 0xc5, 0x05,
+	0xf3, 0x5f, 0x91, 0xd1, 0xa1, 0xeb, 0xc4, 0x9a, 0xe5, 0x1b, 0xae, 0x36,
+	0xd5, 0x67, 0xa9, 0x56, 0xb1, 0xf8, 0x16, 0x92, 0x01, 0x69, 0x45, 0xa0,
+	0x22, 0xa9, 0xcd, 0xa5, 0x29, 0xca, 0xf3, 0x1d, 0x20, 0x41, 0xc5, 0x3d,
+	0x94, 0x6d, 0x41, 0x8a, 0x6b, 0xfb, 0xb1, 0xdd, 0x17, 0xae, 0xda, 0xfa,
+	0x1c, 0xda, 0xc7, 0x52, 0x8d, 0x81, 0x2c, 0x84, 0x56, 0xf7, 0x05, 0x15,
+	0x47, 0xb4, 0xbd, 0x36, 0x36, 0x68, 0x19, 0xd0, 0x88, 0x87, 0xbd, 0x92,
+	0x6b, 0x20, 0x78, 0x11, 0xc6, 0x55, 0x01, 0x62, 0xc4, 0xc4, 0xc1, 0xc8,
+	0x26, 0x44, 0x53, 0xf8, 0x7b, 0x6c, 0x6a, 0xa7, 0xe0, 0xf1, 0x84, 0x37,
+	0xad, 0x5d, 0x8c, 0xe3, 0x39, 0x2c, 0x40, 0x70, 0x92, 0x77, 0x7c, 0x58,
+	0x93, 0x0e, 0x16, 0x76, 0x64, 0x36, 0x18, 0x82, 0x83, 0x36, 0xc6, 0x25,
+	0x87, 0xd8, 0x09, 0x9e, 0xa7, 0xcb, 0x73, 0xa3,
+};
+
+static const u8 rsa2080_sig[] = {
+	0x02, 0x17, 0x8a, 0xbf, 0xad, 0xf1, 0x3e, 0x0a, 0xcc, 0x6a, 0xac, 0x7d,
+	0x66, 0xfb, 0x8d, 0x6f, 0x00, 0x4a, 0x71, 0xa5, 0x45, 0x12, 0x7f, 0xf7,
+	0x62, 0x8c, 0x65, 0x1a, 0x73, 0x99, 0x82, 0xf7, 0x7e, 0x86, 0x21, 0x4e,
+	0x11, 0x0f, 0xef, 0x1f, 0xac, 0x9b, 0x29, 0x56, 0x0a, 0xbd, 0xc1, 0x3b,
+	0xef, 0x7d, 0xa8, 0xf9, 0xe6, 0xa4, 0x21, 0x7f, 0x6d, 0x01, 0x24, 0xa8,
+	0xea, 0x83, 0xc5, 0xcb, 0xff, 0x45, 0x0a, 0x48, 0xab, 0x21, 0x57, 0x21,
+	0x94, 0xba, 0xc5, 0x2c, 0x20, 0xca, 0x8c, 0x52, 0x2f, 0x0c, 0x0c, 0x1d,
+	0xd1, 0x5f, 0xe1, 0xfb, 0xa9, 0xac, 0x4e, 0xa8, 0xe5, 0x9a, 0xf1, 0x9d,
+	0xeb, 0x01, 0xd7, 0x64, 0xf4, 0x7d, 0xd3, 0x0a, 0xb1, 0xb9, 0xc3, 0x1e,
+	0x82, 0x8a, 0x9b, 0x35, 0xc9, 0xe7, 0x87, 0xc4, 0x04, 0x77, 0xb7, 0x53,
+	0x9a, 0xd4, 0xcc, 0xcd, 0xc7, 0xc8, 0xbc, 0xb7, 0xcd, 0xb2, 0x18, 0xb2,
+	0x6a, 0x09, 0x44, 0xa6, 0xda, 0x32, 0xed, 0x03, 0xab, 0x42, 0x82, 0x1f,
+	0x2e, 0x63, 0xd2, 0xac, 0x03, 0xfa, 0xc4, 0x25, 0x4e, 0x3f, 0x7b, 0x3b,
+	0xac, 0x89, 0x4e, 0x55, 0x61, 0x51, 0x2d, 0x1b, 0xf7, 0xb5, 0xb2, 0x1a,
+	0x85, 0x97, 0x5b, 0x0e, 0x0f, 0xcf, 0xb2, 0xa9, 0x89, 0x16, 0x99, 0xe2,
+	0x32, 0x16, 0xc5, 0x9d, 0x77, 0xd0, 0xd3, 0x57, 0xd4, 0x63, 0xa5, 0xd2,
+	0x99, 0x28, 0x7c, 0xa0, 0x0a, 0x62, 0xa4, 0xd8, 0x0f, 0xc5, 0x9e, 0x53,
+	0xe7, 0x12, 0x07, 0xc2, 0x48, 0x45, 0xf7, 0xa1, 0xe1, 0x94, 0x5d, 0xff,
+	0x63, 0x1e, 0x36, 0xbe, 0x00, 0x97, 0x75, 0xd9, 0x3a, 0x82, 0xdf, 0x5c,
+	0xb3, 0xe5, 0xb8, 0xa9, 0xe8, 0x90, 0xb1, 0x57, 0x9e, 0x93, 0x41, 0xfa,
+	0x82, 0x84, 0x1e, 0xd4, 0x00, 0x74, 0x80, 0x79, 0x42, 0x8d, 0x0b, 0xa6,
+	0xaa, 0x0e, 0x55, 0x12, 0x8c, 0x75, 0x3e, 0x98,
+};
+
+static const u8 rsa4096_modulus[] = {
+	0xc6, 0xee, 0x11, 0x05, 0xba, 0x15, 0x86, 0x9c, 0xde, 0xdc, 0x08, 0xea,
+	0x5a, 0xaa, 0x83, 0x4a, 0x9d, 0xe0, 0x57, 0xdb, 0x3a, 0x43, 0x8f, 0x93,
+	0x04, 0x20, 0x5c, 0x99, 0x0e, 0x77, 0x59, 0xc1, 0x2a, 0xf8, 0x14, 0x28,
+	0x1f, 0x50, 0x99, 0xde, 0xa3, 0xa6, 0x87, 0x86, 0x5c, 0x7c, 0xb0, 0x55,
+	0xab, 0x06, 0x81, 0xda, 0x36, 0xb7, 0x5a, 0x02, 0x48, 0x0f, 0x90, 0x25,
+	0x24, 0x13, 0xc7, 0x80, 0xb1, 0x5b, 0x7b, 0x4e, 0xaf, 0x65, 0x9a, 0x2f,
+	0x9c, 0x5d, 0x3a, 0xa6, 0x77, 0xd5, 0xea, 0x24, 0x96, 0x4d, 0x10, 0xae,
+	0x24, 0x80, 0x97, 0xa1, 0x66, 0x2f, 0xf5, 0x6b, 0x0b, 0x6d, 0xab, 0x12,
+	0xf7, 0x31, 0x56, 0x4d, 0x16, 0x48, 0xef, 0x85, 0x10, 0x78, 0xd3, 0x6a,
+	0x31, 0x13, 0x87, 0x11, 0xea, 0xe4, 0xbb, 0x0b, 0x1c, 0x36, 0x2c, 0x88,
+	0x27, 0x65, 0xf4, 0x7e, 0xc0, 0x3c, 0xb5, 0x6b, 0x3b, 0x61, 0x9c, 0xb6,
+	0xfa, 0xc1, 0x87, 0x06, 0xb2, 0xdd, 0x2a, 0xfc, 0x95, 0xf0, 0x72, 0x6d,
+	0xc9, 0xdf, 0x31, 0x6f, 0x6a, 0x02, 0x1e, 0x51, 0x4a, 0x76, 0xf0, 0x6d,
+	0x4f, 0x8e, 0x4a, 0x7f, 0xb2, 0x93, 0x99, 0xbb, 0xcf, 0xed, 0x78, 0x79,
+	0x66, 0x29, 0xaa, 0xae, 0xc4, 0xbe, 0xda, 0x49, 0x6c, 0xbf, 0x54, 0x63,
+	0x6c, 0xf2, 0x7a, 0xa2, 0x20, 0x51, 0xf6, 0x30, 0xbe, 0xfc, 0x9d, 0xad,
+	0xc6, 0x5a, 0x00, 0x9d, 0xd9, 0xc5, 0x5c, 0xb9, 0xfe, 0x30, 0x98, 0xaf,
+	0x18, 0x0a, 0xcc, 0xec, 0x07, 0xf5, 0x10, 0xfc, 0xe1, 0xd6, 0xa2, 0xd1,
+	0xfb, 0x81, 0x75, 0x16, 0x4c, 0xda, 0x40, 0x7d, 0xae, 0xc9, 0xea, 0xd5,
+	0x74, 0x59, 0x9e, 0x9d, 0x73, 0xa5, 0xbb, 0x1f, 0x6a, 0x4b, 0xa9, 0x9c,
+	0xc2, 0x30, 0x70, 0x8c, 0xf1, 0x55, 0x34, 0x29, 0xce, 0x06, 0xbb, 0xac,
+	0x81, 0xcc, 0x45, 0x9e, 0x43, 0x04, 0xa8, 0x91, 0x4e, 0x4d, 0x3f, 0xfe,
+	0xf6, 0xd7, 0x12, 0x32, 0xd1, 0xf3, 0x4a, 0x77, 0x60, 0x1d, 0x4d, 0x0a,
+	0xfd, 0x67, 0x08, 0x5c, 0x4b, 0xcb, 0x6c, 0xf1, 0x52, 0x6d, 0x5e, 0x26,
+	0x3b, 0x3f, 0x52, 0x3f, 0xbe, 0x2f, 0x26, 0x36, 0xb9, 0x6f, 0x19, 0xb7,
+	0xd2, 0x81, 0xc3, 0x63, 0xf0, 0x5a, 0x8b, 0x05, 0x35, 0xdb, 0x1c, 0x39,
+	0xdb, 0x30, 0xfb, 0xae, 0xda, 0x4d, 0x97, 0x3f, 0x12, 0x5f, 0xfa, 0x7a,
+	0x12, 0xae, 0xbd, 0x54, 0xa8, 0x96, 0x3d, 0xad, 0x5d, 0x7b, 0x90, 0xe8,
+	0xb9, 0xf0, 0xf9, 0xab, 0x50, 0x34, 0x89, 0xa0, 0x41, 0x47, 0x5c, 0x4a,
+	0x64, 0x50, 0x94, 0x14, 0x11, 0x6a, 0x73, 0x5e, 0x5d, 0xbe, 0x83, 0xed,
+	0xfe, 0x06, 0x57, 0x78, 0xef, 0xb3, 0x4d, 0xa6, 0x68, 0x4b, 0x65, 0xb1,
+	0xf4, 0x71, 0x48, 0xae, 0x3e, 0x2d, 0x65, 0xed, 0x71, 0x2f, 0xb3, 0xa1,
+	0x66, 0x6b, 0xf1, 0xdf, 0xf7, 0x40, 0x2a, 0xd3, 0x05, 0x0c, 0x9f, 0x99,
+	0x0c, 0x63, 0x37, 0x34, 0x13, 0x2d, 0x41, 0x74, 0x79, 0x82, 0xb3, 0x5a,
+	0xd8, 0xcb, 0xa1, 0xea, 0xf7, 0x49, 0xb8, 0x95, 0xf6, 0xce, 0x3c, 0x3c,
+	0x77, 0x5f, 0xc0, 0x79, 0x6a, 0x1a, 0x3b, 0x7b, 0x63, 0x7e, 0xe8, 0x95,
+	0x7f, 0x08, 0xe4, 0xe0, 0x83, 0xa6, 0x25, 0x8d, 0x98, 0x3c, 0x20, 0x2e,
+	0x28, 0x40, 0x29, 0x86, 0xff, 0xcd, 0x45, 0x30, 0x7f, 0x4e, 0x71, 0xa8,
+	0x71, 0x01, 0xd3, 0x94, 0x9f, 0x7c, 0x26, 0xd4, 0xe4, 0xc8, 0x07, 0xcc,
+	0x7c, 0xdc, 0x6d, 0x71, 0xd1, 0xea, 0xa8, 0xc7, 0x6a, 0xcb, 0x90, 0x8a,
+	0xc6, 0x99, 0x32, 0x30, 0xe8, 0x86, 0x5f, 0x0c, 0xc5, 0x2b, 0x75, 0xa1,
+	0xe6, 0x4a, 0xbb, 0x56, 0xdc, 0xb7, 0xb4, 0xa5, 0x13, 0x93, 0xc4, 0x98,
+	0x6c, 0x8a, 0x07, 0xc7, 0x36, 0x75, 0x3d, 0xa3,
+};
+
+static const u8 rsa4096_rr[] = {
+	0xc5, 0x69, 0x70, 0xba, 0x40, 0x0f, 0x49, 0xae, 0x2b, 0x70, 0x31, 0x9c,
+	0xdb, 0x96, 0xa7, 0xba, 0x67, 0x93, 0xea, 0x5c, 0xae, 0x1f, 0x58, 0xa9,
+	0x1b, 0xaa, 0x09, 0xfc, 0xd6, 0xa8, 0x7e, 0xe1, 0x07, 0x53, 0x46, 0xa4,
+	0xfb, 0xa2, 0x0d, 0x89, 0xb1, 0x15, 0x10, 0xcc, 0x8a, 0x68, 0x99, 0xa3,
+	0xc4, 0xf1, 0x22, 0x7a, 0xd2, 0x42, 0x07, 0x93, 0x07, 0x70, 0x91, 0x9e,
+	0x97, 0x55, 0x35, 0x22, 0x0e, 0x94, 0x62, 0x8f, 0x15, 0x56, 0x17, 0xe4,
+	0xad, 0x98, 0x47, 0x06, 0x48, 0xa5, 0xe6, 0x5c, 0xd7, 0xa4, 0x1e, 0xc1,
+	0xce, 0x93, 0x7b, 0xf4, 0xcb, 0xc0, 0x90, 0xbe, 0x9d, 0xff, 0xb2, 0x57,
+	0xff, 0x8e, 0x97, 0x0b, 0x5d, 0x43, 0x9e, 0x55, 0x8e, 0x85, 0x44, 0x08,
+	0x54, 0x42, 0x73, 0x02, 0x4b, 0x21, 0xb4, 0x7d, 0x63, 0x80, 0xe6, 0x50,
+	0x85, 0x99, 0x3a, 0x60, 0x7b, 0x3c, 0x4d, 0x35, 0xf4, 0x11, 0x1c, 0xfa,
+	0x8d, 0xb6, 0xc8, 0x3c, 0x90, 0x72, 0x95, 0x89, 0x8f, 0x2e, 0xe9, 0xf1,
+	0x43, 0x31, 0x76, 0xec, 0xf3, 0x4d, 0x38, 0x7e, 0xb5, 0x20, 0xe7, 0xae,
+	0x36, 0xd9, 0x09, 0x75, 0xf1, 0x38, 0x73, 0x4f, 0xb2, 0x5d, 0x35, 0x43,
+	0x69, 0x6e, 0x5b, 0x8b, 0x5a, 0x0e, 0x54, 0xf6, 0xfe, 0x22, 0x0b, 0xcc,
+	0x91, 0xe1, 0x6a, 0x91, 0x23, 0x14, 0xc9, 0xc6, 0xad, 0x7c, 0xb3, 0xb6,
+	0xd3, 0x80, 0x0d, 0x86, 0xbc, 0xce, 0x05, 0xc4, 0xfb, 0x8b, 0x22, 0xc7,
+	0x1c, 0x79, 0xf8, 0xe7, 0x30, 0x13, 0x25, 0xe3, 0x9d, 0xc7, 0xaa, 0x3a,
+	0x3c, 0x4f, 0x8b, 0x17, 0x3f, 0x6d, 0xbd, 0x3e, 0x40, 0x12, 0x32, 0x08,
+	0xcc, 0x19, 0x9e, 0xcd, 0xf9, 0x39, 0x82, 0x32, 0x88, 0xf4, 0x25, 0xf4,
+	0xdd, 0x8a, 0xed, 0x5d, 0xa3, 0x30, 0x89, 0x2a, 0x95, 0xb5, 0x0f, 0x70,
+	0x96, 0x92, 0x3e, 0xb8, 0x02, 0x97, 0x5e, 0x35, 0x72, 0xc8, 0xc3, 0x87,
+	0xd9, 0x30, 0xdd, 0x02, 0x15, 0xb5, 0x42, 0x68, 0x48, 0xde, 0x98, 0xf3,
+	0x4d, 0xcc, 0x33, 0x20, 0xdc, 0xfd, 0x93, 0x49, 0x66, 0x16, 0x23, 0xa9,
+	0x95, 0x50, 0xe3, 0x59, 0xc0, 0x21, 0x07, 0x4a, 0x6e, 0xdc, 0x9a, 0x47,
+	0xf0, 0x7f, 0x2f, 0xe6, 0x95, 0xfc, 0xc1, 0x21, 0x92, 0xad, 0xe1, 0xe2,
+	0x3b, 0x4c, 0x20, 0xcd, 0xd9, 0x6e, 0xaa, 0xe3, 0x46, 0x93, 0x11, 0x09,
+	0x51, 0xe5, 0xee, 0xee, 0x66, 0x52, 0x08, 0xd6, 0xfa, 0x4e, 0x89, 0xb1,
+	0x91, 0x92, 0x2b, 0x33, 0x02, 0xea, 0x71, 0x48, 0xcc, 0x73, 0x86, 0xd4,
+	0x3a, 0x22, 0xae, 0x44, 0xd8, 0x1d, 0x46, 0xf7, 0xf6, 0x65, 0xa9, 0x49,
+	0x3a, 0x07, 0x57, 0x92, 0x3b, 0x43, 0x17, 0xf6, 0x1e, 0xfe, 0x02, 0x11,
+	0x9a, 0x78, 0x84, 0x13, 0x2e, 0xff, 0x50, 0xd9, 0xe9, 0xc3, 0x51, 0x97,
+	0x7b, 0x03, 0x21, 0x5a, 0xb4, 0x4e, 0xdf, 0x9c, 0x14, 0x58, 0x49, 0xbc,
+	0x81, 0xf0, 0x46, 0x2f, 0xc1, 0xb2, 0xb5, 0x60, 0x6c, 0x9b, 0x00, 0x9a,
+	0xeb, 0x4c, 0x41, 0x2e, 0xb7, 0xf9, 0x2b, 0x88, 0xc0, 0x7f, 0xc8, 0x0b,
+	0xfe, 0xe8, 0xf6, 0x5d, 0x18, 0x7d, 0xcf, 0x97, 0x66, 0x6e, 0x3d, 0xbd,
+	0x30, 0xfc, 0xc8, 0x9a, 0xa9, 0x3d, 0x00, 0x17, 0x7d, 0xca, 0x8b, 0xaa,
+	0x9d, 0xe0, 0x13, 0xde, 0x34, 0x26, 0xb0, 0x9f, 0x89, 0x76, 0xf0, 0x04,
+	0x5b, 0xd0, 0x04, 0xd4, 0xf0, 0x35, 0xd5, 0xd6, 0x50, 0xf9, 0xfa, 0xbf,
+	0x53, 0xdc, 0x06, 0x08, 0x8c, 0x24, 0x3c, 0x30, 0x9f, 0x97, 0x74, 0xc9,
+	0x26, 0xd9, 0xcf, 0x7c, 0x00, 0x15, 0x08, 0x52, 0x50, 0xc4, 0x55, 0x82,
+	0x5a, 0x22, 0x23, 0x16, 0xaa, 0x70, 0x1c, 0xa2, 0x36, 0xab, 0x20, 0x24,
+	0x38, 0xe6, 0x3e, 0x5e, 0x1e, 0x86, 0x0f, 0x0f,
+};
+
+static const u8 rsa4096_sig[] = {
+	0x92, 0xe7, 0x7d, 0x55, 0xd8, 0x36, 0xd3, 0xe2, 0xdf, 0x5b, 0x46, 0x6c,
+	0x09, 0x88, 0x60, 0xd7, 0x43, 0x92, 0xe5, 0x0c, 0x2b, 0xee, 0xe4, 0xb5,
+	0x44, 0xd8, 0x95, 0xba, 0xfe, 0x8d, 0x66, 0x9d, 0x3f, 0x5b, 0x36, 0xb2,
+	0xce, 0x58, 0xb1, 0x5f, 0x64, 0x7d, 0xed, 0x9b, 0x76, 0x76, 0x3e, 0x6f,
+	0x8b, 0x4e, 0x73, 0x43, 0x0d, 0xf6, 0x4a, 0x2a, 0x51, 0x02, 0xa0, 0x9a,
+	0x02, 0x08, 0x3a, 0x45, 0xe3, 0x83, 0x2e, 0x36, 0x00, 0x99, 0x60, 0xb8,
+	0x0e, 0x29, 0x24, 0x54, 0x0d, 0xe4, 0x7e, 0xe2, 0xc5, 0xcd, 0xb1, 0xbf,
+	0xd8, 0x06, 0xb3, 0x43, 0xc0, 0x45, 0xb1, 0x09, 0x75, 0xe4, 0xe4, 0x41,
+	0xe8, 0xc8, 0xee, 0x2d, 0xbd, 0x67, 0xdd, 0x67, 0x9c, 0xef, 0x60, 0x11,
+	0x75, 0x77, 0x24, 0x2a, 0x13, 0xad, 0x4f, 0x3b, 0x97, 0x97, 0x1b, 0x05,
+	0x14, 0xf8, 0x36, 0x99, 0xfe, 0x59, 0x00, 0x57, 0xd3, 0xa3, 0x8e, 0xa6,
+	0x85, 0x40, 0xfe, 0x6c, 0x61, 0xd3, 0x87, 0xc2, 0xd2, 0xaa, 0xdb, 0xbb,
+	0x92, 0xee, 0x65, 0x45, 0x71, 0x8e, 0xfb, 0x2c, 0x0c, 0xc4, 0xb7, 0x8b,
+	0x77, 0x31, 0x21, 0x32, 0x9a, 0x4a, 0x8e, 0x90, 0xad, 0x90, 0x5a, 0xc6,
+	0x78, 0x67, 0x86, 0x53, 0xaf, 0x16, 0xce, 0x55, 0x95, 0x43, 0x42, 0x6e,
+	0xcd, 0x76, 0x63, 0x5a, 0x50, 0xd5, 0xbb, 0x84, 0x44, 0x0f, 0x63, 0xa1,
+	0x38, 0x1b, 0x07, 0xd4, 0x7f, 0x97, 0xd0, 0x5a, 0xf2, 0x3e, 0x2a, 0x28,
+	0x6b, 0x2c, 0x3c, 0xf9, 0x77, 0xa8, 0x3f, 0x1a, 0x66, 0x9c, 0xd9, 0xf7,
+	0x2d, 0xdb, 0x10, 0x84, 0x1b, 0x94, 0x8f, 0x3e, 0x8c, 0x6d, 0xbd, 0xff,
+	0x15, 0x43, 0xae, 0x82, 0x6a, 0xbb, 0x52, 0xec, 0xc9, 0x9a, 0x99, 0xab,
+	0x49, 0x17, 0x97, 0x46, 0x7b, 0x10, 0x66, 0x21, 0xe7, 0x09, 0x10, 0x70,
+	0xd8, 0xd0, 0x09, 0xee, 0x7d, 0xf2, 0x02, 0x42, 0x0d, 0x9d, 0x3d, 0x57,
+	0x05, 0xfe, 0x38, 0xf3, 0x07, 0x03, 0xb1, 0xd6, 0xb7, 0x80, 0xa4, 0xb8,
+	0xd0, 0x4f, 0xa1, 0x1a, 0x56, 0x27, 0x36, 0xf8, 0x32, 0xb6, 0x7f, 0x6a,
+	0x6b, 0xd4, 0xfb, 0x01, 0x72, 0xb3, 0x99, 0x30, 0x59, 0x64, 0xb6, 0xc8,
+	0xf6, 0xbf, 0xed, 0xab, 0x2e, 0x95, 0xcf, 0x5c, 0x8e, 0x0f, 0x25, 0xaa,
+	0x00, 0xda, 0x64, 0xe2, 0x9e, 0x77, 0xe8, 0x21, 0xb8, 0xe3, 0x68, 0xdf,
+	0x98, 0x79, 0x9c, 0x34, 0x46, 0x4a, 0x8d, 0x73, 0xc5, 0x4a, 0x4c, 0x03,
+	0xed, 0x7f, 0x5c, 0x7e, 0x78, 0xfb, 0xc7, 0x4f, 0xa2, 0xe9, 0x01, 0xdb,
+	0x4f, 0xd4, 0xec, 0x22, 0xf4, 0x77, 0x6a, 0x85, 0x20, 0x06, 0xe3, 0xe7,
+	0x83, 0x38, 0x7e, 0xa1, 0xd2, 0xd5, 0x95, 0x52, 0x9a, 0x95, 0xe3, 0x39,
+	0xb5, 0xb1, 0x6f, 0xe2, 0x05, 0xbd, 0x0b, 0xbc, 0xa4, 0x23, 0xae, 0xc0,
+	0x63, 0x12, 0x7a, 0xa0, 0x8a, 0xa8, 0xa1, 0xae, 0x03, 0x93, 0x39, 0xb2,
+	0xd9, 0x9b, 0xed, 0x34, 0xa4, 0xcd, 0x7b, 0x77, 0x1c, 0xc8, 0x88, 0x5a,
+	0xb9, 0x22, 0x33, 0x52, 0xd4, 0x58, 0x2d, 0xa1, 0xb1, 0x76, 0x1c, 0xdd,
+	0x13, 0x59, 0x6c, 0x62, 0x7c, 0x22, 0x2f, 0x80, 0x65, 0xb1, 0xf7, 0x4e,
+	0xb8, 0xe1, 0x3e, 0xe3, 0x07, 0xc6, 0x09, 0xb6, 0x3f, 0xaf, 0xa2, 0xd3,
+	0xa0, 0x19, 0x05, 0xde, 0xd4, 0x32, 0x23, 0x93, 0x73, 0x7b, 0x8c, 0xc8,
+	0x16, 0x82, 0x90, 0x30, 0x90, 0xc0, 0x49, 0x36, 0xf5, 0xfc, 0x65, 0x50,
+	0xf5, 0x36, 0x7d, 0xca, 0xd3, 0x58, 0x36, 0x17, 0x75, 0x47, 0xfe, 0x57,
+	0x76, 0x90, 0x09, 0x33, 0x96, 0xf6, 0x6a, 0x33, 0xbf, 0xed, 0xff, 0xb0,
+	0x67, 0x46, 0x34, 0x73, 0x2c, 0xc0, 0x7a, 0xdb, 0x58, 0x5f, 0xc2, 0x5e,
+	0x81, 0x00, 0xe0, 0x57, 0x79, 0xf4, 0x50, 0x89,
+};
+
+static const u8 sha256_barebox[] = {
+	0xdd, 0x6a, 0x46, 0x76, 0x36, 0x16, 0x90, 0xb7, 0x51, 0xaa, 0xf4, 0x4e,
+	0xc7, 0x70, 0x25, 0x7a, 0x38, 0xdc, 0xf2, 0xc8, 0x09, 0xfc, 0xe9, 0x7c,
+	0x26, 0x74, 0xfd, 0x92, 0xa1, 0x90, 0x5e, 0xf6,
+};
+
+static struct rsa_public_key *rsa_test_key(struct device_node *root,
+					   const char *name, int bits,
+					   const u8 *modulus, const u8 *rr)
+{
+	struct device_node *np = of_new_node(root, name);
+
+	of_property_write_u32(np, "rsa,num-bits", bits);
+	of_property_write_u64(np, "rsa,exponent", 65537);
+	of_set_property(np, "rsa,modulus", modulus, bits / 8, 1);
+	of_set_property(np, "rsa,r-squared", rr, bits / 8, 1);
+
+	return rsa_of_read_key(np);
+}
+
+static void test_rsa_key(int bits, const u8 *modulus, const u8 *rr,
+			 const u8 *sig)
+{
+	struct device_node *root = of_new_node(NULL, NULL);
+	struct rsa_public_key *key;
+	u8 hash[sizeof(sha256_barebox)];
+	u64 start, ns;
+	int i, ret;
+
+	total_tests++;
+
+	key = rsa_test_key(root, "key-selftest", bits, modulus, rr);
+	if (IS_ERR(key)) {
+		pr_err("%d bit key: cannot read: %pe\n", bits, key);
+		failed_tests++;
+		goto out;
+	}
+
+	start = get_time_ns();
+
+	for (i = 0; i < RSA_VERIFY_ROUNDS; i++) {
+		ret = rsa_verify(key, sig, bits / 8, sha256_barebox,
+				 HASH_ALGO_SHA256);
+		if (ret) {
+			pr_err("%d bit key: verification failed: %pe\n",
+			       bits, ERR_PTR(ret));
+			failed_tests++;
+			goto out_free;
+		}
+	}
+
+	ns = get_time_ns() - start;
+
+	pr_info("%d bit key: %llu us per verification\n", bits,
+		div_u64(ns, RSA_VERIFY_ROUNDS * USECOND));
+
+	total_tests++;
+
+	memcpy(hash, sha256_barebox, sizeof(hash));
+	hash[0] ^= 1;
+
+	ret = rsa_verify(key, sig, bits / 8, hash, HASH_ALGO_SHA256);
+	if (ret != -EKEYREJECTED) {
+		pr_err("%d bit key: wrong hash not rejected: %pe\n",
+		       bits, ERR_PTR(ret));
+		failed_tests++;
+	}
+
+out_free:
+	rsa_key_free(key);
+out:
+	of_delete_node(root);
+}
+
+static void test_rsa_key_too_large(void)
+{
+	struct device_node *root = of_new_node(NULL, NULL);
+	struct rsa_public_key *key;
+	int bits = RSA_MAX_SIG_BITS + 32;
+	u8 *buf;
+
+	total_tests++;
+
+	buf = xzalloc(bits / 8);
+	buf[bits / 8 - 1] = 1;
+
+	key = rsa_test_key(root, "key-selftest", bits, buf, buf);
+	if (!IS_ERR(key)) {
+		pr_err("%d bit key: not rejected\n", bits);
+		failed_tests++;
+		rsa_key_free(key);
+	}
+
+	free(buf);
+	of_delete_node(root);
+}
+
+static void test_rsa(void)
+{
+	test_rsa_key(2048, rsa2048_modulus, rsa2048_rr, rsa2048_sig);
+	test_rsa_key(2080, rsa2080_modulus, rsa2080_rr, rsa2080_sig);
+	test_rsa_key(4096, rsa4096_modulus, rsa4096_rr, rsa4096_sig);
+	test_rsa_key_too_large();
+}
+bselftest(core, test_rsa);